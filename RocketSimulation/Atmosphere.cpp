@@ -0,0 +1,108 @@
+/* Author: William Bryk
+
+ See Atmosphere.h.
+ */
+
+#include "Atmosphere.h"
+#include <cmath>
+
+AtmosphereTable::AtmosphereTable(double (*density)(double altitude), double top, double spacing){
+
+    Spacing = spacing;
+    InvSpacing = 1.0/spacing;
+    Cells = (int) ceil(top/spacing);
+    Coefficients.resize(4 * Cells);
+
+    // Hermite cubic through the value and slope at each end of the cell. Everything is sampled just inside
+    // the cell, so steps in a model (the ground, the old 43 km cutoff) land on cell edges instead of being smeared
+    const double inside = 1e-6, d = 0.01;
+    for (int i = 0; i < Cells; i++)
+    {
+        double h0 = i * spacing + inside, h1 = (i + 1) * spacing - inside;
+        double y0 = density(h0), y1 = density(h1);
+        double m0 = spacing * (density(h0 + d) - y0)/d;
+        double m1 = spacing * (y1 - density(h1 - d))/d;
+
+        double *c = &Coefficients[4*i];
+        c[0] = y0;
+        c[1] = m0;
+        c[2] = 3.0*(y1 - y0) - 2.0*m0 - m1;
+        c[3] = 2.0*(y0 - y1) + m0 + m1;
+    }
+}
+
+// using wikipedia for formula for air_density. Not as accurate outside troposphere
+double troposphereDensity(double altitude){
+
+    if ((altitude < 43000.0) && (altitude > 0.0))
+    {
+        double T = 288.15 - .0065 * altitude;
+        double pressure = 101.325*pow((1 - .0065 * altitude/288.15),(9.80665*.02896/(8.31447*.0065)));
+        return 1000.0 * pressure * .0289644/(T * 8.31447);
+    }
+    return 0.0;
+}
+
+// U.S. Standard Atmosphere 1976: seven layers of fixed lapse rate up to 86 km, then the published densities
+double standardAtmosphereDensity(double altitude){
+
+    if (altitude < 0.0)
+        return 0.0;
+
+    const double g0 = 9.80665, M = 0.0289644, R = 8.31432;
+
+    if (altitude < 86000.0)
+    {
+        // layers are defined on geopotential altitude
+        const double r0 = 6356766.0;
+        double H = r0 * altitude/(r0 + altitude);
+
+        const double base[] = {0.0, 11000.0, 20000.0, 32000.0, 47000.0, 51000.0, 71000.0};
+        const double lapse[] = {-0.0065, 0.0, 0.001, 0.0028, 0.0, -0.0028, -0.002};
+
+        double T = 288.15, P = 101325.0;
+        for (int layer = 0; layer < 7; layer++)
+        {
+            double top = (layer < 6) ? base[layer + 1] : H;
+            double dH = ((H < top) ? H : top) - base[layer];
+
+            double T_next = T + lapse[layer] * dH;
+            if (lapse[layer] == 0.0)
+                P = P * exp(-g0 * M * dH/(R * T));
+            else
+                P = P * pow(T/T_next, g0 * M/(R * lapse[layer]));
+            T = T_next;
+
+            if (H < top)
+                break;
+        }
+        return P * M/(R * T);
+    }
+
+    // above 86 km the gas is no longer well mixed, so go log-linear between the tabulated values
+    const double heights[] = {86000.0, 90000.0, 100000.0, 110000.0, 120000.0, 130000.0, 150000.0, 200000.0};
+    const double densities[] = {6.958e-6, 3.416e-6, 5.604e-7, 9.708e-8, 2.222e-8, 8.152e-9, 2.076e-9, 2.541e-10};
+    const int count = sizeof(heights)/sizeof(heights[0]);
+
+    for (int i = 0; i < count - 1; i++)
+    {
+        if (altitude < heights[i + 1])
+        {
+            double f = (altitude - heights[i])/(heights[i + 1] - heights[i]);
+            return densities[i] * pow(densities[i + 1]/densities[i], f);
+        }
+    }
+    return 0.0;
+}
+
+const AtmosphereTable &troposphereAtmosphere(){
+
+    static const AtmosphereTable table(troposphereDensity, 43000.0, 100.0);
+    return table;
+}
+
+const AtmosphereTable &standardAtmosphere(){
+
+    static const AtmosphereTable table(standardAtmosphereDensity, 200000.0, 100.0);
+    return table;
+}
@@ -0,0 +1,49 @@
+/* Author: William Bryk
+
+ Air density from a precomputed table instead of a pow() every step.
+
+ An AtmosphereTable samples a density model on a uniform altitude grid when it is built and stores one
+ cubic per cell, so a lookup is an index, a subtraction and three multiply-adds. Two models come with it:
+ the troposphere formula the simulation has always used (nothing above 43 km), and the 1976 US Standard
+ Atmosphere, which carries on through the stratosphere and mesosphere to 200 km.
+ */
+
+#ifndef ROCKETSIMULATION_ATMOSPHERE_H
+#define ROCKETSIMULATION_ATMOSPHERE_H
+
+#include <vector>
+
+class AtmosphereTable
+{
+public:
+    // sample density(altitude) every spacing meters from the ground up to top
+    AtmosphereTable(double (*density)(double altitude), double top, double spacing);
+
+    // kg/m^3 at altitude meters above the surface, zero below the ground and above the table
+    double density(double altitude) const {
+        double x = altitude * InvSpacing;
+        if (!(x >= 0.0) || (x >= Cells))
+            return 0.0;
+        int i = (int) x;
+        double t = x - i;
+        const double *c = &Coefficients[4*i];
+        return ((c[3]*t + c[2])*t + c[1])*t + c[0];
+    }
+
+    double top() const { return Cells * Spacing; }
+
+private:
+    double Spacing, InvSpacing;
+    int Cells;
+    std::vector<double> Coefficients;   // c0 c1 c2 c3 of each cell, in powers of the fraction across it
+};
+
+// the models, in kg/m^3 at altitude meters above the surface
+double troposphereDensity(double altitude);
+double standardAtmosphereDensity(double altitude);
+
+// tables of the two models, built the first time they are asked for
+const AtmosphereTable &troposphereAtmosphere();
+const AtmosphereTable &standardAtmosphere();
+
+#endif
@@ -0,0 +1,210 @@
+/* Author: William Bryk
+
+ See ContactEvents.h.
+ */
+
+#include "ContactEvents.h"
+#include "Integrator.h"
+#include "Kepler.h"
+#include <cmath>
+#include <algorithm>
+
+const double CONTACT_TIME_TOLERANCE = 1e-6;   // seconds, width of the bracket that is good enough
+const double CONTACT_DEPTH_TOLERANCE = 1e-3;  // meters below the ground that is good enough
+const double CONTACT_SLACK = 1.0;             // meters, for dist_to_earth that is a little out of date
+
+// what integrateFalcon() changes besides the counters, so the booster can be put back and re-stepped
+class FalconSnapshot
+{
+public:
+    RocketPart Falcon;
+    double TimeSinceLaunch;
+    double air_density;
+    double AdaptiveStep;
+};
+
+static FalconSnapshot takeSnapshot(const SimulationContext &sim){
+
+    FalconSnapshot snap;
+    snap.Falcon = sim.Falcon;
+    snap.TimeSinceLaunch = sim.TimeSinceLaunch;
+    snap.air_density = sim.air_density;
+    snap.AdaptiveStep = sim.AdaptiveStep;
+    return snap;
+}
+
+// put the booster back to snap and step it t seconds
+static double restepFalcon(SimulationContext &sim, const FalconSnapshot &snap, double t){
+
+    sim.Falcon = snap.Falcon;
+    sim.TimeSinceLaunch = snap.TimeSinceLaunch;
+    sim.air_density = snap.air_density;
+    sim.AdaptiveStep = snap.AdaptiveStep;
+
+    sim.DeltaT = t;
+    integrateFalcon(sim, t);
+    return lowestAltitude(sim.Falcon);
+}
+
+static double restepSecondStage(SimulationContext &sim, const RocketPart &snap, double t){
+
+    sim.SecondStage = snap;
+    sim.DeltaT = t;
+    getSecStagePosition(sim);
+    return lowestAltitude(sim.SecondStage);
+}
+
+// Find the time within (0, dt] at which restep() first carries the part below the ground, given that it is
+// above at 0 (altitude_start) and below at dt (altitude_end). Illinois false position: the bracket always keeps
+// a side above and a side below, and halving the weight of a side that keeps winning stops the slow one-sided
+// creep of plain false position. Leaves the part stepped to the returned time, just below the ground.
+template <class Restep>
+static double findContact(Restep restep, double dt, double altitude_start, double altitude_end){
+
+    double lo = 0.0, hi = dt;
+    double g_lo = altitude_start, g_hi = altitude_end;
+    bool at_hi = true;   // the part is currently stepped to hi
+    int side = 0;
+
+    for (int iteration = 0; iteration < 60; iteration++)
+    {
+        if ((hi - lo < CONTACT_TIME_TOLERANCE) || (g_hi > -CONTACT_DEPTH_TOLERANCE))
+            break;
+
+        double t = hi - g_hi * (hi - lo)/(g_hi - g_lo);
+        if (!(t > lo && t < hi))
+            t = 0.5 * (lo + hi);
+
+        double g = restep(t);
+        if (g < 0.0)
+        {
+            hi = t; g_hi = g; at_hi = true;
+            if (side == -1)
+                g_lo *= 0.5;
+            side = -1;
+        }
+        else
+        {
+            lo = t; g_lo = g; at_hi = false;
+            if (side == 1)
+                g_hi *= 0.5;
+            side = 1;
+        }
+    }
+
+    if (!at_hi)
+        restep(hi);
+    return hi;
+}
+
+double lowestAltitude(const RocketPart &part){
+
+    double top = MagOfVector(part.part_top[0], part.part_top[1] + EARTH_RADIUS);
+    double bottom = MagOfVector(part.part_bottom[0], part.part_bottom[1] + EARTH_RADIUS);
+    return std::min(top, bottom) - EARTH_RADIUS;
+}
+
+bool mayReachGround(const RocketPart &part, double dt){
+
+    // no point of the part is further than part_height from its center of mass, and the center of mass can't
+    // fall faster than its speed plus thrust and a generous gravity allow. Drag only ever slows the fall.
+    // The speed is counted twice to cover a dist_to_earth from the start of the last step (the second stage)
+    double speed = std::abs(part.vel_cm[0]) + std::abs(part.vel_cm[1]);
+    double accel = part.main_thrust[2]/part.mass + 20.0;
+    double reach = 2.0 * speed * dt + 0.5 * accel * dt * dt + part.part_height + CONTACT_SLACK;
+
+    return (part.dist_to_earth - EARTH_RADIUS) < reach;
+}
+
+void stepFalconWithContact(SimulationContext &sim, double dt){
+
+    RocketPart &Falcon = sim.Falcon;
+    switches &CheckList = sim.CheckList;
+
+    if (!CheckList.Liftoff || !mayReachGround(Falcon, dt))
+    {
+        if (!CheckList.Exploded && !CheckList.LandedSuccess)
+            integrateFalcon(sim, dt);
+        return;
+    }
+
+    // already resting on (or tipping over onto) the ground
+    ExplodeOrNot(sim);
+    if (CheckList.Exploded || CheckList.LandedSuccess)
+        return;
+
+    double altitude_start = lowestAltitude(Falcon);
+    FalconSnapshot snap = takeSnapshot(sim);
+
+    integrateFalcon(sim, dt);
+
+    double altitude_end = lowestAltitude(Falcon);
+    if ((altitude_start < 0.0) || (altitude_end >= 0.0))
+        return;
+
+    // the step went through the ground: go back to the moment of contact and let ExplodeOrNot() judge it there
+    double t = findContact([&](double t) { return restepFalcon(sim, snap, t); }, dt, altitude_start, altitude_end);
+
+    sim.DeltaT = dt;
+    ExplodeOrNot(sim);
+
+    // ExplodeOrNot() only stops the booster for good on a landing or an explosion, otherwise finish the step
+    if (!CheckList.Exploded && !CheckList.LandedSuccess && (dt - t > CONTACT_TIME_TOLERANCE))
+    {
+        sim.DeltaT = dt - t;
+        integrateFalcon(sim, dt - t);
+        sim.DeltaT = dt;
+    }
+}
+
+void stepSecondStageWithContact(SimulationContext &sim, double dt){
+
+    RocketPart &SecondStage = sim.SecondStage;
+    switches &CheckList = sim.CheckList;
+
+    if (!mayReachGround(SecondStage, dt))
+    {
+        if (!CheckList.SecondExploded)
+            getSecStagePosition(sim);
+        return;
+    }
+
+    SecondExplodeOrNot(sim);
+    if (CheckList.SecondExploded)
+        return;
+
+    double altitude_start = lowestAltitude(SecondStage);
+    RocketPart snap = SecondStage;
+    bool coasting = secondStageCoasting(sim);
+
+    getSecStagePosition(sim);
+
+    double altitude_end = lowestAltitude(SecondStage);
+    if (altitude_start < 0.0)
+        return;
+
+    // a coast step can be long enough to go into the ground and out the other side, so ask the orbit instead
+    double end = dt;
+    if (coasting && (altitude_end >= 0.0))
+    {
+        double pos[2] = {snap.pos_cm[0], snap.pos_cm[1] + EARTH_RADIUS};
+        double t = timeToRadius(pos, snap.vel_cm, EARTH_RADIUS - CONTACT_SLACK);
+        if ((t >= 0.0) && (t < dt))
+        {
+            end = t;
+            altitude_end = restepSecondStage(sim, snap, t);
+            if (altitude_end >= 0.0)
+            {
+                end = dt;
+                altitude_end = restepSecondStage(sim, snap, dt);
+            }
+        }
+    }
+    if (altitude_end >= 0.0)
+        return;
+
+    findContact([&](double t) { return restepSecondStage(sim, snap, t); }, end, altitude_start, altitude_end);
+
+    sim.DeltaT = dt;
+    SecondExplodeOrNot(sim);
+}
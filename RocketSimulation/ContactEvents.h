@@ -0,0 +1,26 @@
+/* Author: William Bryk
+
+ Ground contact found inside a step instead of after it.
+
+ A step that carries part_top or part_bottom below the surface is rolled back and re-run to the moment of
+ contact, found by false position (Illinois) on the lowest point's altitude, so ExplodeOrNot() and
+ SecondExplodeOrNot() judge the touchdown at the right place and speed however long the step is. Parts
+ that can't reach the ground within the step (nearly always) skip all of this on a cheap distance bound.
+ */
+
+#ifndef ROCKETSIMULATION_CONTACTEVENTS_H
+#define ROCKETSIMULATION_CONTACTEVENTS_H
+
+#include "Simulation.h"
+
+// altitude of whichever of part_top and part_bottom is lower
+double lowestAltitude(const RocketPart &part);
+
+// false when the part can't touch the ground within dt seconds, judged from dist_to_earth alone
+bool mayReachGround(const RocketPart &part, double dt);
+
+// the booster and second stage parts of step(), stopping at the exact moment of contact when there is one
+void stepFalconWithContact(SimulationContext &sim, double dt);
+void stepSecondStageWithContact(SimulationContext &sim, double dt);
+
+#endif
@@ -0,0 +1,283 @@
+/* Author: William Bryk
+
+ See Ensemble.h.
+ */
+
+#include "Ensemble.h"
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+// keep an angle within [-Pi, Pi]
+static double wrapAngle(double angle){
+    while (angle > Pi)
+        angle -= 2.0*Pi;
+    while (angle < -Pi)
+        angle += 2.0*Pi;
+    return angle;
+}
+
+// flies the profile by pressing the same switches a pilot would
+class Autopilot
+{
+public:
+    FlightProfile Profile;
+    double DetachTime;
+
+    Autopilot(const FlightProfile &profile, double detach_time) : Profile(profile), DetachTime(detach_time) {}
+
+    void control(SimulationContext &sim){
+
+        RocketPart &Falcon = sim.Falcon;
+        switches &CheckList = sim.CheckList;
+        double t = sim.SimulationTime;
+
+        if (!CheckList.Liftoff)
+        {
+            CheckList.Liftoff = true;
+            CheckList.rocketOn = true;
+        }
+
+        double target_theta = Pi/2.0;
+
+        if (!CheckList.Detached)
+        {
+            if (t >= Profile.KickStart)
+                target_theta = Pi/2.0 - Profile.PitchAngle;
+
+            if (t >= DetachTime)
+            {
+                detachStages(sim);
+                CheckList.rocketOn = false;
+            }
+        }
+        else
+        {
+            // booster on its way back down
+            double altitude = MagOfVector(Falcon.part_bottom[0], Falcon.part_bottom[1] + EARTH_RADIUS) - EARTH_RADIUS;
+            double r = MagOfVector(Falcon.pos_cm[0], Falcon.pos_cm[1] + EARTH_RADIUS);
+            double v_radial = (Falcon.vel_cm[0] * Falcon.pos_cm[0] + Falcon.vel_cm[1] * (Falcon.pos_cm[1] + EARTH_RADIUS))/r;
+
+            if (altitude < Profile.LegsAltitude)
+                CheckList.LegsDeployed = true;
+
+            double g = 3.98588 * pow(10.0,14.0)/(r*r);
+            double a_net = Falcon.main_thrust[2]/Falcon.mass - g;
+
+            // burn whenever we couldn't stop in the height that is left, which settles into a hover-slam
+            if ((v_radial < 0.0) && (a_net > 0.0) && (Falcon.FuelPercentage > 0.0))
+                CheckList.rocketOn = altitude <= Profile.BurnMargin * v_radial * v_radial/(2.0 * a_net);
+            else
+                CheckList.rocketOn = false;
+
+            // lean the thrust back over the pad
+            double a_lateral = -0.02 * Falcon.pos_cm[0] - 0.4 * Falcon.vel_cm[0];
+            target_theta = Pi/2.0 - std::max(-0.15, std::min(0.15, a_lateral/15.0));
+        }
+
+        // attitude hold: nitrogen thrusters always, the gimbal as well while the engine is lit
+        double error = wrapAngle(Falcon.theta - target_theta) + 2.0 * Falcon.omega;
+
+        CheckList.RotClock = error > 0.002;
+        CheckList.RotCountClock = error < -0.002;
+
+        double target_beta = CheckList.rocketOn ? std::max(-0.3, std::min(0.3, error)) : 0.0;
+        CheckList.GimbalClock = Falcon.GimbalBeta < target_beta - 0.005;
+        CheckList.GimbalCountClock = Falcon.GimbalBeta > target_beta + 0.005;
+    }
+};
+
+FlightDispersion drawDispersion(const EnsembleConfig &config, int flight){
+
+    // every flight gets its own generator, seeded from the ensemble seed and the flight number
+    std::seed_seq seeds = {(unsigned int) (config.Seed & 0xffffffffu), (unsigned int) (config.Seed >> 32), (unsigned int) flight};
+    std::mt19937_64 rng(seeds);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    const DispersionSpread &spread = config.Spread;
+    FlightDispersion d;
+
+    d.FuelLoad = std::max(0.5, std::min(1.0, spread.FuelLoadMean + spread.FuelLoadSigma * normal(rng)));
+    d.ThrustScale = 1.0 + spread.ThrustSigma * normal(rng);
+    d.GimbalRateScale = std::max(0.0, 1.0 + spread.GimbalRateSigma * normal(rng));
+    d.DetachTime = std::max(config.Profile.KickStart, config.Profile.DetachTime + spread.DetachTimeSigma * normal(rng));
+
+    return d;
+}
+
+// a fresh flight on the pad with the dispersions applied to the vehicle
+static void prepareFlight(SimulationContext &sim, const EnsembleConfig &config, const FlightDispersion &dispersion){
+
+    sim.Integrator = config.Integrator;
+    sim.Falcon.FuelPercentage = dispersion.FuelLoad;
+    sim.Falcon.main_thrust[2] *= dispersion.ThrustScale;
+    sim.Falcon.GimbalRate *= dispersion.GimbalRateScale;
+
+    // less fuel moves the center of mass, so stand the rocket back on the pad with it
+    updateMassAndMoment(sim);
+    sim.Falcon.pos_cm[1] = sim.Falcon.cm_location * sim.Vehicle->TotalLength;
+    sim.Falcon.dist_to_earth = EARTH_RADIUS + sim.Falcon.pos_cm[1];
+}
+
+// a step that isn't forward would leave the flight loops spinning at one time for good
+static bool validStepSize(const EnsembleConfig &config){
+    return config.StepSize > 0.0;
+}
+
+// fly on until the booster is down or time is up
+static void flyToEnd(SimulationContext &sim, const EnsembleConfig &config, Autopilot &pilot){
+
+    if (!validStepSize(config))
+        return;
+
+    while ((sim.SimulationTime < config.Profile.MaxFlightTime) && !sim.CheckList.Exploded && !sim.CheckList.LandedSuccess)
+    {
+        pilot.control(sim);
+        step(sim, config.StepSize);
+    }
+}
+
+static FlightResult flightResult(const SimulationContext &sim, const FlightDispersion &dispersion){
+
+    FlightResult result;
+    result.Dispersion = dispersion;
+    result.LandedSuccess = sim.CheckList.LandedSuccess;
+    result.Exploded = sim.CheckList.Exploded;
+    result.EndTime = sim.SimulationTime;
+    result.TouchdownX = sim.Falcon.part_bottom[0];
+    result.FuelLeft = sim.Falcon.FuelPercentage;
+    return result;
+}
+
+FlightResult flyDispersedFlight(const EnsembleConfig &config, const FlightDispersion &dispersion){
+
+    SimulationContext sim(*config.Vehicle);
+    prepareFlight(sim, config, dispersion);
+
+    Autopilot pilot(config.Profile, dispersion.DetachTime);
+    flyToEnd(sim, config, pilot);
+
+    return flightResult(sim, dispersion);
+}
+
+bool flyAscent(const EnsembleConfig &config, const FlightDispersion &dispersion, SimulationSnapshot &snapshot){
+
+    if (!validStepSize(config))
+        return false;
+
+    SimulationContext sim(*config.Vehicle);
+    prepareFlight(sim, config, dispersion);
+
+    // the step after separation is still flown by the ascent half of the autopilot, so the fork goes after it
+    Autopilot pilot(config.Profile, dispersion.DetachTime);
+    while ((sim.SimulationTime < config.Profile.MaxFlightTime) && !sim.CheckList.Exploded && !sim.CheckList.Detached)
+    {
+        pilot.control(sim);
+        step(sim, config.StepSize);
+    }
+
+    saveSnapshot(sim, snapshot);
+    return sim.CheckList.Detached && !sim.CheckList.Exploded;
+}
+
+std::vector<FlightResult> sweepBurnMargin(const EnsembleConfig &config, const FlightDispersion &dispersion, const std::vector<double> &margins, bool fork){
+
+    if (!validStepSize(config))
+        return std::vector<FlightResult>();
+
+    std::vector<FlightResult> results(margins.size());
+
+    SimulationSnapshot ascent;
+    if (fork)
+        flyAscent(config, dispersion, ascent);
+
+    runParallel((int) margins.size(), config.Threads, [&](int variant, int){
+
+        FlightProfile profile = config.Profile;
+        profile.BurnMargin = margins[variant];
+        Autopilot pilot(profile, dispersion.DetachTime);
+
+        SimulationContext sim(*config.Vehicle);
+        std::string error;
+        if (!fork || !restoreSnapshot(ascent, sim, error))
+            prepareFlight(sim, config, dispersion);
+
+        flyToEnd(sim, config, pilot);
+        results[variant] = flightResult(sim, dispersion);
+    });
+
+    return results;
+}
+
+EnsembleSummary summarizeFlights(const std::vector<FlightResult> &results){
+
+    EnsembleSummary summary;
+    summary.Flights = (int) results.size();
+
+    double sum_x = 0.0, sum_x2 = 0.0, sum_fuel = 0.0;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        if (results[i].LandedSuccess)
+        {
+            summary.Landed++;
+            sum_x += results[i].TouchdownX;
+            sum_x2 += results[i].TouchdownX * results[i].TouchdownX;
+            sum_fuel += results[i].FuelLeft;
+        }
+        else if (results[i].Exploded)
+            summary.Exploded++;
+        else
+            summary.TimedOut++;
+    }
+
+    if (summary.Flights > 0)
+    {
+        double n = summary.Flights;
+        double p = summary.Landed/n;
+        double z = 1.96;
+        double center = (p + z*z/(2.0*n))/(1.0 + z*z/n);
+        double half = z*sqrt(p*(1.0 - p)/n + z*z/(4.0*n*n))/(1.0 + z*z/n);
+
+        summary.SuccessRate = p;
+        summary.SuccessLow = center - half;
+        summary.SuccessHigh = center + half;
+    }
+
+    if (summary.Landed > 0)
+    {
+        summary.MeanTouchdownX = sum_x/summary.Landed;
+        summary.StdTouchdownX = sqrt(std::max(0.0, sum_x2/summary.Landed - summary.MeanTouchdownX * summary.MeanTouchdownX));
+        summary.MeanFuelLeft = sum_fuel/summary.Landed;
+    }
+
+    return summary;
+}
+
+EnsembleSummary runEnsemble(const EnsembleConfig &config, std::vector<FlightResult> *results){
+
+    if (!validStepSize(config))
+    {
+        if (results)
+            results->clear();
+        return EnsembleSummary();
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::vector<FlightResult> flights(config.Flights > 0 ? config.Flights : 0);
+
+    // each task writes only its own slot, so no locking is needed on the results
+    runParallel(config.Flights, config.Threads, [&](int flight, int){
+        flights[flight] = flyDispersedFlight(config, drawDispersion(config, flight));
+    });
+
+    EnsembleSummary summary = summarizeFlights(flights);
+    summary.WallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (results)
+        results->swap(flights);
+
+    return summary;
+}
@@ -0,0 +1,109 @@
+/* Author: William Bryk
+
+ Monte Carlo ensemble of headless flights.
+
+ Each flight flies the same simple autopilot profile (liftoff, pitch over, stage separation, coast,
+ legs out, landing burn) from initial conditions dispersed around the nominal vehicle. Flights get
+ their own seeded random generator, so an ensemble gives the same answer whatever the thread count.
+ */
+
+#ifndef ROCKETSIMULATION_ENSEMBLE_H
+#define ROCKETSIMULATION_ENSEMBLE_H
+
+#include "Simulation.h"
+#include "Snapshot.h"
+#include "Vehicle.h"
+#include <vector>
+
+// what the autopilot does, in simulation seconds and meters
+class FlightProfile
+{
+public:
+    double KickStart = 10.0;        // when to pitch over from vertical
+    double PitchAngle = 0.007;      // radians off vertical held for the rest of the ascent
+    double DetachTime = 55.0;
+    double LegsAltitude = 1000.0;
+    double BurnMargin = 1.15;       // start the landing burn this much above the stopping distance
+    double MaxFlightTime = 900.0;
+};
+
+// one flight's draw from the dispersions
+class FlightDispersion
+{
+public:
+    double FuelLoad = 1.0;          // fraction of a full booster load at liftoff
+    double ThrustScale = 1.0;
+    double GimbalRateScale = 1.0;
+    double DetachTime = 55.0;
+};
+
+// spread of the dispersions, all normal except the fuel load which can't go over a full tank
+class DispersionSpread
+{
+public:
+    double FuelLoadMean = 0.98, FuelLoadSigma = 0.01;
+    double ThrustSigma = 0.02;      // relative
+    double GimbalRateSigma = 0.1;   // relative
+    double DetachTimeSigma = 3.0;
+};
+
+class EnsembleConfig
+{
+public:
+    int Flights = 1000;
+    int Threads = 0;                // 0 uses every core
+    unsigned long long Seed = 1;
+    double StepSize = 0.01;         // must be more than zero, a step of 0 would never reach MaxFlightTime
+    IntegratorType Integrator = MixedEuler;
+    const VehicleConfig *Vehicle = &falcon9Vehicle();     // what every flight flies, see Vehicle.h
+    FlightProfile Profile;
+    DispersionSpread Spread;
+};
+
+class FlightResult
+{
+public:
+    FlightDispersion Dispersion;
+    bool LandedSuccess = false;
+    bool Exploded = false;
+    double EndTime = 0.0;
+    double TouchdownX = 0.0;
+    double FuelLeft = 0.0;
+};
+
+class EnsembleSummary
+{
+public:
+    int Flights = 0;
+    int Landed = 0;
+    int Exploded = 0;
+    int TimedOut = 0;
+
+    double SuccessRate = 0.0;
+    double SuccessLow = 0.0, SuccessHigh = 0.0;     // 95% Wilson interval
+
+    // over the landed flights only
+    double MeanTouchdownX = 0.0, StdTouchdownX = 0.0;
+    double MeanFuelLeft = 0.0;
+
+    double WallSeconds = 0.0;
+};
+
+FlightDispersion drawDispersion(const EnsembleConfig &config, int flight);
+FlightResult flyDispersedFlight(const EnsembleConfig &config, const FlightDispersion &dispersion);
+
+// fly a flight up to just after stage separation and snapshot it there. false if it never got that far
+bool flyAscent(const EnsembleConfig &config, const FlightDispersion &dispersion, SimulationSnapshot &snapshot);
+
+// the landing of one flight with each BurnMargin in margins, spread over the worker pool. With fork the ascent,
+// which doesn't depend on the margin, is flown once and every variant is forked from flyAscent()'s snapshot;
+// without it every variant flies the whole flight. Both give the same results bit for bit. Nothing is flown,
+// and no results come back, unless config.StepSize is more than zero
+std::vector<FlightResult> sweepBurnMargin(const EnsembleConfig &config, const FlightDispersion &dispersion, const std::vector<double> &margins, bool fork = true);
+
+// fly config.Flights flights across the worker pool, results come back in flight order. Nothing is flown, and
+// the summary counts no flights, unless config.StepSize is more than zero
+EnsembleSummary runEnsemble(const EnsembleConfig &config, std::vector<FlightResult> *results = 0);
+EnsembleSummary summarizeFlights(const std::vector<FlightResult> &results);
+
+#endif
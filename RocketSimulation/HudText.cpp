@@ -0,0 +1,145 @@
+/* Author: William Bryk
+
+ See HudText.h.
+ */
+
+#include "HudText.h"
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glut.h>
+#endif
+#include <algorithm>
+
+// the atlas is 16 characters across and 6 down, each in a cell 8 pixels wide and 16 high with the
+// baseline DESCENT pixels up from the bottom
+const int ATLAS_SIZE = 128;
+const int CELL_WIDTH = 8;
+const int CELL_HEIGHT = 16;
+const int DESCENT = 3;
+const int FIRST_CHAR = 32;
+const int LAST_CHAR = 126;
+
+bool HudLine::changed(std::initializer_list<double> shown){
+    if ((shown.size() == Shown.size()) && std::equal(shown.begin(), shown.end(), Shown.begin()))
+        return false;
+    Shown.assign(shown.begin(), shown.end());
+    return true;
+}
+
+HudText::HudText() : Texture(0), Advance(CELL_WIDTH), Dirty(true) {
+}
+
+HudText::~HudText(){
+    if (Texture)
+        glDeleteTextures(1, &Texture);
+}
+
+void HudText::build(void *font){
+
+    // one pixel per unit, from the bottom left of the window
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0.0, glutGet(GLUT_WINDOW_WIDTH), 0.0, glutGet(GLUT_WINDOW_HEIGHT), -1.0, 1.0);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    GLdouble clear_color[4];
+    glGetDoublev(GL_COLOR_CLEAR_VALUE, clear_color);
+    glClearColor(0.0, 0.0, 0.0, 0.0);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+    glColor3d(1.0, 1.0, 1.0);
+    for (int c = FIRST_CHAR; c <= LAST_CHAR; c++)
+    {
+        int cell = c - FIRST_CHAR;
+        glRasterPos2i((cell % 16) * CELL_WIDTH, (cell / 16) * CELL_HEIGHT + DESCENT);
+        glutBitmapCharacter(font, c);
+    }
+    Advance = glutBitmapWidth(font, 'M');
+
+    // white on black read back as intensity, so the characters are opaque and the rest clear
+    glGenTextures(1, &Texture);
+    glBindTexture(GL_TEXTURE_2D, Texture);
+    glCopyTexImage2D(GL_TEXTURE_2D, 0, GL_INTENSITY, 0, 0, ATLAS_SIZE, ATLAS_SIZE, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    Dirty = true;
+}
+
+void HudText::setLine(size_t i, double x, double y, double pixel, const char *text){
+
+    if (i >= Lines.size())
+    {
+        Lines.resize(i + 1);
+        Dirty = true;
+    }
+
+    Line &line = Lines[i];
+    if ((line.x != x) || (line.y != y) || (line.Pixel != pixel) || (line.Text != text))
+    {
+        line.x = x;
+        line.y = y;
+        line.Pixel = pixel;
+        line.Text = text;
+        Dirty = true;
+    }
+}
+
+void HudText::draw(){
+
+    if (!Texture)
+        return;
+
+    if (Dirty)
+    {
+        Batch.begin(0.0, 0.0);
+        Batch.setColor(1.0, 1.0, 1.0);
+        Batch.setTexture(Texture);
+        for (size_t i = 0; i < Lines.size(); i++)
+        {
+            const Line &line = Lines[i];
+
+            // on whole pixels, so every texel lands on exactly one pixel
+            double left = floor(line.x/line.Pixel + 0.5) * line.Pixel;
+            double bottom = (floor(line.y/line.Pixel + 0.5) - DESCENT) * line.Pixel;
+            double top = bottom + CELL_HEIGHT * line.Pixel;
+
+            for (size_t k = 0; k < line.Text.size(); k++)
+            {
+                int c = (unsigned char) line.Text[k];
+                if ((c < FIRST_CHAR) || (c > LAST_CHAR))
+                    c = '?';
+                int cell = c - FIRST_CHAR;
+                double u0 = (double) ((cell % 16) * CELL_WIDTH)/ATLAS_SIZE;
+                double v0 = (double) ((cell / 16) * CELL_HEIGHT)/ATLAS_SIZE;
+                double u1 = u0 + (double) CELL_WIDTH/ATLAS_SIZE;
+                double v1 = v0 + (double) CELL_HEIGHT/ATLAS_SIZE;
+
+                double x0 = left + k * Advance * line.Pixel;
+                double x1 = x0 + CELL_WIDTH * line.Pixel;
+                double x[4] = {x0, x1, x1, x0};
+                double y[4] = {bottom, bottom, top, top};
+                double u[4] = {u0, u1, u1, u0};
+                double v[4] = {v0, v0, v1, v1};
+                Batch.quad(x, y, u, v);
+            }
+        }
+        Dirty = false;
+    }
+
+    // only the characters themselves, not the black around them
+    glEnable(GL_ALPHA_TEST);
+    glAlphaFunc(GL_GREATER, 0.5f);
+    Batch.draw();
+    glDisable(GL_ALPHA_TEST);
+}
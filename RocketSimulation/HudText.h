@@ -0,0 +1,74 @@
+/* Author: William Bryk
+
+ The HUD's text, drawn from a glyph atlas.
+
+ glutBitmapCharacter is a glBitmap per character, and under a software GL every one of them is a trip
+ through the whole pipeline. Instead, build() draws every printable character of a GLUT bitmap font once,
+ copies them into a texture, and from then on each character is a textured quad in one RenderBatch, so all
+ the HUD's text is one draw call. The quads are only rebuilt when a line's text or place changes.
+
+ HudLine is the other half: it remembers the values a line last showed, rounded to the precision they
+ are shown at, so Draw() only formats the line again when what the user would see changes.
+ */
+
+#ifndef ROCKETSIMULATION_HUDTEXT_H
+#define ROCKETSIMULATION_HUDTEXT_H
+
+#include "RenderBatch.h"
+#include <cmath>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+class HudLine
+{
+public:
+    HudLine() { Text[0] = '\0'; }
+
+    // true when any of the values differ from the last call, each given as shownAt() its displayed precision
+    bool changed(std::initializer_list<double> shown);
+
+    char Text[200];
+
+private:
+    std::vector<double> Shown;
+};
+
+// value as it looks printed with the given number of decimals
+inline double shownAt(double value, int decimals){
+    double scale = pow(10.0, decimals);
+    return floor(value * scale + 0.5);
+}
+
+class HudText
+{
+public:
+    HudText();
+    ~HudText();
+
+    // copy the printable characters of a GLUT bitmap font (e.g. GLUT_BITMAP_8_BY_13) into the atlas. This
+    // draws into the back buffer, so call it before clearing for a frame, with a window at least 128 pixels
+    // on each side
+    void build(void *font);
+    bool ready() const { return Texture != 0; }
+
+    // show line i with its baseline starting at (x, y), in units where one screen pixel is pixel across
+    void setLine(size_t i, double x, double y, double pixel, const char *text);
+    void draw();
+
+private:
+    class Line
+    {
+    public:
+        double x, y, Pixel;
+        std::string Text;
+    };
+
+    GLuint Texture;
+    int Advance;        // pixels from one character to the next
+    std::vector<Line> Lines;
+    RenderBatch Batch;
+    bool Dirty;
+};
+
+#endif
@@ -0,0 +1,384 @@
+/* Author: William Bryk
+
+ See Integrator.h.
+ */
+
+#include "Integrator.h"
+#include "Atmosphere.h"
+#include "MassProperties.h"
+#include "Vehicle.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+const int FALCON_STATE_SIZE = 8;
+
+// smallest step DormandPrince will cut down to before taking it anyway
+const double MIN_ADAPTIVE_STEP = 1e-6;
+
+static void packState(const FalconState &state, double *values){
+    values[0] = state.pos_cm[0]; values[1] = state.pos_cm[1];
+    values[2] = state.vel_cm[0]; values[3] = state.vel_cm[1];
+    values[4] = state.theta; values[5] = state.omega;
+    values[6] = state.FuelPercentage; values[7] = state.GimbalBeta;
+}
+
+static FalconState unpackState(const double *values){
+    FalconState state;
+    state.pos_cm[0] = values[0]; state.pos_cm[1] = values[1];
+    state.vel_cm[0] = values[2]; state.vel_cm[1] = values[3];
+    state.theta = values[4]; state.omega = values[5];
+    state.FuelPercentage = values[6]; state.GimbalBeta = values[7];
+    return state;
+}
+
+// y + h * (a[0] k[0] + a[1] k[1] + ... + a[n-1] k[n-1])
+static FalconState combine(const FalconState &y, double h, int n, const double *a, const FalconState *k){
+
+    double values[FALCON_STATE_SIZE], rates[FALCON_STATE_SIZE];
+    packState(y, values);
+
+    for (int j = 0; j < n; j++)
+    {
+        if (a[j] == 0.0)
+            continue;
+        packState(k[j], rates);
+        for (int i = 0; i < FALCON_STATE_SIZE; i++)
+            values[i] += h * a[j] * rates[i];
+    }
+    return unpackState(values);
+}
+
+FalconState falconStateOf(const RocketPart &Falcon){
+
+    FalconState state;
+    state.pos_cm[0] = Falcon.pos_cm[0]; state.pos_cm[1] = Falcon.pos_cm[1];
+    state.vel_cm[0] = Falcon.vel_cm[0]; state.vel_cm[1] = Falcon.vel_cm[1];
+    state.theta = Falcon.theta;
+    state.omega = Falcon.omega;
+    state.FuelPercentage = Falcon.FuelPercentage;
+    state.GimbalBeta = Falcon.GimbalBeta;
+    return state;
+}
+
+// falconRates() for one flight phase, see flightPhase()
+template <int Phase>
+static FalconState phaseRates(SimulationContext &sim, const FalconState &state){
+
+    const bool Detached = (Phase & PHASE_DETACHED) != 0;
+    const bool Liftoff = (Phase & PHASE_LIFTOFF) != 0;
+    const bool Burning = (Phase & PHASE_BURNING) != 0;
+    RocketPart &Falcon = sim.Falcon;
+
+    sim.ForceEvaluations++;
+
+    MassProperties properties = sim.Vehicle->massTable(Detached).at(state.FuelPercentage);
+    double mass = properties.mass, cm_location = properties.cm_location, moment = properties.MomentofInertia;
+
+    // unit vector from bottom to top
+    double ux = cos(state.theta);
+    double uy = sin(state.theta);
+
+    // gravity, F = - GmM/r^2 toward the center of the Earth
+    double r = MagOfVector(state.pos_cm[0], state.pos_cm[1] + EARTH_RADIUS);
+    double grav_magnitude = 3.98588 * pow(10.0,14.0) * mass/(r*r);
+    Falcon.gravity[0] = - grav_magnitude * state.pos_cm[0]/r;
+    Falcon.gravity[1] = - grav_magnitude * (state.pos_cm[1] + EARTH_RADIUS)/r;
+
+    // air resistance, same drag model as updateForces()
+    double speed = MagOfVector(state.vel_cm[0], state.vel_cm[1]);
+    double sin_alpha = 0.0, cos_alpha = 0.0;
+    if (speed > .00001)
+    {
+        sin_alpha = state.vel_cm[1]/speed;
+        cos_alpha = state.vel_cm[0]/speed;
+    }
+    double A = std::abs(Falcon.part_width * Falcon.part_height*(uy*cos_alpha - sin_alpha*ux)) +
+        std::abs(Falcon.part_width * Falcon.part_width*(ux*cos_alpha + uy*sin_alpha));
+    sim.air_density = sim.Atmosphere->density(r - EARTH_RADIUS);
+    double D = .6 * .5 * sim.air_density * speed * speed * A;
+    Falcon.air_resistance[0] = - D * cos_alpha;
+    Falcon.air_resistance[1] = - D * sin_alpha;
+
+    // main thrust, swivelled GimbalBeta off the axis
+    bool burning = Burning && (state.FuelPercentage > 0.00001);
+    if (burning)
+    {
+        Falcon.main_thrust[0] = Falcon.main_thrust[2] * (cos(state.GimbalBeta)*ux - sin(state.GimbalBeta)*uy);
+        Falcon.main_thrust[1] = Falcon.main_thrust[2] * (cos(state.GimbalBeta)*uy + sin(state.GimbalBeta)*ux);
+    }
+    else
+    {
+        Falcon.main_thrust[0] = 0.0;
+        Falcon.main_thrust[1] = 0.0;
+    }
+
+    // nitrogen thrusters push sideways
+    double nit_left = (Liftoff && (Phase & PHASE_ROT_CLOCK)) ? Falcon.nit_thrust_left[2] : 0.0;
+    double nit_right = (Liftoff && (Phase & PHASE_ROT_COUNTCLOCK)) ? Falcon.nit_thrust_right[2] : 0.0;
+    Falcon.nit_thrust_left[0] = nit_left * uy;
+    Falcon.nit_thrust_left[1] = - nit_left * ux;
+    Falcon.nit_thrust_right[0] = - nit_right * uy;
+    Falcon.nit_thrust_right[1] = nit_right * ux;
+
+    // torque about the center of mass, signed the way updateTorque() signs it
+    Falcon.torque = (Falcon.part_height/2.0 - cm_location * Falcon.part_height) * (ux * Falcon.air_resistance[1] - uy * Falcon.air_resistance[0]) +
+        cm_location * Falcon.part_height * (Falcon.main_thrust[0] * uy - Falcon.main_thrust[1] * ux) +
+        (sim.Vehicle->NitrogenHeight - cm_location * sim.Vehicle->TotalLength) * (nit_right - nit_left);
+
+    FalconState rate;
+    rate.pos_cm[0] = state.vel_cm[0];
+    rate.pos_cm[1] = state.vel_cm[1];
+
+    if (Liftoff)
+    {
+        rate.vel_cm[0] = (Falcon.gravity[0] + Falcon.air_resistance[0] + Falcon.main_thrust[0] + Falcon.nit_thrust_left[0] + Falcon.nit_thrust_right[0])/mass;
+        rate.vel_cm[1] = (Falcon.gravity[1] + Falcon.air_resistance[1] + Falcon.main_thrust[1] + Falcon.nit_thrust_left[1] + Falcon.nit_thrust_right[1])/mass;
+    }
+    else
+    {
+        rate.vel_cm[0] = 0.0;
+        rate.vel_cm[1] = 0.0;
+    }
+
+    rate.theta = state.omega;
+    rate.omega = Falcon.torque/moment;
+
+    // mass flow rate formula using thrust and specific impulse
+    rate.FuelPercentage = burning ? - Falcon.main_thrust[2]/sim.Vehicle->ExhaustVelocity/sim.Vehicle->BoosterFuelMass : 0.0;
+
+    rate.GimbalBeta = 0.0;
+    if ((Phase & PHASE_GIMBAL_CLOCK) && (state.GimbalBeta < Pi/4.0))
+        rate.GimbalBeta += Falcon.GimbalRate;
+    if ((Phase & PHASE_GIMBAL_COUNTCLOCK) && (state.GimbalBeta > -Pi/4.0))
+        rate.GimbalBeta -= Falcon.GimbalRate;
+
+    return rate;
+}
+
+typedef FalconState (*RatesKernel)(SimulationContext &sim, const FalconState &state);
+
+// indexed by flightPhase()
+template <typename List> struct RatesKernels;
+template <int... Phases> struct RatesKernels<PhaseList<Phases...> >
+{
+    static const RatesKernel Rates[PHASE_COUNT];
+};
+template <int... Phases> const RatesKernel RatesKernels<PhaseList<Phases...> >::Rates[PHASE_COUNT] = {phaseRates<Phases>...};
+
+static const RatesKernel *const RATES_KERNELS = RatesKernels<AllPhases<PHASE_COUNT>::type>::Rates;
+
+FalconState falconRates(SimulationContext &sim, const FalconState &state){
+    return RATES_KERNELS[flightPhase(sim.CheckList)](sim, state);
+}
+
+static FalconState semiImplicitEulerStep(SimulationContext &sim, RatesKernel rates, const FalconState &y, double h){
+
+    FalconState k = rates(sim, y);
+    FalconState next = y;
+
+    next.vel_cm[0] += h * k.vel_cm[0];
+    next.vel_cm[1] += h * k.vel_cm[1];
+    next.pos_cm[0] += h * next.vel_cm[0];
+    next.pos_cm[1] += h * next.vel_cm[1];
+    next.omega += h * k.omega;
+    next.theta += h * next.omega;
+    next.FuelPercentage += h * k.FuelPercentage;
+    next.GimbalBeta += h * k.GimbalBeta;
+
+    return next;
+}
+
+static FalconState rungeKutta4Step(SimulationContext &sim, RatesKernel rates, const FalconState &y, double h){
+
+    static const double half[] = {0.5};
+    static const double whole[] = {1.0};
+    static const double weights[] = {1.0/6.0, 1.0/3.0, 1.0/3.0, 1.0/6.0};
+
+    FalconState k[4];
+    k[0] = rates(sim, y);
+    k[1] = rates(sim, combine(y, h, 1, half, &k[0]));
+    k[2] = rates(sim, combine(y, h, 1, half, &k[1]));
+    k[3] = rates(sim, combine(y, h, 1, whole, &k[2]));
+
+    return combine(y, h, 4, weights, k);
+}
+
+// velocity Verlet, with the velocity the drag sees at the end of the step predicted by Euler
+static FalconState verletStep(SimulationContext &sim, RatesKernel rates, const FalconState &y, double h){
+
+    FalconState a0 = rates(sim, y);
+    FalconState next = y;
+
+    next.pos_cm[0] += h * y.vel_cm[0] + 0.5 * h * h * a0.vel_cm[0];
+    next.pos_cm[1] += h * y.vel_cm[1] + 0.5 * h * h * a0.vel_cm[1];
+    next.theta += h * y.omega + 0.5 * h * h * a0.omega;
+    next.FuelPercentage += h * a0.FuelPercentage;
+    next.GimbalBeta += h * a0.GimbalBeta;
+
+    next.vel_cm[0] += h * a0.vel_cm[0];
+    next.vel_cm[1] += h * a0.vel_cm[1];
+    next.omega += h * a0.omega;
+
+    FalconState a1 = rates(sim, next);
+
+    next.vel_cm[0] = y.vel_cm[0] + 0.5 * h * (a0.vel_cm[0] + a1.vel_cm[0]);
+    next.vel_cm[1] = y.vel_cm[1] + 0.5 * h * (a0.vel_cm[1] + a1.vel_cm[1]);
+    next.omega = y.omega + 0.5 * h * (a0.omega + a1.omega);
+
+    return next;
+}
+
+// Dormand-Prince RK5(4), stepping as far as sim.Tolerance allows until dt is covered
+static FalconState dormandPrinceSteps(SimulationContext &sim, RatesKernel rates, FalconState y, double dt){
+
+    static const double a2[] = {1.0/5.0};
+    static const double a3[] = {3.0/40.0, 9.0/40.0};
+    static const double a4[] = {44.0/45.0, -56.0/15.0, 32.0/9.0};
+    static const double a5[] = {19372.0/6561.0, -25360.0/2187.0, 64448.0/6561.0, -212.0/729.0};
+    static const double a6[] = {9017.0/3168.0, -355.0/33.0, 46732.0/5247.0, 49.0/176.0, -5103.0/18656.0};
+    static const double b5[] = {35.0/384.0, 0.0, 500.0/1113.0, 125.0/192.0, -2187.0/6784.0, 11.0/84.0};
+    static const double e[] = {71.0/57600.0, 0.0, -71.0/16695.0, 71.0/1920.0, -17253.0/339200.0, 22.0/525.0, -1.0/40.0};
+
+    // size each entry is measured against, so meters, radians and fuel fractions can share one tolerance
+    static const double scale[FALCON_STATE_SIZE] = {1000.0, 1000.0, 10.0, 10.0, 1.0, 0.1, 1.0, 1.0};
+
+    FalconState k[7];
+    k[0] = rates(sim, y);
+
+    double t = 0.0;
+    while (dt - t > 1e-12)
+    {
+        double h = std::min(sim.AdaptiveStep, dt - t);
+
+        k[1] = rates(sim, combine(y, h, 1, a2, k));
+        k[2] = rates(sim, combine(y, h, 2, a3, k));
+        k[3] = rates(sim, combine(y, h, 3, a4, k));
+        k[4] = rates(sim, combine(y, h, 4, a5, k));
+        k[5] = rates(sim, combine(y, h, 5, a6, k));
+        FalconState next = combine(y, h, 6, b5, k);
+        k[6] = rates(sim, next);
+
+        // difference between the fifth and fourth order answers
+        FalconState zero;
+        memset(&zero, 0, sizeof(zero));
+        double error[FALCON_STATE_SIZE], before[FALCON_STATE_SIZE], after[FALCON_STATE_SIZE];
+        packState(combine(zero, h, 7, e, k), error);
+        packState(y, before);
+        packState(next, after);
+
+        double ratio = 0.0;
+        for (int i = 0; i < FALCON_STATE_SIZE; i++)
+            ratio = std::max(ratio, std::abs(error[i])/(sim.Tolerance * (scale[i] + std::max(std::abs(before[i]), std::abs(after[i])))));
+
+        double factor = (ratio > 0.0) ? 0.9 * pow(ratio, -0.2) : 5.0;
+        factor = std::max(0.2, std::min(5.0, factor));
+
+        if ((ratio <= 1.0) || (h <= MIN_ADAPTIVE_STEP))
+        {
+            t += h;
+            y = next;
+            k[0] = k[6]; // first stage of the next step is the last stage of this one
+
+            // a step cut short to land on dt says nothing about how long the next one could be
+            if (h >= sim.AdaptiveStep || factor < 1.0)
+                sim.AdaptiveStep = h * factor;
+        }
+        else
+            sim.AdaptiveStep = h * factor;
+
+        sim.AdaptiveStep = std::max(MIN_ADAPTIVE_STEP, sim.AdaptiveStep);
+    }
+
+    return y;
+}
+
+// copy an integrated state onto the booster and bring everything that follows from it up to date
+static void setFalconState(SimulationContext &sim, const FalconState &state){
+
+    RocketPart &Falcon = sim.Falcon;
+
+    Falcon.pos_cm[0] = state.pos_cm[0]; Falcon.pos_cm[1] = state.pos_cm[1];
+    Falcon.vel_cm[0] = state.vel_cm[0]; Falcon.vel_cm[1] = state.vel_cm[1];
+    Falcon.omega = state.omega;
+    Falcon.GimbalBeta = state.GimbalBeta;
+
+    // keep theta within [0, 2 Pi) like updateTheta()
+    Falcon.theta = state.theta - 2.0*Pi*floor(state.theta/(2.0*Pi));
+
+    // once the tank is dry the engine is out for good, like updateMainThrust()
+    Falcon.FuelPercentage = std::max(0.0, state.FuelPercentage);
+    if (sim.CheckList.rocketOn && (Falcon.FuelPercentage <= 0.00001))
+    {
+        Falcon.main_thrust[2] = 0.0;
+        Falcon.FuelPercentage = 0.0;
+    }
+
+    updateMassAndMoment(sim);
+
+    Falcon.dist_to_earth = MagOfVector(Falcon.pos_cm[0], Falcon.pos_cm[1] + EARTH_RADIUS);
+
+    double dist2bottom = Falcon.cm_location * Falcon.part_height;
+    double dist2top = Falcon.part_height - dist2bottom;
+    Falcon.part_top[0] = dist2top*cos(Falcon.theta) + Falcon.pos_cm[0];
+    Falcon.part_top[1] = dist2top*sin(Falcon.theta) + Falcon.pos_cm[1];
+    Falcon.part_bottom[0] = dist2bottom*cos(Falcon.theta + Pi) + Falcon.pos_cm[0];
+    Falcon.part_bottom[1] = dist2bottom*sin(Falcon.theta + Pi) + Falcon.pos_cm[1];
+}
+
+void integrateFalcon(SimulationContext &sim, double dt){
+
+    if (sim.Integrator == MixedEuler)
+    {
+        getPosition(sim);
+        sim.ForceEvaluations++;
+        return;
+    }
+
+    if (sim.CheckList.Liftoff)
+        sim.TimeSinceLaunch += dt;
+
+    FalconState state = falconStateOf(sim.Falcon);
+
+    // the switches hold still for the whole step, and the phase with them
+    RatesKernel rates = RATES_KERNELS[flightPhase(sim.CheckList)];
+
+    if (sim.Integrator == SemiImplicitEuler)
+        state = semiImplicitEulerStep(sim, rates, state, dt);
+    else if (sim.Integrator == RungeKutta4)
+        state = rungeKutta4Step(sim, rates, state, dt);
+    else if (sim.Integrator == DormandPrince)
+        state = dormandPrinceSteps(sim, rates, state, dt);
+    else if (sim.Integrator == Verlet)
+        state = verletStep(sim, rates, state, dt);
+
+    setFalconState(sim, state);
+}
+
+const char *integratorName(IntegratorType type){
+
+    switch (type)
+    {
+        case MixedEuler: return "mixed-euler";
+        case SemiImplicitEuler: return "semi-implicit-euler";
+        case RungeKutta4: return "rk4";
+        case DormandPrince: return "dormand-prince";
+        case Verlet: return "verlet";
+    }
+    return "unknown";
+}
+
+bool integratorFromName(const char *name, IntegratorType &type){
+
+    const IntegratorType types[] = {MixedEuler, SemiImplicitEuler, RungeKutta4, DormandPrince, Verlet};
+
+    for (size_t i = 0; i < sizeof(types)/sizeof(types[0]); i++)
+    {
+        if (!strcmp(name, integratorName(types[i])))
+        {
+            type = types[i];
+            return true;
+        }
+    }
+    return false;
+}
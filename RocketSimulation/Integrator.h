@@ -0,0 +1,40 @@
+/* Author: William Bryk
+
+ Integrators for the booster, picked at run time with SimulationContext::Integrator.
+
+ MixedEuler is the original getPosition(). The rest treat the booster as an ordinary differential equation:
+ falconRates() works out d/dt of a FalconState from the forces and torque at that state, and each scheme
+ decides where to evaluate it. RungeKutta4 and DormandPrince stay accurate at steps hundreds of times
+ longer than MixedEuler needs, which is what keeps large time warps on the right trajectory.
+ */
+
+#ifndef ROCKETSIMULATION_INTEGRATOR_H
+#define ROCKETSIMULATION_INTEGRATOR_H
+
+#include "Simulation.h"
+
+// the part of the booster that is integrated, everything else on RocketPart follows from it
+class FalconState
+{
+public:
+    double pos_cm[2];
+    double vel_cm[2];
+    double theta;
+    double omega;
+    double FuelPercentage;
+    double GimbalBeta;
+};
+
+FalconState falconStateOf(const RocketPart &Falcon);
+
+// rate of change of every FalconState entry, with the switches held as they are in sim
+// (also leaves the forces and torque it found on sim.Falcon, for drawing)
+FalconState falconRates(SimulationContext &sim, const FalconState &state);
+
+// move the booster forward dt seconds with sim.Integrator, in place of getPosition()
+void integrateFalcon(SimulationContext &sim, double dt);
+
+const char *integratorName(IntegratorType type);
+bool integratorFromName(const char *name, IntegratorType &type);
+
+#endif
@@ -0,0 +1,188 @@
+/* Author: William Bryk
+
+ See Kepler.h.
+ */
+
+#include "Kepler.h"
+#include "Atmosphere.h"
+#include <cmath>
+#include <algorithm>
+
+// Stumpff functions, with their series near z = 0 where the closed forms lose everything to cancellation
+static double stumpffC(double z){
+
+    if (z > 1e-3)
+        return (1.0 - cos(sqrt(z)))/z;
+    if (z < -1e-3)
+        return (cosh(sqrt(-z)) - 1.0)/(-z);
+    return 1.0/2.0 - z/24.0 + z*z/720.0 - z*z*z/40320.0;
+}
+
+static double stumpffS(double z){
+
+    if (z > 1e-3)
+    {
+        double s = sqrt(z);
+        return (s - sin(s))/(s*s*s);
+    }
+    if (z < -1e-3)
+    {
+        double s = sqrt(-z);
+        return (sinh(s) - s)/(s*s*s);
+    }
+    return 1.0/6.0 - z/120.0 + z*z/5040.0 - z*z*z/362880.0;
+}
+
+void propagateKepler(double pos[2], double vel[2], double dt){
+
+    const double sqrt_mu = sqrt(EARTH_GM);
+
+    double r0 = MagOfVector(pos[0], pos[1]);
+    double v0_squared = vel[0]*vel[0] + vel[1]*vel[1];
+    double rv0 = (pos[0]*vel[0] + pos[1]*vel[1])/sqrt_mu;
+    double alpha = 2.0/r0 - v0_squared/EARTH_GM;   // 1/a, negative on an escape path
+
+    // whole orbits change nothing, so an elliptical orbit only ever has to be moved by less than one period
+    double chi_high;
+    if (alpha > 1e-12)
+    {
+        double period = 2.0*Pi/(sqrt_mu * alpha * sqrt(alpha));
+        dt = dt - period * floor(dt/period);
+        chi_high = 2.0*Pi/sqrt(alpha);
+    }
+    else
+        chi_high = 0.0;
+
+    // t(chi) - dt, which only ever increases with chi since its derivative is the radius
+    double chi_low = 0.0, F, dF;
+    auto kepler = [&](double chi){
+        double z = alpha*chi*chi;
+        double C = stumpffC(z), S = stumpffS(z);
+        F = rv0*chi*chi*C + (1.0 - alpha*r0)*chi*chi*chi*S + r0*chi - sqrt_mu*dt;
+        dF = rv0*chi*(1.0 - z*S) + (1.0 - alpha*r0)*chi*chi*C + r0;
+    };
+
+    // open ended on a parabola or hyperbola, so double the top of the bracket until it holds the answer
+    if (chi_high == 0.0)
+    {
+        chi_high = sqrt_mu * dt/r0;
+        for (kepler(chi_high); F < 0.0; kepler(chi_high))
+            chi_high *= 2.0;
+    }
+
+    double chi = (alpha > 1e-12) ? sqrt_mu * alpha * dt : sqrt_mu * dt/r0;
+    chi = std::min(std::max(chi, chi_low), chi_high);
+
+    for (int iteration = 0; iteration < 100; iteration++)
+    {
+        kepler(chi);
+        if (F < 0.0)
+            chi_low = chi;
+        else
+            chi_high = chi;
+
+        // Newton, falling back on bisection whenever it would leave the bracket
+        double next = chi - F/dF;
+        if (!(next > chi_low && next < chi_high))
+            next = 0.5*(chi_low + chi_high);
+
+        double change = std::abs(next - chi);
+        chi = next;
+        if (change < 1e-13 * std::max(1.0, chi))
+            break;
+    }
+
+    // Lagrange coefficients
+    double z = alpha*chi*chi;
+    double C = stumpffC(z), S = stumpffS(z);
+    double f = 1.0 - chi*chi/r0 * C;
+    double g = dt - chi*chi*chi/sqrt_mu * S;
+
+    double new_pos[2] = {f*pos[0] + g*vel[0], f*pos[1] + g*vel[1]};
+    double r = MagOfVector(new_pos[0], new_pos[1]);
+
+    double fdot = sqrt_mu/(r*r0) * (alpha*chi*chi*chi*S - chi);
+    double gdot = 1.0 - chi*chi/r * C;
+
+    double new_vel[2] = {fdot*pos[0] + gdot*vel[0], fdot*pos[1] + gdot*vel[1]};
+
+    pos[0] = new_pos[0]; pos[1] = new_pos[1];
+    vel[0] = new_vel[0]; vel[1] = new_vel[1];
+}
+
+double timeToRadius(const double pos[2], const double vel[2], double radius){
+
+    double r = MagOfVector(pos[0], pos[1]);
+    double rv = pos[0]*vel[0] + pos[1]*vel[1];
+    double h = pos[0]*vel[1] - pos[1]*vel[0];
+    double alpha = 2.0/r - (vel[0]*vel[0] + vel[1]*vel[1])/EARTH_GM;
+    double e = sqrt(std::max(0.0, 1.0 - h*h*alpha/EARTH_GM));
+
+    if (e < 1e-12)
+        return (r <= radius) ? 0.0 : -1.0;
+
+    if (alpha > 0.0)
+    {
+        // ellipse: r = a(1 - e cos E), coming down while E runs from Pi to 2 Pi
+        double a = 1.0/alpha;
+        if (radius < a*(1.0 - e))
+            return -1.0;
+        if (radius >= a*(1.0 + e))
+            return 0.0;
+
+        double E0 = atan2(rv/(e*sqrt(EARTH_GM*a)), (1.0 - r/a)/e);
+        if (E0 < 0.0)
+            E0 += 2.0*Pi;
+        double E = 2.0*Pi - acos(std::min(1.0, std::max(-1.0, (1.0 - radius/a)/e)));
+
+        double dE = E - E0;
+        if (dE < 0.0)
+            dE += 2.0*Pi;
+        return sqrt(a*a*a/EARTH_GM) * (dE - e*(sin(E) - sin(E0)));
+    }
+
+    if (alpha < 0.0)
+    {
+        // hyperbola: r = -a(e cosh H - 1), coming down while H is negative
+        double a = -1.0/alpha;
+        if (radius < a*(e - 1.0))
+            return -1.0;
+
+        double H0 = asinh(rv/(e*sqrt(EARTH_GM*a)));
+        double H = -acosh((radius/a + 1.0)/e);
+        if (H0 >= H)
+            return (r <= radius) ? 0.0 : -1.0;
+        return sqrt(a*a*a/EARTH_GM) * ((e*sinh(H) - H) - (e*sinh(H0) - H0));
+    }
+
+    return -1.0;
+}
+
+bool secondStageCoasting(const SimulationContext &sim){
+
+    const RocketPart &SecondStage = sim.SecondStage;
+    double altitude = SecondStage.dist_to_earth - EARTH_RADIUS;
+
+    return (SecondStage.main_thrust[2] == 0.0) && (altitude > 0.0) && (sim.Atmosphere->density(altitude) == 0.0);
+}
+
+void coastSecondStage(SimulationContext &sim, double dt){
+
+    RocketPart &SecondStage = sim.SecondStage;
+
+    double pos[2] = {SecondStage.pos_cm[0], SecondStage.pos_cm[1] + EARTH_RADIUS};
+    propagateKepler(pos, SecondStage.vel_cm, dt);
+    SecondStage.pos_cm[0] = pos[0];
+    SecondStage.pos_cm[1] = pos[1] - EARTH_RADIUS;
+
+    SecondStage.dist_to_earth = MagOfVector(pos[0], pos[1]);
+    double grav_magnitude = EARTH_GM * SecondStage.mass/(SecondStage.dist_to_earth*SecondStage.dist_to_earth);
+    SecondStage.gravity[0] = - grav_magnitude * pos[0]/SecondStage.dist_to_earth;
+    SecondStage.gravity[1] = - grav_magnitude * pos[1]/SecondStage.dist_to_earth;
+    SecondStage.main_thrust[0] = 0.0; SecondStage.main_thrust[1] = 0.0;
+
+    SecondStage.part_top[0] = (SecondStage.part_height/2.0)*cos(SecondStage.theta) + SecondStage.pos_cm[0];
+    SecondStage.part_top[1] = (SecondStage.part_height/2.0)*sin(SecondStage.theta) + SecondStage.pos_cm[1];
+    SecondStage.part_bottom[0] = (SecondStage.part_height/2.0)*cos(SecondStage.theta + Pi) + SecondStage.pos_cm[0];
+    SecondStage.part_bottom[1] = (SecondStage.part_height/2.0)*sin(SecondStage.theta + Pi) + SecondStage.pos_cm[1];
+}
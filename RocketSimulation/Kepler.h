@@ -0,0 +1,31 @@
+/* Author: William Bryk
+
+ Closed-form two-body motion for the second stage once it is coasting.
+
+ With the tank dry and no air around it, the only force left on the second stage is the Earth's point-mass
+ gravity, so its path is a conic and it can be moved to any later time in one go (universal variables,
+ solved for with a safeguarded Newton iteration) instead of Euler step by Euler step. The cost is the same for
+ a millisecond as for a week, and there is no drift to build up.
+
+ Positions and velocities here are measured from the center of the Earth, so y is pos_cm[1] + EARTH_RADIUS.
+ */
+
+#ifndef ROCKETSIMULATION_KEPLER_H
+#define ROCKETSIMULATION_KEPLER_H
+
+#include "Simulation.h"
+
+// same GM as the gravity in getSecStagePosition()
+const double EARTH_GM = 3.98588e14;
+
+// move pos and vel along their orbit by dt seconds
+void propagateKepler(double pos[2], double vel[2], double dt);
+
+// time until the orbit next comes down through radius, or -1 when it never does
+double timeToRadius(const double pos[2], const double vel[2], double radius);
+
+// true when the second stage is out of fuel and above the atmosphere, so getSecStagePosition() can hand off to coastSecondStage()
+bool secondStageCoasting(const SimulationContext &sim);
+void coastSecondStage(SimulationContext &sim, double dt);
+
+#endif
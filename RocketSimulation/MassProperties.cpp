@@ -0,0 +1,45 @@
+/* Author: William Bryk
+
+ See MassProperties.h.
+ */
+
+#include "MassProperties.h"
+#include "Vehicle.h"
+
+void MassTable::build(const VehicleConfig &vehicle, bool detached, int cells){
+
+    Cells = cells;
+    Coefficients.resize(8 * cells);
+    FuelMass = vehicle.BoosterFuelMass;
+
+    double unused_cm, unused_moment;
+    massProperties(vehicle, detached, 0.0, DryMass, unused_cm, unused_moment);
+
+    // Hermite cubic through the value and slope at each end of the cell, slopes by central difference
+    const double width = 1.0/cells, d = 1e-6;
+    for (int i = 0; i < cells; i++)
+    {
+        double f[2] = {i * width, (i + 1) * width};
+        double value[2][2], slope[2][2];
+
+        for (int end = 0; end < 2; end++)
+        {
+            double mass, cm_low, moment_low, cm_high, moment_high;
+            massProperties(vehicle, detached, f[end], mass, value[end][0], value[end][1]);
+            massProperties(vehicle, detached, f[end] - d, mass, cm_low, moment_low);
+            massProperties(vehicle, detached, f[end] + d, mass, cm_high, moment_high);
+            slope[end][0] = width * (cm_high - cm_low)/(2.0 * d);
+            slope[end][1] = width * (moment_high - moment_low)/(2.0 * d);
+        }
+
+        for (int q = 0; q < 2; q++)
+        {
+            double y0 = value[0][q], y1 = value[1][q], m0 = slope[0][q], m1 = slope[1][q];
+            double *c = &Coefficients[8*i + 4*q];
+            c[0] = y0;
+            c[1] = m0;
+            c[2] = 3.0*(y1 - y0) - 2.0*m0 - m1;
+            c[3] = 2.0*(y0 - y1) + m0 + m1;
+        }
+    }
+}
@@ -0,0 +1,57 @@
+/* Author: William Bryk
+
+ Cached mass properties of the booster.
+
+ Mass, cm_location and MomentofInertia only depend on the vehicle, the fuel load and on whether the second
+ stage is still attached, so rather than working them out from scratch every step (a dozen pow() calls in
+ massProperties()) they are tabulated once per configuration of each vehicle over the fuel fraction and
+ interpolated. The tables live on the VehicleConfig, see Vehicle.h.
+ */
+
+#ifndef ROCKETSIMULATION_MASSPROPERTIES_H
+#define ROCKETSIMULATION_MASSPROPERTIES_H
+
+#include "Simulation.h"
+#include <vector>
+
+class MassProperties
+{
+public:
+    double mass;
+    double cm_location;
+    double MomentofInertia;
+};
+
+// massProperties() for one configuration, sampled at cells + 1 evenly spaced fuel loads from empty to full
+class MassTable
+{
+public:
+    MassTable() : Cells(0), DryMass(0.0), FuelMass(0.0) {}
+
+    void build(const VehicleConfig &vehicle, bool detached, int cells);
+
+    MassProperties at(double fuel_percentage) const {
+        double x = fuel_percentage * Cells;
+        int i = (int) x;
+        if (i < 0)
+            i = 0;
+        else if (i > Cells - 1)
+            i = Cells - 1;
+        double t = x - i;   // a little outside [0, 1] just extends the end cell
+
+        const double *c = &Coefficients[8*i];
+        MassProperties p;
+        p.mass = DryMass + FuelMass * fuel_percentage;
+        p.cm_location = ((c[3]*t + c[2])*t + c[1])*t + c[0];
+        p.MomentofInertia = ((c[7]*t + c[6])*t + c[5])*t + c[4];
+        return p;
+    }
+
+private:
+    int Cells;
+    double DryMass;
+    double FuelMass;
+    std::vector<double> Coefficients;   // cubics for cm_location then MomentofInertia, in powers of the fraction across the cell
+};
+
+#endif
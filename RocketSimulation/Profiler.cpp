@@ -0,0 +1,133 @@
+/* Author: William Bryk
+
+ See Profiler.h.
+ */
+
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
+
+FrameProfiler::FrameProfiler(int window) : Window(window > 0 ? window : 1), FrameCount(0), Epoch(Clock::now()), Tracing(false) {
+}
+
+int FrameProfiler::findPhase(const char *name){
+
+    for (size_t i = 0; i < Phases.size(); i++)
+        if ((Phases[i].Name == name) || !strcmp(Phases[i].Name, name))
+            return (int) i;
+
+    Phase phase;
+    phase.Name = name;
+    phase.Frames.assign(Window, 0.0);
+    phase.Samples = 0;
+    phase.ThisFrame = 0.0;
+    Phases.push_back(phase);
+    return (int) Phases.size() - 1;
+}
+
+void FrameProfiler::begin(const char *phase){
+
+    OpenPhase open;
+    open.Phase = findPhase(phase);
+    open.Start = Clock::now();
+    Open.push_back(open);
+}
+
+void FrameProfiler::end(){
+
+    if (Open.empty())
+        return;
+
+    Clock::time_point now = Clock::now();
+    const OpenPhase &open = Open.back();
+
+    double ms = std::chrono::duration<double, std::milli>(now - open.Start).count();
+    Phases[open.Phase].ThisFrame += ms;
+
+    if (Tracing && (Trace.size() < MaxTraceEvents))
+    {
+        TraceEvent event;
+        event.Phase = open.Phase;
+        event.Start = std::chrono::duration<double, std::micro>(open.Start - Epoch).count();
+        event.Duration = 1000.0 * ms;
+        Trace.push_back(event);
+    }
+
+    Open.pop_back();
+}
+
+void FrameProfiler::endFrame(){
+
+    // anything left open is closed along with the frame
+    while (!Open.empty())
+        end();
+
+    // each phase has its own place in its ring, so one first seen part way through fills from the start
+    for (size_t i = 0; i < Phases.size(); i++)
+    {
+        Phases[i].Frames[Phases[i].Samples % Window] = Phases[i].ThisFrame;
+        Phases[i].Samples++;
+        Phases[i].ThisFrame = 0.0;
+    }
+    FrameCount++;
+}
+
+double FrameProfiler::percentile(const char *phase, double p) const{
+
+    for (size_t i = 0; i < Phases.size(); i++)
+    {
+        if ((Phases[i].Name != phase) && strcmp(Phases[i].Name, phase))
+            continue;
+
+        // only the frames since the phase turned up, not the zeros its ring started with
+        long long frames = std::min<long long>(Phases[i].Samples, Window);
+        if (frames == 0)
+            return 0.0;
+
+        std::vector<double> times(Phases[i].Frames.begin(), Phases[i].Frames.begin() + frames);
+        size_t k = std::min<size_t>(frames - 1, (size_t) (p/100.0 * frames));
+        std::nth_element(times.begin(), times.begin() + k, times.end());
+        return times[k];
+    }
+    return 0.0;
+}
+
+void FrameProfiler::printSummary(FILE *out) const{
+
+    fprintf(out, "%-16s %10s %10s   (ms per frame over the last %lld frames)\n", "phase", "p50", "p99", std::min<long long>(FrameCount, Window));
+    for (size_t i = 0; i < Phases.size(); i++)
+        fprintf(out, "%-16s %10.3f %10.3f\n", Phases[i].Name, percentile(Phases[i].Name, 50.0), percentile(Phases[i].Name, 99.0));
+}
+
+void FrameProfiler::startTrace(){
+    Trace.clear();
+    Tracing = true;
+}
+
+bool FrameProfiler::stopTrace(const char *path, std::string &error){
+
+    Tracing = false;
+
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        error = std::string("could not open ") + path;
+        return false;
+    }
+
+    // complete ("X") events, which the viewers nest by time on the one thread
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for (size_t i = 0; i < Trace.size(); i++)
+        fprintf(file, "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": %.3f, \"dur\": %.3f}%s\n",
+                Phases[Trace[i].Phase].Name, Trace[i].Start, Trace[i].Duration, (i + 1 < Trace.size()) ? "," : "");
+    fprintf(file, "]}\n");
+
+    bool ok = !ferror(file);
+    if (fclose(file) || !ok)
+    {
+        error = std::string("could not write ") + path;
+        return false;
+    }
+    Trace.clear();
+    return true;
+}
@@ -0,0 +1,114 @@
+/* Author: William Bryk
+
+ Timing of the phases of a frame.
+
+ Draw() opens a ProfileFrame for the frame and a ProfileScope for each phase in it, which may nest; each
+ calls begin()/end() (or beginFrame()/endFrame()) for the block it is in, so no return can leave a phase
+ open. The profiler keeps the time spent in every phase over the last Window frames it was seen in, for
+ rolling p50/p99s, and while a trace is running it also keeps every phase of every frame so it can be
+ written out as a Chrome trace (open it in chrome://tracing or ui.perfetto.dev).
+
+ The times are CPU times on the drawing thread. OpenGL queues most of its work, so what a texture bind or a
+ glBegin costs on the GPU mostly turns up in "swap".
+
+ Phase names are compared by pointer first, so pass string literals.
+ */
+
+#ifndef ROCKETSIMULATION_PROFILER_H
+#define ROCKETSIMULATION_PROFILER_H
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class FrameProfiler
+{
+public:
+    explicit FrameProfiler(int window = 300);
+
+    void beginFrame() { begin("frame"); }
+    void endFrame();
+
+    void begin(const char *phase);
+    void end();
+
+    // the p-th percentile (0-100) of the time spent in phase per frame, in ms, over the last Window frames
+    double percentile(const char *phase, double p) const;
+    void printSummary(FILE *out) const;
+
+    void startTrace();
+    // write the trace as Chrome trace JSON and stop, false with a message if the file can't be written
+    bool stopTrace(const char *path, std::string &error);
+    bool isTracing() const { return Tracing; }
+
+    size_t MaxTraceEvents = 1000000;    // past this the trace just stops growing
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    class Phase
+    {
+    public:
+        const char *Name;
+        std::vector<double> Frames;     // ms in each of the last Window frames, a ring
+        long long Samples;              // frames since the phase was first seen, the ring holds the last Window
+        double ThisFrame;
+    };
+
+    class OpenPhase
+    {
+    public:
+        int Phase;
+        Clock::time_point Start;
+    };
+
+    class TraceEvent
+    {
+    public:
+        int Phase;
+        double Start;       // us since the profiler was made
+        double Duration;    // us
+    };
+
+    int findPhase(const char *name);
+
+    int Window;
+    long long FrameCount;
+    std::vector<Phase> Phases;
+    std::vector<OpenPhase> Open;
+
+    Clock::time_point Epoch;
+    bool Tracing;
+    std::vector<TraceEvent> Trace;
+};
+
+// the phase runs from here to the end of the block
+class ProfileScope
+{
+public:
+    ProfileScope(FrameProfiler &profiler, const char *phase) : Profiler(profiler) { Profiler.begin(phase); }
+    ~ProfileScope() { Profiler.end(); }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+    FrameProfiler &Profiler;
+};
+
+// the same for a whole frame
+class ProfileFrame
+{
+public:
+    explicit ProfileFrame(FrameProfiler &profiler) : Profiler(profiler) { Profiler.beginFrame(); }
+    ~ProfileFrame() { Profiler.endFrame(); }
+
+    ProfileFrame(const ProfileFrame &) = delete;
+    ProfileFrame &operator=(const ProfileFrame &) = delete;
+
+private:
+    FrameProfiler &Profiler;
+};
+
+#endif
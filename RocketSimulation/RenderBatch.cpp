@@ -0,0 +1,219 @@
+/* Author: William Bryk
+
+ See RenderBatch.h.
+ */
+
+#include "RenderBatch.h"
+#include "Simulation.h"
+#include <algorithm>
+#include <cmath>
+
+RenderBatch::RenderBatch() : Texture(0), PointSize(1.0f), LineWidth(1.0f), Buffer(0), BufferSize(0) {
+    Origin[0] = Origin[1] = 0.0;
+    Color[0] = Color[1] = Color[2] = Color[3] = 255;
+}
+
+RenderBatch::~RenderBatch(){
+    if (Buffer)
+        glDeleteBuffers(1, &Buffer);
+}
+
+void RenderBatch::begin(double origin_x, double origin_y){
+
+    Origin[0] = origin_x;
+    Origin[1] = origin_y;
+    Vertices.clear();
+    Runs.clear();
+
+    Color[0] = Color[1] = Color[2] = Color[3] = 255;
+    Texture = 0;
+    PointSize = LineWidth = 1.0f;
+}
+
+static unsigned char colorByte(double c){
+    return (unsigned char) (255.0 * std::max(0.0, std::min(1.0, c)) + 0.5);
+}
+
+void RenderBatch::setColor(double r, double g, double b){
+    Color[0] = colorByte(r);
+    Color[1] = colorByte(g);
+    Color[2] = colorByte(b);
+}
+
+void RenderBatch::setTexture(GLuint texture){
+    Texture = texture;
+}
+
+void RenderBatch::setPointSize(float size){
+    PointSize = size;
+}
+
+void RenderBatch::setLineWidth(float width){
+    LineWidth = width;
+}
+
+void RenderBatch::add(GLenum mode, double x, double y, double u, double v){
+
+    // lines and points aren't textured, and only they care about the size
+    GLuint texture = (mode == GL_TRIANGLES) ? Texture : 0;
+    float size = (mode == GL_POINTS) ? PointSize : ((mode == GL_LINES) ? LineWidth : 0.0f);
+
+    if (Runs.empty() || (Runs.back().Mode != mode) || (Runs.back().Texture != texture) || (Runs.back().Size != size))
+    {
+        Run run;
+        run.Mode = mode;
+        run.Texture = texture;
+        run.Size = size;
+        run.First = (GLint) Vertices.size();
+        run.Count = 0;
+        Runs.push_back(run);
+    }
+    Runs.back().Count++;
+
+    RenderVertex vertex;
+    vertex.x = (float) (x - Origin[0]);
+    vertex.y = (float) (y - Origin[1]);
+    vertex.u = (float) u;
+    vertex.v = (float) v;
+    vertex.r = Color[0];
+    vertex.g = Color[1];
+    vertex.b = Color[2];
+    vertex.a = Color[3];
+    Vertices.push_back(vertex);
+}
+
+void RenderBatch::point(double x, double y){
+    add(GL_POINTS, x, y, 0.0, 0.0);
+}
+
+void RenderBatch::line(double x0, double y0, double x1, double y1){
+    add(GL_LINES, x0, y0, 0.0, 0.0);
+    add(GL_LINES, x1, y1, 0.0, 0.0);
+}
+
+void RenderBatch::triangle(const double x[3], const double y[3], const double u[3], const double v[3]){
+    for (int i = 0; i < 3; i++)
+        add(GL_TRIANGLES, x[i], y[i], u[i], v[i]);
+}
+
+void RenderBatch::quad(const double x[4], const double y[4], const double u[4], const double v[4]){
+    const int corners[6] = {0, 1, 2, 0, 2, 3};
+    for (int i = 0; i < 6; i++)
+        add(GL_TRIANGLES, x[corners[i]], y[corners[i]], u[corners[i]], v[corners[i]]);
+}
+
+void RenderBatch::quad(const double x[4], const double y[4]){
+    const double none[4] = {0.0, 0.0, 0.0, 0.0};
+    quad(x, y, none, none);
+}
+
+void RenderBatch::partQuad(const RocketPart &part, double u0, double u1, double v0, double v1){
+
+    // half the width across the part, worked out once for all four corners
+    double across_x = (part.part_width/2.0)*sin(part.theta);
+    double across_y = (part.part_width/2.0)*cos(part.theta);
+
+    double x[4] = {part.part_bottom[0] - across_x, part.part_bottom[0] + across_x, part.part_top[0] + across_x, part.part_top[0] - across_x};
+    double y[4] = {part.part_bottom[1] + across_y, part.part_bottom[1] - across_y, part.part_top[1] - across_y, part.part_top[1] + across_y};
+    double u[4] = {u0, u1, u1, u0};
+    double v[4] = {v0, v0, v1, v1};
+    quad(x, y, u, v);
+}
+
+void RenderBatch::draw(){
+
+    if (Vertices.empty())
+        return;
+
+    if (!Buffer)
+        glGenBuffers(1, &Buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+
+    // a fresh store every frame, so the driver never waits on the card to finish with last frame's
+    size_t bytes = Vertices.size() * sizeof(RenderVertex);
+    if (bytes > BufferSize)
+        BufferSize = std::max(bytes, 2 * BufferSize);
+    glBufferData(GL_ARRAY_BUFFER, BufferSize, 0, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, Vertices.data());
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(RenderVertex), (const GLvoid *) offsetof(RenderVertex, x));
+    glTexCoordPointer(2, GL_FLOAT, sizeof(RenderVertex), (const GLvoid *) offsetof(RenderVertex, u));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(RenderVertex), (const GLvoid *) offsetof(RenderVertex, r));
+
+    GLuint bound = 0;
+    for (size_t i = 0; i < Runs.size(); i++)
+    {
+        const Run &run = Runs[i];
+
+        if (run.Texture != bound)
+        {
+            if (run.Texture)
+            {
+                glEnable(GL_TEXTURE_2D);
+                glBindTexture(GL_TEXTURE_2D, run.Texture);
+            }
+            else
+                glDisable(GL_TEXTURE_2D);
+            bound = run.Texture;
+        }
+        if (run.Mode == GL_POINTS)
+            glPointSize(run.Size);
+        else if (run.Mode == GL_LINES)
+            glLineWidth(run.Size);
+
+        glDrawArrays(run.Mode, run.First, run.Count);
+    }
+
+    glDisable(GL_TEXTURE_2D);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+PointField::PointField() : Size(1.0f), Buffer(0), Uploaded(false) {
+    Color[0] = Color[1] = Color[2] = 1.0;
+}
+
+PointField::~PointField(){
+    if (Buffer)
+        glDeleteBuffers(1, &Buffer);
+}
+
+void PointField::setPoints(const std::vector<float> &xy){
+    Points = xy;
+    Uploaded = false;
+}
+
+void PointField::draw(double offset_x, double offset_y, double scale_x, double scale_y){
+
+    if (Points.empty())
+        return;
+
+    if (!Buffer)
+        glGenBuffers(1, &Buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+    if (!Uploaded)
+    {
+        glBufferData(GL_ARRAY_BUFFER, Points.size() * sizeof(float), Points.data(), GL_STATIC_DRAW);
+        Uploaded = true;
+    }
+
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glTranslated(offset_x, offset_y, 0.0);
+    glScaled(scale_x, scale_y, 1.0);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, 0);
+    glColor3d(Color[0], Color[1], Color[2]);
+    glPointSize(Size);
+    glDrawArrays(GL_POINTS, 0, (GLsizei) size());
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    glPopMatrix();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,120 @@
+/* Author: William Bryk
+
+ Retained drawing for the viewer.
+
+ Instead of a glBegin/glEnd block per shape, Draw() adds every shape of the frame to a RenderBatch and then
+ draws the batch: all the vertices go to the card in one vertex buffer upload, and every run of shapes
+ sharing a primitive type, texture and point/line size is one glDrawArrays. Shapes are drawn in the order
+ they were added, so the painter's order of the old code still holds.
+
+ Vertices are stored as floats relative to Origin, which the camera should sit on (see begin()). That keeps
+ a rocket hundreds of kilometers downrange as sharp as one on the pad.
+
+ A PointField is the other way round: points that never change, like the stars, uploaded to the card once
+ and then drawn every frame with one call, moved and stretched into place by the modelview matrix. Drawing
+ it costs the CPU the same whether it has eighty points or eighty thousand.
+ */
+
+#ifndef ROCKETSIMULATION_RENDERBATCH_H
+#define ROCKETSIMULATION_RENDERBATCH_H
+
+#ifdef __APPLE__
+#include <OpenGL/gl.h>
+#else
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES
+#endif
+#include <GL/gl.h>
+#endif
+#include <cstddef>
+#include <vector>
+
+class RenderVertex
+{
+public:
+    float x, y;
+    float u, v;
+    unsigned char r, g, b, a;
+};
+
+class RocketPart;
+
+class RenderBatch
+{
+public:
+    RenderBatch();
+    ~RenderBatch();
+
+    // start a new frame with everything measured from (origin_x, origin_y)
+    void begin(double origin_x, double origin_y);
+    // upload the frame's vertices and draw them
+    void draw();
+
+    // state for the shapes added after it, like glColor and friends
+    void setColor(double r, double g, double b);
+    void setTexture(GLuint texture);        // 0 for none
+    void setPointSize(float size);
+    void setLineWidth(float width);
+
+    void point(double x, double y);
+    void line(double x0, double y0, double x1, double y1);
+    void triangle(const double x[3], const double y[3], const double u[3], const double v[3]);
+    // corners in order around the quad, drawn as two triangles
+    void quad(const double x[4], const double y[4], const double u[4], const double v[4]);
+    void quad(const double x[4], const double y[4]);
+
+    // a part drawn as a textured rectangle part_width wide from part_bottom to part_top, taking its
+    // texture from [u0, u1] across and [v0, v1] from bottom to top
+    void partQuad(const RocketPart &part, double u0, double u1, double v0, double v1);
+
+    size_t vertexCount() const { return Vertices.size(); }
+    size_t drawCalls() const { return Runs.size(); }
+
+private:
+    class Run
+    {
+    public:
+        GLenum Mode;
+        GLuint Texture;
+        float Size;         // point size or line width
+        GLint First;
+        GLsizei Count;
+    };
+
+    void add(GLenum mode, double x, double y, double u, double v);
+
+    double Origin[2];
+    std::vector<RenderVertex> Vertices;
+    std::vector<Run> Runs;
+
+    unsigned char Color[4];
+    GLuint Texture;
+    float PointSize, LineWidth;
+
+    GLuint Buffer;
+    size_t BufferSize;      // bytes the buffer has room for
+};
+
+class PointField
+{
+public:
+    PointField();
+    ~PointField();
+
+    // replace the points, x0 y0 x1 y1 ..., which go to the card on the next draw
+    void setPoints(const std::vector<float> &xy);
+    // every point at offset + scale * point, in one call
+    void draw(double offset_x, double offset_y, double scale_x, double scale_y);
+
+    size_t size() const { return Points.size()/2; }
+
+    double Color[3];
+    float Size;
+
+private:
+    std::vector<float> Points;
+    GLuint Buffer;
+    bool Uploaded;
+};
+
+#endif
@@ -0,0 +1,352 @@
+/* Author: William Bryk
+
+ See Replay.h.
+ */
+
+#include "Replay.h"
+#include "Snapshot.h"
+#include <algorithm>
+#include <cstring>
+
+const char REPLAY_MAGIC[8] = {'F', '9', 'R', 'P', 'L', 'v', '2', '\0'};
+
+// entry tags
+const char REPLAY_KEYFRAME = 'K';
+const char REPLAY_ACTION = 'A';
+const char REPLAY_STEP_SIZE = 'D';
+
+class ReplayHeader
+{
+public:
+    char magic[8];
+    uint32_t part_size;         // sizeof(RocketPart), keyframe snapshots hold the parts as they are in memory
+    uint32_t flags;             // unused
+    uint64_t index_offset;      // 0 until close(), a replay that was never closed is indexed by reading it through
+    uint64_t step_count;
+};
+
+// keyframes are snapshots, see Snapshot.h
+static void writeState(FILE *file, const SimulationContext &sim){
+
+    SimulationSnapshot snapshot;
+    saveSnapshot(sim, snapshot);
+
+    uint32_t size = snapshot.Bytes.size();
+    fwrite(&size, sizeof(size), 1, file);
+    fwrite(snapshot.Bytes.data(), 1, size, file);
+}
+
+// everything but the viewer's own switches, which stay as the viewer has them
+static bool readState(FILE *file, SimulationContext &sim){
+
+    SimulationSnapshot snapshot;
+    uint32_t size;
+    if ((fread(&size, sizeof(size), 1, file) != 1) || (size > 65536))
+        return false;
+    snapshot.Bytes.resize(size);
+    if (fread(snapshot.Bytes.data(), 1, size, file) != size)
+        return false;
+
+    switches CheckList = sim.CheckList;
+    std::string error;
+    if (!restoreSnapshot(snapshot, sim, error))
+        return false;
+
+    sim.CheckList.ZoomOut = CheckList.ZoomOut;
+    sim.CheckList.WelcomeScreen = CheckList.WelcomeScreen;
+    sim.CheckList.Paused = CheckList.Paused;
+    return true;
+}
+
+ReplayRecorder::ReplayRecorder() : File(0), Steps(0), SinceKeyframe(0), StepSize(0.0) {
+}
+
+ReplayRecorder::~ReplayRecorder(){
+    close();
+}
+
+bool ReplayRecorder::open(const char *path, const SimulationContext &sim, std::string &error){
+
+    close();
+
+    File = fopen(path, "wb");
+    if (!File)
+    {
+        error = std::string("could not open ") + path;
+        return false;
+    }
+
+    // filled in properly by close()
+    ReplayHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+    header.part_size = sizeof(RocketPart);
+    fwrite(&header, sizeof(header), 1, File);
+
+    Steps = 0;
+    StepSize = sim.DeltaT;
+    Index.clear();
+    keyframe(sim);
+    return true;
+}
+
+void ReplayRecorder::close(){
+
+    if (!File)
+        return;
+
+    ReplayHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+    header.part_size = sizeof(RocketPart);
+    header.index_offset = ftell(File);
+    header.step_count = Steps;
+
+    uint64_t count = Index.size();
+    fwrite(&count, sizeof(count), 1, File);
+    fwrite(Index.data(), sizeof(ReplayIndexEntry), Index.size(), File);
+
+    fseek(File, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, File);
+    fclose(File);
+    File = 0;
+}
+
+void ReplayRecorder::keyframe(const SimulationContext &sim){
+
+    if (!File)
+        return;
+
+    ReplayIndexEntry entry;
+    entry.Time = sim.SimulationTime;
+    entry.Step = Steps;
+    entry.Offset = ftell(File);
+    Index.push_back(entry);
+
+    fputc(REPLAY_KEYFRAME, File);
+    fwrite(&Steps, sizeof(Steps), 1, File);
+    fwrite(&StepSize, sizeof(StepSize), 1, File);
+    writeState(File, sim);
+
+    SinceKeyframe = 0;
+}
+
+void ReplayRecorder::stepped(const SimulationContext &sim, double dt){
+
+    if (!File)
+        return;
+
+    // the step size change goes in ahead of the step that used it
+    if (dt != StepSize)
+    {
+        StepSize = dt;
+        fputc(REPLAY_STEP_SIZE, File);
+        fwrite(&Steps, sizeof(Steps), 1, File);
+        fwrite(&StepSize, sizeof(StepSize), 1, File);
+    }
+
+    Steps++;
+    if (++SinceKeyframe >= (uint64_t) KeyframeInterval)
+        keyframe(sim);
+}
+
+void ReplayRecorder::action(TimelineAction action){
+
+    if (!File)
+        return;
+
+    int32_t code = action;
+    fputc(REPLAY_ACTION, File);
+    fwrite(&Steps, sizeof(Steps), 1, File);
+    fwrite(&code, sizeof(code), 1, File);
+}
+
+ReplayPlayer::ReplayPlayer() : File(0), EndOfEntries(0), StepCount(0), EndTime(0.0), CursorValid(false), CursorOffset(0), CursorStep(0), CursorStepSize(0.0), CursorTime(0.0) {
+}
+
+ReplayPlayer::~ReplayPlayer(){
+    close();
+}
+
+void ReplayPlayer::close(){
+
+    if (File)
+        fclose(File);
+    File = 0;
+    Index.clear();
+    CursorValid = false;
+}
+
+bool ReplayPlayer::open(const char *path, const VehicleConfig &vehicle, std::string &error){
+
+    close();
+
+    File = fopen(path, "rb");
+    if (!File)
+    {
+        error = std::string("could not open ") + path;
+        return false;
+    }
+
+    ReplayHeader header;
+    if ((fread(&header, sizeof(header), 1, File) != 1) || memcmp(header.magic, REPLAY_MAGIC, sizeof(header.magic)) || (header.part_size != sizeof(RocketPart)))
+    {
+        error = std::string(path) + " is not a replay this build can read";
+        close();
+        return false;
+    }
+
+    uint64_t count = 0;
+    if (header.index_offset)
+    {
+        EndOfEntries = header.index_offset;
+        StepCount = header.step_count;
+        fseek(File, (long) header.index_offset, SEEK_SET);
+        if (fread(&count, sizeof(count), 1, File) == 1)
+        {
+            Index.resize(count);
+            if (fread(Index.data(), sizeof(ReplayIndexEntry), count, File) != count)
+                Index.clear();
+        }
+    }
+
+    // never closed (or the index didn't read back): find the keyframes by walking the entries
+    if (Index.empty())
+    {
+        fseek(File, sizeof(header), SEEK_SET);
+        StepCount = 0;
+        EndOfEntries = sizeof(header);
+        int tag;
+        uint64_t step;
+        while (((tag = fgetc(File)) != EOF) && (fread(&step, sizeof(step), 1, File) == 1))
+        {
+            bool complete;
+            if (tag == REPLAY_KEYFRAME)
+            {
+                ReplayIndexEntry entry;
+                entry.Step = step;
+                entry.Offset = EndOfEntries;
+                SimulationContext state(vehicle);
+                double step_size;
+                complete = (fread(&step_size, sizeof(step_size), 1, File) == 1) && readState(File, state);
+                entry.Time = state.SimulationTime;
+                if (complete)
+                    Index.push_back(entry);
+            }
+            else if (tag == REPLAY_ACTION)
+            {
+                int32_t code;
+                complete = (fread(&code, sizeof(code), 1, File) == 1);
+            }
+            else if (tag == REPLAY_STEP_SIZE)
+            {
+                double step_size;
+                complete = (fread(&step_size, sizeof(step_size), 1, File) == 1);
+            }
+            else
+                complete = false;
+
+            // anything cut short, or past the entries (an index written over the header's back), ends them
+            if (!complete)
+                break;
+            EndOfEntries = ftell(File);
+            StepCount = std::max(StepCount, step);
+        }
+    }
+
+    if (Index.empty())
+    {
+        error = std::string(path) + " has no keyframes";
+        close();
+        return false;
+    }
+
+    // the end time is wherever the last step lands, which is only a keyframe interval of steps to find out
+    SimulationContext sim(vehicle);
+    seek(sim, 1e300);
+    EndTime = sim.SimulationTime;
+    return true;
+}
+
+bool ReplayPlayer::loadKeyframe(SimulationContext &sim, size_t keyframe){
+
+    const ReplayIndexEntry &entry = Index[keyframe];
+    fseek(File, (long) entry.Offset + 1 + sizeof(uint64_t), SEEK_SET);
+    if ((fread(&CursorStepSize, sizeof(double), 1, File) != 1) || !readState(File, sim))
+        return false;
+
+    CursorOffset = ftell(File);
+    CursorStep = entry.Step;
+    CursorTime = sim.SimulationTime;
+    CursorValid = true;
+    return true;
+}
+
+void ReplayPlayer::seek(SimulationContext &sim, double t){
+
+    if (Index.empty())
+        return;
+
+    // last keyframe at or before t
+    size_t keyframe = std::upper_bound(Index.begin(), Index.end(), t, [](double time, const ReplayIndexEntry &entry) { return time < entry.Time; }) - Index.begin();
+    keyframe = (keyframe > 0) ? keyframe - 1 : 0;
+
+    // carry on from the last seek if sim is still where it left off and no keyframe nearer t lies in between
+    bool carry_on = CursorValid && (sim.SimulationTime == CursorTime) && (CursorTime <= t) && (CursorStep >= Index[keyframe].Step);
+    if (!carry_on && !loadKeyframe(sim, keyframe))
+        return;
+
+    sim.Telemetry = 0;
+    sim.Replay = 0;
+    fseek(File, (long) CursorOffset, SEEK_SET);
+
+    while (true)
+    {
+        // next entry, or a pretend one past the last step at the end of the entries
+        long offset = ftell(File);
+        int tag = EOF;
+        uint64_t entry_step = StepCount;
+        if ((uint64_t) offset < EndOfEntries)
+        {
+            tag = fgetc(File);
+            if (fread(&entry_step, sizeof(entry_step), 1, File) != 1)
+                tag = EOF, entry_step = StepCount;
+        }
+
+        // take the steps up to it that fit before t
+        while ((CursorStep < entry_step) && (sim.SimulationTime + CursorStepSize <= t + 1e-9))
+        {
+            step(sim, CursorStepSize);
+            CursorStep++;
+        }
+
+        if ((CursorStep < entry_step) || (tag == EOF))
+        {
+            // t falls before the entry, leave it for next time
+            CursorOffset = offset;
+            break;
+        }
+
+        if (tag == REPLAY_ACTION)
+        {
+            int32_t code;
+            if (fread(&code, sizeof(code), 1, File) == 1)
+                applyTimelineAction(sim, (TimelineAction) code);
+        }
+        else if (tag == REPLAY_STEP_SIZE)
+        {
+            if (fread(&CursorStepSize, sizeof(CursorStepSize), 1, File) != 1)
+                break;
+        }
+        else if (tag == REPLAY_KEYFRAME)
+        {
+            // the steps should have got here already, but the keyframe is the word on it
+            if ((fread(&CursorStepSize, sizeof(CursorStepSize), 1, File) != 1) || !readState(File, sim))
+                break;
+        }
+        else
+            break;
+    }
+
+    CursorTime = sim.SimulationTime;
+}
@@ -0,0 +1,97 @@
+/* Author: William Bryk
+
+ Recorded flights that can be reopened and scrubbed to any time.
+
+ A replay file doesn't store every step. It stores what went into the flight: a keyframe with the full state
+ every KeyframeInterval steps (and whenever something other than a control changes, like the integrator),
+ every control applied through applyTimelineAction() together with the step it came before, and the step
+ size whenever that changes. An index of keyframe times and file offsets goes on the end.
+
+ ReplayPlayer::seek() binary searches the index for the last keyframe at or before the time asked for,
+ loads it and re-simulates the few steps from there, applying the recorded controls on the same step they
+ were first applied. Playing forward just carries on from where the last seek left off.
+
+     header | entries (keyframe, control, step size) ... | index
+ */
+
+#ifndef ROCKETSIMULATION_REPLAY_H
+#define ROCKETSIMULATION_REPLAY_H
+
+#include "Simulation.h"
+#include "Timeline.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class ReplayIndexEntry
+{
+public:
+    double Time;            // SimulationTime of the keyframe
+    uint64_t Step;          // steps taken before it
+    uint64_t Offset;        // where its entry starts in the file
+};
+
+class ReplayRecorder
+{
+public:
+    int KeyframeInterval = 1000;    // steps, a second of flight at the viewer's physics rate
+
+    ReplayRecorder();
+    ~ReplayRecorder();
+
+    // start a replay at the current state of sim, false with a message if the file can't be written
+    bool open(const char *path, const SimulationContext &sim, std::string &error);
+    void close();
+    bool isOpen() const { return File != 0; }
+
+    // called by step() and applyTimelineAction() while sim.Replay is set
+    void stepped(const SimulationContext &sim, double dt);
+    void action(TimelineAction action);
+
+    // write the full state now, for changes that aren't controls
+    void keyframe(const SimulationContext &sim);
+
+private:
+    FILE *File;
+    uint64_t Steps;
+    uint64_t SinceKeyframe;
+    double StepSize;
+    std::vector<ReplayIndexEntry> Index;
+};
+
+class ReplayPlayer
+{
+public:
+    ReplayPlayer();
+    ~ReplayPlayer();
+
+    // vehicle is the one the replay was flown with, which seeking flies again
+    bool open(const char *path, const VehicleConfig &vehicle, std::string &error);
+    void close();
+
+    double startTime() const { return Index.empty() ? 0.0 : Index.front().Time; }
+    double endTime() const { return EndTime; }
+
+    // put sim in the recorded state at the last step at or before t. sim is cut loose from any recorders,
+    // a replay isn't a flight of its own
+    void seek(SimulationContext &sim, double t);
+
+private:
+    bool loadKeyframe(SimulationContext &sim, size_t keyframe);
+
+    FILE *File;
+    std::vector<ReplayIndexEntry> Index;
+    uint64_t EndOfEntries;          // offset of the index
+    uint64_t StepCount;
+    double EndTime;
+
+    // where the last seek left off, so playing forward doesn't go back to a keyframe
+    bool CursorValid;
+    uint64_t CursorOffset;
+    uint64_t CursorStep;
+    double CursorStepSize;
+    double CursorTime;
+};
+
+#endif
@@ -0,0 +1,321 @@
+/* Author: William Bryk
+
+ See RocketBatch.h.
+
+ The kernel follows getPosition() line for line, quirks included, with two changes that make it
+ vectorize: branches become selects, and the direction of the part is carried as a unit vector and
+ turned by a small-angle rotation each step instead of going through cos/sin/atan.
+ */
+
+#include "RocketBatch.h"
+#include "SimdDouble.h"
+#include "Atmosphere.h"
+#include "Vehicle.h"
+#include <cmath>
+
+const double GRAVITY_GM = 3.98588e14;
+
+RocketBatch::RocketBatch() : Atmosphere(&standardAtmosphere()) {}
+
+void RocketBatch::resize(int count){
+
+    std::vector<double> *columns[] = {
+        &pos_x, &pos_y, &vel_x, &vel_y, &theta, &omega, &dir_x, &dir_y, &fuel, &gimbal_beta, &thrust,
+        &air_x, &air_y, &thrust_x, &thrust_y, &nit_left, &nit_right,
+        &mass, &cm_location, &moment, &torque, &dist_to_earth, &air_density,
+        &engine_on, &gimbal_clock, &gimbal_count_clock, &rot_clock, &rot_count_clock, &gimbal_rate, &nit_thrust,
+        &part_height, &dry_mass, &dry_cm_moment, &cm_length, &own_inertia, &upper_mass, &upper_cm, &fairing_weight, &fairing_cm,
+        &octaweb_mass, &booster_mass, &booster_length, &booster_fuel_mass, &total_length, &nitrogen_height, &fuel_rate, &part_width
+    };
+
+    for (size_t i = 0; i < sizeof(columns)/sizeof(columns[0]); i++)
+        columns[i]->resize(count, 0.0);
+}
+
+void loadBatchControls(RocketBatch &batch, int lane, const switches &CheckList){
+
+    batch.engine_on[lane] = CheckList.rocketOn ? 1.0 : 0.0;
+    batch.gimbal_clock[lane] = CheckList.GimbalClock ? 1.0 : 0.0;
+    batch.gimbal_count_clock[lane] = CheckList.GimbalCountClock ? 1.0 : 0.0;
+    batch.rot_clock[lane] = CheckList.RotClock ? 1.0 : 0.0;
+    batch.rot_count_clock[lane] = CheckList.RotCountClock ? 1.0 : 0.0;
+}
+
+void loadBatchLane(RocketBatch &batch, int lane, const SimulationContext &sim){
+
+    const RocketPart &Falcon = sim.Falcon;
+    const VehicleConfig &vehicle = *sim.Vehicle;
+
+    batch.pos_x[lane] = Falcon.pos_cm[0];
+    batch.pos_y[lane] = Falcon.pos_cm[1];
+    batch.vel_x[lane] = Falcon.vel_cm[0];
+    batch.vel_y[lane] = Falcon.vel_cm[1];
+    batch.theta[lane] = Falcon.theta;
+    batch.omega[lane] = Falcon.omega;
+    batch.dir_x[lane] = cos(Falcon.theta);
+    batch.dir_y[lane] = sin(Falcon.theta);
+    batch.fuel[lane] = Falcon.FuelPercentage;
+    batch.gimbal_beta[lane] = Falcon.GimbalBeta;
+    batch.thrust[lane] = Falcon.main_thrust[2];
+
+    batch.air_x[lane] = Falcon.air_resistance[0];
+    batch.air_y[lane] = Falcon.air_resistance[1];
+    batch.thrust_x[lane] = Falcon.main_thrust[0];
+    batch.thrust_y[lane] = Falcon.main_thrust[1];
+    batch.nit_left[lane] = MagOfVector(Falcon.nit_thrust_left[0], Falcon.nit_thrust_left[1]);
+    batch.nit_right[lane] = MagOfVector(Falcon.nit_thrust_right[0], Falcon.nit_thrust_right[1]);
+
+    batch.mass[lane] = Falcon.mass;
+    batch.cm_location[lane] = Falcon.cm_location;
+    batch.moment[lane] = Falcon.MomentofInertia;
+    batch.torque[lane] = Falcon.torque;
+    batch.dist_to_earth[lane] = Falcon.dist_to_earth;
+    batch.air_density[lane] = sim.air_density;
+
+    loadBatchControls(batch, lane, sim.CheckList);
+    batch.gimbal_rate[lane] = Falcon.GimbalRate;
+    batch.nit_thrust[lane] = Falcon.nit_thrust_left[2];
+
+    batch.octaweb_mass[lane] = vehicle.OctawebMass;
+    batch.booster_mass[lane] = vehicle.BoosterMass;
+    batch.booster_length[lane] = vehicle.BoosterLength;
+    batch.booster_fuel_mass[lane] = vehicle.BoosterFuelMass;
+    batch.total_length[lane] = vehicle.TotalLength;
+    batch.nitrogen_height[lane] = vehicle.NitrogenHeight;
+    batch.fuel_rate[lane] = Falcon.main_thrust[2]/vehicle.ExhaustVelocity/vehicle.BoosterFuelMass;
+    batch.part_width[lane] = Falcon.part_width;
+
+    // the terms of updateMassAndMoment() that don't change with the fuel load
+    batch.part_height[lane] = Falcon.part_height;
+    if (!sim.CheckList.Detached)
+    {
+        batch.dry_mass[lane] = vehicle.OctawebMass + vehicle.BoosterMass + vehicle.SecondStageMass + vehicle.SecondStageFuelMass + vehicle.FairingMass;
+        batch.dry_cm_moment[lane] = vehicle.BoosterMass * vehicle.BoosterLength/2.0 +
+            (vehicle.SecondStageMass + vehicle.SecondStageFuelMass) * (vehicle.BoosterLength + vehicle.InterstageLength + vehicle.SecondStageLength/2.0) +
+            vehicle.FairingMass * (vehicle.BoosterLength + vehicle.InterstageLength + vehicle.SecondStageLength + vehicle.FairingLength/2.0);
+        batch.cm_length[lane] = vehicle.TotalLength;
+        batch.own_inertia[lane] = (1.0/12.0) * vehicle.BoosterMass * vehicle.BoosterLength * vehicle.BoosterLength +
+            (1.0/12.0) * (vehicle.SecondStageMass + vehicle.SecondStageFuelMass) * vehicle.SecondStageLength * vehicle.SecondStageLength +
+            (1.0/12.0) * vehicle.FairingMass * vehicle.FairingLength * vehicle.FairingLength;
+        batch.upper_mass[lane] = vehicle.SecondStageMass + vehicle.SecondStageFuelMass;
+        batch.upper_cm[lane] = vehicle.BoosterLength + vehicle.InterstageLength + vehicle.SecondStageLength/2.0;
+        batch.fairing_weight[lane] = 1.0; // updateMassAndMoment() leaves vehicle.FairingMass off this term
+        batch.fairing_cm[lane] = vehicle.BoosterLength + vehicle.InterstageLength + vehicle.SecondStageLength + vehicle.FairingLength/2.0;
+    }
+    else
+    {
+        batch.dry_mass[lane] = vehicle.OctawebMass + vehicle.BoosterMass;
+        batch.dry_cm_moment[lane] = vehicle.BoosterMass * vehicle.BoosterLength/2.0;
+        batch.cm_length[lane] = vehicle.BoosterLength;
+        batch.own_inertia[lane] = (1.0/12.0) * vehicle.BoosterMass * vehicle.BoosterLength * vehicle.BoosterLength;
+        batch.upper_mass[lane] = 0.0;
+        batch.upper_cm[lane] = 0.0;
+        batch.fairing_weight[lane] = 0.0;
+        batch.fairing_cm[lane] = 0.0;
+    }
+}
+
+void storeBatchLane(const RocketBatch &batch, int lane, SimulationContext &sim){
+
+    RocketPart &Falcon = sim.Falcon;
+
+    Falcon.pos_cm[0] = batch.pos_x[lane];
+    Falcon.pos_cm[1] = batch.pos_y[lane];
+    Falcon.vel_cm[0] = batch.vel_x[lane];
+    Falcon.vel_cm[1] = batch.vel_y[lane];
+    Falcon.omega = batch.omega[lane];
+    Falcon.FuelPercentage = batch.fuel[lane];
+    Falcon.GimbalBeta = batch.gimbal_beta[lane];
+
+    // updateTheta() keeps the angle within [0, 2 Pi)
+    Falcon.theta = batch.theta[lane] - 2.0*Pi*floor(batch.theta[lane]/(2.0*Pi));
+
+    Falcon.mass = batch.mass[lane];
+    Falcon.cm_location = batch.cm_location[lane];
+    Falcon.MomentofInertia = batch.moment[lane];
+    Falcon.torque = batch.torque[lane];
+    Falcon.dist_to_earth = batch.dist_to_earth[lane];
+    sim.air_density = batch.air_density[lane];
+
+    double dist2bottom = batch.cm_location[lane] * batch.part_height[lane];
+    double dist2top = batch.part_height[lane] - dist2bottom;
+    Falcon.part_top[0] = Falcon.pos_cm[0] + dist2top * batch.dir_x[lane];
+    Falcon.part_top[1] = Falcon.pos_cm[1] + dist2top * batch.dir_y[lane];
+    Falcon.part_bottom[0] = Falcon.pos_cm[0] - dist2bottom * batch.dir_x[lane];
+    Falcon.part_bottom[1] = Falcon.pos_cm[1] - dist2bottom * batch.dir_y[lane];
+
+    double r = Falcon.dist_to_earth;
+    Falcon.gravity[0] = - GRAVITY_GM * Falcon.mass * Falcon.pos_cm[0]/(r*r*r);
+    Falcon.gravity[1] = - GRAVITY_GM * Falcon.mass * (Falcon.pos_cm[1] + EARTH_RADIUS)/(r*r*r);
+
+    Falcon.air_resistance[0] = batch.air_x[lane];
+    Falcon.air_resistance[1] = batch.air_y[lane];
+    Falcon.main_thrust[0] = batch.thrust_x[lane];
+    Falcon.main_thrust[1] = batch.thrust_y[lane];
+    Falcon.main_thrust[2] = batch.thrust[lane];
+
+    // the thrusters were built from the direction before the last rotation, this is close enough for drawing
+    Falcon.nit_thrust_left[0] = batch.nit_left[lane] * batch.dir_y[lane];
+    Falcon.nit_thrust_left[1] = - batch.nit_left[lane] * batch.dir_x[lane];
+    Falcon.nit_thrust_right[0] = - batch.nit_right[lane] * batch.dir_y[lane];
+    Falcon.nit_thrust_right[1] = batch.nit_right[lane] * batch.dir_x[lane];
+}
+
+// Taylor series, good to about 1e-13 for the gimbal range and the per-step rotation
+template <class V>
+static V sinSmall(V x){
+
+    V x2 = x*x;
+    return x*(V(1.0) + x2*(V(-1.0/6.0) + x2*(V(1.0/120.0) + x2*(V(-1.0/5040.0) + x2*(V(1.0/362880.0) + x2*(V(-1.0/39916800.0) + x2*V(1.0/6227020800.0)))))));
+}
+
+template <class V>
+static V cosSmall(V x){
+
+    V x2 = x*x;
+    return V(1.0) + x2*(V(-1.0/2.0) + x2*(V(1.0/24.0) + x2*(V(-1.0/720.0) + x2*(V(1.0/40320.0) + x2*(V(-1.0/3628800.0) + x2*(V(1.0/479001600.0) + x2*V(-1.0/87178291200.0)))))));
+}
+
+// one getPosition() for the V::Width lanes starting at i
+template <class V>
+static void stepLanes(RocketBatch &b, int i, double dt){
+
+    V h(dt);
+    V zero(0.0), half(0.5);
+
+    // translation
+    V vx = V::load(&b.vel_x[i]), vy = V::load(&b.vel_y[i]);
+    V px = V::load(&b.pos_x[i]) + vx * h;
+    V py = V::load(&b.pos_y[i]) + vy * h;
+
+    // mass and moment of inertia
+    V fuel = V::load(&b.fuel[i]);
+    V fuel_mass = V::load(&b.booster_fuel_mass[i]) * fuel;
+    V booster_length = V::load(&b.booster_length[i]);
+    V fuel_length = booster_length * fuel;
+    V mass = V::load(&b.dry_mass[i]) + fuel_mass;
+    V cm = (V::load(&b.dry_cm_moment[i]) + fuel_mass * fuel_length * half)/mass/V::load(&b.cm_length[i]);
+    V y = cm * V::load(&b.total_length[i]);
+
+    V d_booster = y - booster_length * half;
+    V d_fuel = y - fuel_length * half;
+    V d_upper = y - V::load(&b.upper_cm[i]);
+    V d_fairing = y - V::load(&b.fairing_cm[i]);
+    V moment = V::load(&b.octaweb_mass[i]) * cm * cm + V::load(&b.own_inertia[i]) +
+        V::load(&b.booster_mass[i]) * d_booster * d_booster +
+        V(1.0/12.0) * fuel_mass * fuel_length * fuel_length + fuel_mass * d_fuel * d_fuel +
+        V::load(&b.upper_mass[i]) * d_upper * d_upper +
+        V::load(&b.fairing_weight[i]) * d_fairing * d_fairing;
+
+    // torque from last step's forces, taken about the direction before this step's rotation
+    V ux = V::load(&b.dir_x[i]), uy = V::load(&b.dir_y[i]);
+    V height = V::load(&b.part_height[i]);
+    V torque = (height * half - cm * height) * (ux * V::load(&b.air_y[i]) - uy * V::load(&b.air_x[i])) +
+        cm * height * (V::load(&b.thrust_x[i]) * uy - V::load(&b.thrust_y[i]) * ux) +
+        (V::load(&b.nitrogen_height[i]) - y) * (V::load(&b.nit_right[i]) - V::load(&b.nit_left[i]));
+
+    // rotation
+    V omega = V::load(&b.omega[i]) + h * torque/moment;
+    V turn = h * omega;
+    V theta = V::load(&b.theta[i]) + turn;
+    V s = sinSmall(turn), c = cosSmall(turn);
+    V nx = ux * c - uy * s;
+    V ny = ux * s + uy * c;
+    V norm = sqrt(nx * nx + ny * ny);
+    nx = nx/norm;
+    ny = ny/norm;
+
+    // gravity
+    V ry = py + V(EARTH_RADIUS);
+    V r = sqrt(px * px + ry * ry);
+    V g = V(GRAVITY_GM) * mass/(r * r * r);
+    V force_x = - g * px;
+    V force_y = - g * ry;
+
+    // each lane looks up its own cell of the atmosphere table
+    double lane_r[V::Width], lane_density[V::Width];
+    r.store(lane_r);
+    for (int k = 0; k < V::Width; k++)
+        lane_density[k] = b.Atmosphere->density(lane_r[k] - EARTH_RADIUS);
+    V density = V::load(lane_density);
+
+    // air resistance, using the area seen along the velocity after rotating
+    V speed = sqrt(vx * vx + vy * vy);
+    typename V::Mask moving = greater(speed, V(0.00001));
+    V inv_speed = select(moving, V(1.0)/max(speed, V(0.00001)), zero);
+    V cos_alpha = vx * inv_speed, sin_alpha = vy * inv_speed;
+    V width = V::load(&b.part_width[i]);
+    V area = abs(width * height * (ny * cos_alpha - sin_alpha * nx)) + abs(width * width * (nx * cos_alpha + ny * sin_alpha));
+    V drag = V(.6 * .5) * density * speed * speed * area;
+    typename V::Mask drag_ok = both(less(drag * h, V(2.0) * mass * speed), moving);
+    V air_x = select(drag_ok, - drag * cos_alpha, zero);
+    V air_y = select(drag_ok, - drag * sin_alpha, zero);
+    force_x = force_x + air_x;
+    force_y = force_y + air_y;
+
+    // main thrust, gimballed off the direction before rotating
+    V beta = V::load(&b.gimbal_beta[i]);
+    V rate = V::load(&b.gimbal_rate[i]);
+    beta = select(both(greater(V::load(&b.gimbal_clock[i]), half), less(beta, V(Pi/4.0))), beta + rate * h, beta);
+    beta = select(both(greater(V::load(&b.gimbal_count_clock[i]), half), greater(beta, V(-Pi/4.0))), beta - rate * h, beta);
+
+    typename V::Mask on = greater(V::load(&b.engine_on[i]), half);
+    V thrust = V::load(&b.thrust[i]);
+    V sin_beta = sinSmall(beta), cos_beta = cosSmall(beta);
+    V thrust_x = select(on, thrust * (cos_beta * ux - sin_beta * uy), zero);
+    V thrust_y = select(on, thrust * (cos_beta * uy + sin_beta * ux), zero);
+    force_x = force_x + thrust_x;
+    force_y = force_y + thrust_y;
+
+    // burn fuel, and shut down once the tank is dry
+    typename V::Mask has_fuel = greater(fuel, V(0.00001));
+    fuel = select(on, select(has_fuel, fuel - h * V::load(&b.fuel_rate[i]), zero), fuel);
+    thrust = select(on, select(has_fuel, thrust, zero), thrust);
+
+    // nitrogen thrusters
+    V nit = V::load(&b.nit_thrust[i]);
+    V nit_left = select(greater(V::load(&b.rot_clock[i]), half), nit, zero);
+    V nit_right = select(greater(V::load(&b.rot_count_clock[i]), half), nit, zero);
+    force_x = force_x + (nit_left - nit_right) * uy;
+    force_y = force_y + (nit_right - nit_left) * ux;
+
+    // velocity
+    vx = vx + h * force_x/mass;
+    vy = vy + h * force_y/mass;
+
+    px.store(&b.pos_x[i]); py.store(&b.pos_y[i]);
+    vx.store(&b.vel_x[i]); vy.store(&b.vel_y[i]);
+    theta.store(&b.theta[i]); omega.store(&b.omega[i]);
+    nx.store(&b.dir_x[i]); ny.store(&b.dir_y[i]);
+    fuel.store(&b.fuel[i]); beta.store(&b.gimbal_beta[i]); thrust.store(&b.thrust[i]);
+    air_x.store(&b.air_x[i]); air_y.store(&b.air_y[i]);
+    thrust_x.store(&b.thrust_x[i]); thrust_y.store(&b.thrust_y[i]);
+    nit_left.store(&b.nit_left[i]); nit_right.store(&b.nit_right[i]);
+    mass.store(&b.mass[i]); cm.store(&b.cm_location[i]); moment.store(&b.moment[i]); torque.store(&b.torque[i]);
+    r.store(&b.dist_to_earth[i]); density.store(&b.air_density[i]);
+}
+
+void stepBatchScalar(RocketBatch &batch, double dt){
+
+    int count = batch.size();
+    for (int i = 0; i < count; i++)
+        stepLanes<ScalarDouble>(batch, i, dt);
+}
+
+void stepBatchSimd(RocketBatch &batch, double dt){
+
+    int count = batch.size();
+    int i = 0;
+
+    for (; i + SimdDouble::Width <= count; i += SimdDouble::Width)
+        stepLanes<SimdDouble>(batch, i, dt);
+
+    // whatever doesn't fill a whole vector
+    for (; i < count; i++)
+        stepLanes<ScalarDouble>(batch, i, dt);
+}
+
+int batchSimdWidth(){
+
+    return SimdDouble::Width;
+}
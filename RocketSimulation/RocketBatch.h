@@ -0,0 +1,80 @@
+/* Author: William Bryk
+
+ Many boosters stepped together, stored as a structure of arrays.
+
+ A RocketBatch keeps one array per quantity (pos_x[], vel_x[], theta[], fuel[] ...) with one entry (lane) per
+ vehicle, so a step walks every array front to back and the compiler can work on several vehicles at once.
+ stepBatchSimd() runs the getPosition() pipeline (translate, mass and moment, torque, rotation, forces,
+ velocity) on SimdDouble::Width vehicles per instruction; stepBatchScalar() is the same kernel one lane at a time.
+
+ The batch only holds vehicles in flight. Ground contact, staging and the clocks stay with the
+ SimulationContext: load the lanes, step the batch, store the lanes back and let the caller check them.
+ */
+
+#ifndef ROCKETSIMULATION_ROCKETBATCH_H
+#define ROCKETSIMULATION_ROCKETBATCH_H
+
+#include "Simulation.h"
+#include <vector>
+
+class RocketBatch
+{
+public:
+    // state
+    std::vector<double> pos_x, pos_y;
+    std::vector<double> vel_x, vel_y;
+    std::vector<double> theta, omega;
+    std::vector<double> dir_x, dir_y;           // unit vector from part_bottom to part_top
+    std::vector<double> fuel;                   // FuelPercentage
+    std::vector<double> gimbal_beta;
+    std::vector<double> thrust;                 // main_thrust[2]
+
+    // forces from the last step, the torque is worked out from these
+    std::vector<double> air_x, air_y;
+    std::vector<double> thrust_x, thrust_y;
+    std::vector<double> nit_left, nit_right;    // magnitude of each nitrogen thruster, 0 when off
+
+    // worked out during the step
+    std::vector<double> mass, cm_location, moment, torque;
+    std::vector<double> dist_to_earth, air_density;
+
+    // controls, 1.0 for a switch that is on and 0.0 for one that is off
+    std::vector<double> engine_on;
+    std::vector<double> gimbal_clock, gimbal_count_clock;
+    std::vector<double> rot_clock, rot_count_clock;
+    std::vector<double> gimbal_rate;
+    std::vector<double> nit_thrust;             // nit_thrust_left[2]
+
+    // shape of the part, so stacked and detached boosters can share a batch (see loadBatchLane)
+    std::vector<double> part_height;
+    std::vector<double> dry_mass;               // everything but the booster fuel
+    std::vector<double> dry_cm_moment;          // sum of mass * height above the bottom, everything but the booster fuel
+    std::vector<double> cm_length;              // length cm_location is measured along
+    std::vector<double> own_inertia;            // (1/12) m L^2 of the parts that don't burn
+    std::vector<double> upper_mass, upper_cm;   // second stage, zero once detached
+    std::vector<double> fairing_weight, fairing_cm;
+
+    // the vehicle each lane flies, so variants of it can share a batch too (see Vehicle.h)
+    std::vector<double> octaweb_mass, booster_mass, booster_length, booster_fuel_mass, total_length;
+    std::vector<double> nitrogen_height, fuel_rate, part_width;
+
+    const AtmosphereTable *Atmosphere;          // shared by every lane
+
+    RocketBatch();
+
+    int size() const { return (int) pos_x.size(); }
+    void resize(int count);
+};
+
+// copy the booster of a flight into lane, and back out again
+void loadBatchLane(RocketBatch &batch, int lane, const SimulationContext &sim);
+void loadBatchControls(RocketBatch &batch, int lane, const switches &CheckList);
+void storeBatchLane(const RocketBatch &batch, int lane, SimulationContext &sim);
+
+// advance every lane by dt seconds
+void stepBatchScalar(RocketBatch &batch, double dt);
+void stepBatchSimd(RocketBatch &batch, double dt);
+
+int batchSimdWidth();
+
+#endif
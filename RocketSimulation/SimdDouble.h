@@ -0,0 +1,120 @@
+/* Author: William Bryk
+
+ Thin wrappers that let one kernel be written once and compiled for several vector widths.
+
+ ScalarDouble is a single double. SimdDouble is the widest double vector the compiler was told it may use:
+ 8 lanes with AVX-512, 4 with AVX, and otherwise it falls back to ScalarDouble. Both offer the same
+ operations, so a kernel templated on the lane type runs unchanged on either.
+ */
+
+#ifndef ROCKETSIMULATION_SIMDDOUBLE_H
+#define ROCKETSIMULATION_SIMDDOUBLE_H
+
+#include <cmath>
+
+#if defined(__AVX512F__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+class ScalarDouble
+{
+public:
+    static const int Width = 1;
+    typedef bool Mask;
+
+    double v;
+
+    ScalarDouble() {}
+    ScalarDouble(double x) : v(x) {}
+
+    static ScalarDouble load(const double *p) { return ScalarDouble(*p); }
+    void store(double *p) const { *p = v; }
+};
+
+inline ScalarDouble operator+(ScalarDouble a, ScalarDouble b) { return ScalarDouble(a.v + b.v); }
+inline ScalarDouble operator-(ScalarDouble a, ScalarDouble b) { return ScalarDouble(a.v - b.v); }
+inline ScalarDouble operator*(ScalarDouble a, ScalarDouble b) { return ScalarDouble(a.v * b.v); }
+inline ScalarDouble operator/(ScalarDouble a, ScalarDouble b) { return ScalarDouble(a.v / b.v); }
+inline ScalarDouble operator-(ScalarDouble a) { return ScalarDouble(-a.v); }
+inline ScalarDouble sqrt(ScalarDouble a) { return ScalarDouble(std::sqrt(a.v)); }
+inline ScalarDouble abs(ScalarDouble a) { return ScalarDouble(std::fabs(a.v)); }
+inline ScalarDouble min(ScalarDouble a, ScalarDouble b) { return ScalarDouble(a.v < b.v ? a.v : b.v); }
+inline ScalarDouble max(ScalarDouble a, ScalarDouble b) { return ScalarDouble(a.v > b.v ? a.v : b.v); }
+inline bool greater(ScalarDouble a, ScalarDouble b) { return a.v > b.v; }
+inline bool less(ScalarDouble a, ScalarDouble b) { return a.v < b.v; }
+inline bool both(bool a, bool b) { return a && b; }
+inline ScalarDouble select(bool mask, ScalarDouble a, ScalarDouble b) { return mask ? a : b; }
+
+
+#if defined(__AVX512F__)
+
+class SimdDouble
+{
+public:
+    static const int Width = 8;
+    typedef __mmask8 Mask;
+
+    __m512d v;
+
+    SimdDouble() {}
+    SimdDouble(__m512d x) : v(x) {}
+    SimdDouble(double x) : v(_mm512_set1_pd(x)) {}
+
+    static SimdDouble load(const double *p) { return SimdDouble(_mm512_loadu_pd(p)); }
+    void store(double *p) const { _mm512_storeu_pd(p, v); }
+};
+
+inline SimdDouble operator+(SimdDouble a, SimdDouble b) { return SimdDouble(_mm512_add_pd(a.v, b.v)); }
+inline SimdDouble operator-(SimdDouble a, SimdDouble b) { return SimdDouble(_mm512_sub_pd(a.v, b.v)); }
+inline SimdDouble operator*(SimdDouble a, SimdDouble b) { return SimdDouble(_mm512_mul_pd(a.v, b.v)); }
+inline SimdDouble operator/(SimdDouble a, SimdDouble b) { return SimdDouble(_mm512_div_pd(a.v, b.v)); }
+inline SimdDouble operator-(SimdDouble a) { return SimdDouble(_mm512_sub_pd(_mm512_setzero_pd(), a.v)); }
+// the masked forms with every lane set, the plain ones start from _mm512_undefined_pd() and GCC 12 warns about it
+inline SimdDouble sqrt(SimdDouble a) { return SimdDouble(_mm512_maskz_sqrt_pd((__mmask8) 0xff, a.v)); }
+inline SimdDouble max(SimdDouble a, SimdDouble b) { return SimdDouble(_mm512_maskz_max_pd((__mmask8) 0xff, a.v, b.v)); }
+inline SimdDouble min(SimdDouble a, SimdDouble b) { return SimdDouble(_mm512_maskz_min_pd((__mmask8) 0xff, a.v, b.v)); }
+inline SimdDouble abs(SimdDouble a) { return max(a, SimdDouble(_mm512_sub_pd(_mm512_setzero_pd(), a.v))); }
+inline __mmask8 greater(SimdDouble a, SimdDouble b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_GT_OQ); }
+inline __mmask8 less(SimdDouble a, SimdDouble b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ); }
+inline __mmask8 both(__mmask8 a, __mmask8 b) { return a & b; }
+inline SimdDouble select(__mmask8 mask, SimdDouble a, SimdDouble b) { return SimdDouble(_mm512_mask_blend_pd(mask, b.v, a.v)); }
+
+#elif defined(__AVX__)
+
+class SimdDouble
+{
+public:
+    static const int Width = 4;
+    typedef __m256d Mask;
+
+    __m256d v;
+
+    SimdDouble() {}
+    SimdDouble(__m256d x) : v(x) {}
+    SimdDouble(double x) : v(_mm256_set1_pd(x)) {}
+
+    static SimdDouble load(const double *p) { return SimdDouble(_mm256_loadu_pd(p)); }
+    void store(double *p) const { _mm256_storeu_pd(p, v); }
+};
+
+inline SimdDouble operator+(SimdDouble a, SimdDouble b) { return SimdDouble(_mm256_add_pd(a.v, b.v)); }
+inline SimdDouble operator-(SimdDouble a, SimdDouble b) { return SimdDouble(_mm256_sub_pd(a.v, b.v)); }
+inline SimdDouble operator*(SimdDouble a, SimdDouble b) { return SimdDouble(_mm256_mul_pd(a.v, b.v)); }
+inline SimdDouble operator/(SimdDouble a, SimdDouble b) { return SimdDouble(_mm256_div_pd(a.v, b.v)); }
+inline SimdDouble operator-(SimdDouble a) { return SimdDouble(_mm256_sub_pd(_mm256_setzero_pd(), a.v)); }
+inline SimdDouble sqrt(SimdDouble a) { return SimdDouble(_mm256_sqrt_pd(a.v)); }
+inline SimdDouble abs(SimdDouble a) { return SimdDouble(_mm256_max_pd(a.v, _mm256_sub_pd(_mm256_setzero_pd(), a.v))); }
+inline SimdDouble min(SimdDouble a, SimdDouble b) { return SimdDouble(_mm256_min_pd(a.v, b.v)); }
+inline SimdDouble max(SimdDouble a, SimdDouble b) { return SimdDouble(_mm256_max_pd(a.v, b.v)); }
+inline __m256d greater(SimdDouble a, SimdDouble b) { return _mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ); }
+inline __m256d less(SimdDouble a, SimdDouble b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ); }
+inline __m256d both(__m256d a, __m256d b) { return _mm256_and_pd(a, b); }
+inline SimdDouble select(__m256d mask, SimdDouble a, SimdDouble b) { return SimdDouble(_mm256_blendv_pd(b.v, a.v, mask)); }
+
+#else
+
+typedef ScalarDouble SimdDouble;
+
+#endif
+
+#endif
@@ -0,0 +1,805 @@
+/* Author: William Bryk
+
+ Physics for the Falcon v1.1 simulation. See Simulation.h.
+ */
+
+#include "Simulation.h"
+#include "Integrator.h"
+#include "Atmosphere.h"
+#include "MassProperties.h"
+#include "Vehicle.h"
+#include "ContactEvents.h"
+#include "Kepler.h"
+#include "Timeline.h"
+#include "Telemetry.h"
+#include "Replay.h"
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+SimulationContext::SimulationContext() : Falcon(), SecondStage(), Atmosphere(&standardAtmosphere()), Vehicle(&falcon9Vehicle()) {
+    refreshVariables(*this);
+}
+
+SimulationContext::SimulationContext(const VehicleConfig &vehicle) : Falcon(), SecondStage(), Atmosphere(&standardAtmosphere()), Vehicle(&vehicle) {
+    refreshVariables(*this);
+}
+
+// advance the whole simulation by dt seconds
+void step(SimulationContext &sim, double dt){
+    
+    switches &CheckList = sim.CheckList;
+    
+    sim.DeltaT = dt;
+    
+    // update the position of the rocket, stopping at the ground if it gets there during the step
+    stepFalconWithContact(sim, dt);
+    
+    // if detached, update the position of the second stage
+    if (CheckList.Detached)
+        stepSecondStageWithContact(sim, dt);
+    
+    sim.SimulationTime += dt;
+    
+    if (sim.Telemetry)
+        sim.Telemetry->record(sim);
+    if (sim.Replay)
+        sim.Replay->stepped(sim, dt);
+}
+
+// step with the current DeltaT until SimulationTime reaches t, shortening the last step to land on t exactly
+void runUntil(SimulationContext &sim, double t){
+    
+    double step_size = sim.DeltaT;
+    
+    while (t - sim.SimulationTime > 1e-9)
+        step(sim, std::min(step_size, t - sim.SimulationTime));
+    
+    sim.DeltaT = step_size;
+}
+
+// add frame_time seconds to the accumulator and step off as many whole substeps as it holds
+int FixedStepper::advance(SimulationContext &sim, double frame_time){
+    
+    double h = 1.0/PhysicsRate;
+    
+    accumulator += frame_time;
+    if (accumulator > MaxSubsteps * h)
+        accumulator = MaxSubsteps * h; // drop the time we can't catch up on
+    
+    int substeps = (int) (accumulator/h);
+    
+    for (int i = 0; i < substeps; i++)
+    {
+        if (i == substeps - 1)
+        {
+            PreviousFalcon = sim.Falcon;
+            PreviousSecondStage = sim.SecondStage;
+        }
+        if (Script)
+            applyDueEvents(sim, *Script);
+        
+        // a control partway through the substep splits it, so a tap lasts as long as the key was down
+        // rather than a whole substep, which can be many seconds at high warp
+        double end = sim.SimulationTime + h;
+        bool split = false;
+        while (Controls && (Controls->Next < Controls->Events.size()) && (Controls->Events[Controls->Next].Time < end))
+        {
+            double t = Controls->Events[Controls->Next].Time;
+            if (t > sim.SimulationTime)
+            {
+                step(sim, t - sim.SimulationTime);
+                split = true;
+            }
+            applyDueEvents(sim, *Controls);
+        }
+        if (!split)
+            step(sim, h);
+        else if (end > sim.SimulationTime)
+            step(sim, end - sim.SimulationTime);
+    }
+    
+    if (Controls && (Controls->Next == Controls->Events.size()))
+    {
+        Controls->Events.clear();
+        Controls->rewind();
+    }
+    
+    accumulator -= substeps * h;
+    alpha = accumulator/h;
+    
+    return substeps;
+}
+
+void FixedStepper::reset(const SimulationContext &sim){
+    
+    accumulator = 0.0;
+    alpha = 0.0;
+    PreviousFalcon = sim.Falcon;
+    PreviousSecondStage = sim.SecondStage;
+    if (Script)
+        Script->rewind();
+    if (Controls)
+    {
+        Controls->Events.clear();
+        Controls->rewind();
+    }
+}
+
+void ExplodeOrNot(SimulationContext &sim){
+    
+    RocketPart &Falcon = sim.Falcon;
+    switches &CheckList = sim.CheckList;
+    
+    if (MagOfVector(Falcon.part_top[0], Falcon.part_top[1] + EARTH_RADIUS) < EARTH_RADIUS)
+    {
+        CheckList.Exploded = true;
+        Falcon.vel_cm[0] = 0.0; Falcon.vel_cm[1] = 0.0; Falcon.omega = 0.0;
+    }
+    else if (MagOfVector(Falcon.part_bottom[0], Falcon.part_bottom[1] + EARTH_RADIUS) < EARTH_RADIUS)
+    {
+        double vel_bottom = MagOfVector(Falcon.vel_cm[0] + Falcon.omega*Falcon.cm_location*Falcon.part_height* (Falcon.part_top[1]-Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0]-Falcon.part_bottom[0], Falcon.part_top[1]-Falcon.part_bottom[1]), Falcon.vel_cm[1] + Falcon.omega*Falcon.cm_location*Falcon.part_height* (Falcon.part_bottom[0]-Falcon.part_top[0])/MagOfVector(Falcon.part_top[0]-Falcon.part_bottom[0], Falcon.part_top[1]-Falcon.part_bottom[1]));
+        
+        if ((vel_bottom > 60.0) || !CheckList.LegsDeployed || (Falcon.part_bottom[0] > PAD_DIAMETER/2.0) ||  (Falcon.part_bottom[0] < -PAD_DIAMETER/2.0) || CheckList.Exploded)
+        {
+            CheckList.Exploded = true;
+            Falcon.vel_cm[0] = 0.0; Falcon.vel_cm[1] = 0.0; Falcon.omega = 0.0;
+        }
+        else if ((Falcon.theta > 2.0*Pi/3.0)||(Falcon.theta < Pi/3.0) )
+        {
+            if ((Falcon.theta > Pi) || (Falcon.theta < 0.0))
+            {
+                CheckList.Exploded = true;
+                Falcon.pos_cm[0] = (Falcon.part_top[0] + Falcon.part_bottom[0])/2.0; Falcon.pos_cm[1] = 0.0;
+            }
+            else if (Falcon.theta > 2.0*Pi/3.0 )
+                Falcon.theta += .3 * sim.DeltaT;
+            else if (Falcon.theta < Pi/3.0)
+                Falcon.theta -= .3 * sim.DeltaT;
+            
+            Falcon.part_top[0] = Falcon.part_bottom[0] + Falcon.part_height * cos(Falcon.theta);
+            Falcon.part_top[1] = Falcon.part_bottom[1] + Falcon.part_height * sin(Falcon.theta);
+            
+            // update pos_cm based on top and bottom and Falcon.cm_location
+            Falcon.pos_cm[0] = Falcon.cm_location*(Falcon.part_top[0] - Falcon.part_bottom[0]) + Falcon.part_bottom[0];
+            Falcon.pos_cm[1] = Falcon.cm_location*(Falcon.part_top[1] - Falcon.part_bottom[1]) + Falcon.part_bottom[1];
+            
+            Falcon.vel_cm[0] = 0.0; Falcon.vel_cm[1] = 0.0; Falcon.omega = 0.0;
+            
+        }
+        else
+        {
+            CheckList.LandedSuccess = true;
+            Falcon.vel_cm[0] = 0.0; Falcon.vel_cm[1] = 0.0; Falcon.omega = 0.0;
+            
+            // fix angle so that rocket is upright
+            // (without going past upright when the step is long)
+            if (Falcon.theta < Pi/2.0 - .01)
+                Falcon.theta = std::min(Falcon.theta + .2 * sim.DeltaT, Pi/2.0);
+            else if (Falcon.theta > Pi/2.0 + .01)
+                Falcon.theta = std::max(Falcon.theta - .2 * sim.DeltaT, Pi/2.0);
+                
+            Falcon.part_top[0] = Falcon.part_bottom[0] + Falcon.part_height * cos(Falcon.theta);
+            Falcon.part_top[1] = Falcon.part_bottom[1] + Falcon.part_height * sin(Falcon.theta);
+            
+            // HousePartyProtocol();
+        }
+    }
+    
+}
+
+void SecondExplodeOrNot(SimulationContext &sim){
+    
+    RocketPart &SecondStage = sim.SecondStage;
+    switches &CheckList = sim.CheckList;
+    
+    if ((MagOfVector(SecondStage.part_top[0], SecondStage.part_top[1] + EARTH_RADIUS) < EARTH_RADIUS) || (MagOfVector(SecondStage.part_bottom[0], SecondStage.part_bottom[1] + EARTH_RADIUS) < EARTH_RADIUS))
+    {
+        CheckList.SecondExploded = true;
+        SecondStage.vel_cm[0] = 0.0; SecondStage.vel_cm[1] = 0.0; SecondStage.omega = 0.0; // left omega for a version 2 of this program
+    }
+}
+
+// the parts of getPosition() that branch on the flight phase, each built once per phase it can be in
+template <bool Detached> static void massAndMoment(SimulationContext &sim);
+template <bool Liftoff> static void velocity(SimulationContext &sim);
+template <int Phase> static void forces(SimulationContext &sim);
+template <int Phase> static void mainThrust(SimulationContext &sim);
+
+// the switches forces() and mainThrust() look at, the rest are masked off so they aren't built over and over
+const int FORCES_PHASE = PHASE_LIFTOFF | PHASE_BURNING | PHASE_ROT_CLOCK | PHASE_ROT_COUNTCLOCK | PHASE_GIMBAL_CLOCK | PHASE_GIMBAL_COUNTCLOCK;
+const int THRUST_PHASE = PHASE_BURNING | PHASE_GIMBAL_CLOCK | PHASE_GIMBAL_COUNTCLOCK;
+
+// getPosition() for one flight phase, with the switches it would check every step known at compile time
+template <int Phase>
+static void falconStep(SimulationContext &sim){
+    
+    const bool Detached = (Phase & PHASE_DETACHED) != 0;
+    const bool Liftoff = (Phase & PHASE_LIFTOFF) != 0;
+    RocketPart &Falcon = sim.Falcon;
+    
+    if (Liftoff)
+        sim.TimeSinceLaunch += sim.DeltaT;
+    
+    // translation of top and bottom of Falcon
+    Falcon.pos_cm[0] += Falcon.vel_cm[0] * sim.DeltaT;
+    Falcon.pos_cm[1] += Falcon.vel_cm[1] * sim.DeltaT;
+
+    const double length = Detached ? sim.Vehicle->BoosterLength : sim.Vehicle->TotalLength;
+    double dist2bottom = Falcon.cm_location * length;
+    double dist2top = length - dist2bottom;
+    
+    Falcon.part_top[0] = dist2top*cos(Falcon.theta) + Falcon.pos_cm[0];
+    Falcon.part_top[1] = dist2top*sin(Falcon.theta) + Falcon.pos_cm[1];
+    Falcon.part_bottom[0] = dist2bottom*cos(Falcon.theta + Pi) + Falcon.pos_cm[0];
+    Falcon.part_bottom[1] = dist2bottom*sin(Falcon.theta + Pi) + Falcon.pos_cm[1];
+    
+    
+    // update Mass and Moment of Inertia
+    massAndMoment<Detached>(sim);
+    
+    // update top and bottom using torque
+    updateTorque(sim);
+    
+    Falcon.omega += sim.DeltaT * Falcon.torque/Falcon.MomentofInertia;
+    
+    //ROTATION
+    updateTheta(sim);
+    forces<Phase & FORCES_PHASE>(sim);
+    velocity<Liftoff>(sim);
+
+    
+}
+
+typedef void (*FalconStep)(SimulationContext &sim);
+
+// every kernel built once per phase, indexed by flightPhase()
+template <typename List> struct FalconKernels;
+template <int... Phases> struct FalconKernels<PhaseList<Phases...> >
+{
+    static const FalconStep Steps[PHASE_COUNT];
+    static const FalconStep Forces[PHASE_COUNT];
+    static const FalconStep MainThrust[PHASE_COUNT];
+};
+template <int... Phases> const FalconStep FalconKernels<PhaseList<Phases...> >::Steps[PHASE_COUNT] = {falconStep<Phases>...};
+template <int... Phases> const FalconStep FalconKernels<PhaseList<Phases...> >::Forces[PHASE_COUNT] = {forces<Phases & FORCES_PHASE>...};
+template <int... Phases> const FalconStep FalconKernels<PhaseList<Phases...> >::MainThrust[PHASE_COUNT] = {mainThrust<Phases & THRUST_PHASE>...};
+
+typedef FalconKernels<AllPhases<PHASE_COUNT>::type> AllFalconKernels;
+static const FalconStep *const FALCON_STEPS = AllFalconKernels::Steps;
+static const FalconStep *const FALCON_FORCES = AllFalconKernels::Forces;
+static const FalconStep *const FALCON_MAIN_THRUST = AllFalconKernels::MainThrust;
+
+void getPosition(SimulationContext &sim){
+    
+    FALCON_STEPS[flightPhase(sim.CheckList)](sim);
+}
+
+template <bool Detached>
+static void massAndMoment(SimulationContext &sim){
+    
+    RocketPart &Falcon = sim.Falcon;
+    
+    MassProperties p = sim.Vehicle->massTable(Detached).at(Falcon.FuelPercentage);
+    Falcon.mass = p.mass;
+    Falcon.cm_location = p.cm_location;
+    Falcon.MomentofInertia = p.MomentofInertia;
+}
+
+void updateMassAndMoment(SimulationContext &sim){
+    
+    if (sim.CheckList.Detached)
+        massAndMoment<true>(sim);
+    else
+        massAndMoment<false>(sim);
+}
+
+// worked out from scratch, the vehicle's mass tables cache this
+
+void massProperties(const VehicleConfig &vehicle, bool detached, double fuel_percentage, double &mass, double &cm_location, double &moment){
+    
+    if (!detached)
+    {
+        mass = vehicle.OctawebMass + vehicle.BoosterMass + vehicle.BoosterFuelMass * fuel_percentage + vehicle.SecondStageMass + vehicle.SecondStageFuelMass +  vehicle.FairingMass;
+        
+        // calculated with bottom of falcon as baseline
+        cm_location =
+        (vehicle.OctawebMass * 0 +
+         vehicle.BoosterMass * vehicle.BoosterLength/2.0 +
+         vehicle.BoosterFuelMass * fuel_percentage * vehicle.BoosterLength * fuel_percentage/2.0 +
+         (vehicle.SecondStageMass + vehicle.SecondStageFuelMass) * (vehicle.BoosterLength + vehicle.InterstageLength +
+                                                           vehicle.SecondStageLength/2.0) +
+         vehicle.FairingMass * (vehicle.BoosterLength + vehicle.InterstageLength +
+                           vehicle.SecondStageLength + vehicle.FairingLength/2.0))/mass;
+        
+        // make between 0 and 1
+        cm_location = cm_location/vehicle.TotalLength;
+        
+        // approximating using a small width approximation
+        // using lots of parallel axis theorem
+        moment = vehicle.OctawebMass * pow(cm_location,2.0) +
+        
+        (1.0/12.0)* vehicle.BoosterMass * pow(vehicle.BoosterLength,2.0) + vehicle.BoosterMass * pow(std::abs(cm_location * vehicle.TotalLength - vehicle.BoosterLength/2.0),2.0) +
+        
+        (1.0/12.0)* vehicle.BoosterFuelMass * fuel_percentage * pow(vehicle.BoosterLength * fuel_percentage,2.0) + vehicle.BoosterFuelMass * fuel_percentage * pow(std::abs(cm_location * vehicle.TotalLength - vehicle.BoosterLength * fuel_percentage/2.0),2.0) +
+        
+        (1.0/12.0) * (vehicle.SecondStageMass + vehicle.SecondStageFuelMass) * pow(vehicle.SecondStageLength,2.0) + (vehicle.SecondStageMass + vehicle.SecondStageFuelMass) * pow(std::abs(cm_location * vehicle.TotalLength - (vehicle.BoosterLength + vehicle.InterstageLength + vehicle.SecondStageLength/2.0)),2.0) +
+        
+        (1.0/12.0) * vehicle.FairingMass * pow(vehicle.FairingLength,2.0) + pow(std::abs(cm_location * vehicle.TotalLength - (vehicle.BoosterLength + vehicle.InterstageLength + vehicle.SecondStageLength + vehicle.FairingLength/2.0)),2.0);
+        
+    }
+    else
+    {
+        // update Falcon mass without second stage
+        mass = vehicle.OctawebMass + vehicle.BoosterMass + vehicle.BoosterFuelMass * fuel_percentage;
+        
+        
+        cm_location = (vehicle.OctawebMass * 0 +
+                              vehicle.BoosterMass * vehicle.BoosterLength/2.0 +
+                              vehicle.BoosterFuelMass * fuel_percentage * vehicle.BoosterLength * fuel_percentage/2.0)/mass;
+        
+        // make between 0 and 1
+        cm_location = cm_location/vehicle.BoosterLength;
+        
+        moment = vehicle.OctawebMass * pow(cm_location,2.0) +
+        
+        (1.0/12.0)* vehicle.BoosterMass * pow(vehicle.BoosterLength,2.0) + vehicle.BoosterMass * pow(std::abs(cm_location * vehicle.TotalLength - vehicle.BoosterLength/2.0),2.0) +
+        
+        (1.0/12.0)* vehicle.BoosterFuelMass * fuel_percentage * pow(vehicle.BoosterLength * fuel_percentage,2.0) + vehicle.BoosterFuelMass * fuel_percentage * pow(std::abs(cm_location * vehicle.TotalLength - vehicle.BoosterLength * fuel_percentage/2.0),2.0);
+    }
+}
+
+void updateTorque(SimulationContext &sim){
+    
+    RocketPart &Falcon = sim.Falcon;
+    
+    double torque_air;
+    
+    if (MagOfVector(Falcon.air_resistance[0], Falcon.air_resistance[1]) > .00001 ) // prevent dividing by zero
+    {
+    
+        torque_air = ((Falcon.part_height/2.0) - Falcon.cm_location * Falcon.part_height) * twoDCrossMag(Falcon.air_resistance[0], Falcon.air_resistance[1],Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]);
+    
+        // need to check whether torque is positive or negative, do this by finding sin(theta - alpha) where alpha
+        // is angle of air resistance
+        double sin_theta_alpha = sin(Falcon.theta)*(Falcon.air_resistance[0]/MagOfVector(Falcon.air_resistance[0], Falcon.air_resistance[1])) - (Falcon.air_resistance[1]/MagOfVector(Falcon.air_resistance[0], Falcon.air_resistance[1]))*cos(Falcon.theta);
+    
+        if ((sin_theta_alpha > 0.00001) && (sin_theta_alpha < Pi))
+            torque_air = -torque_air;
+    
+    }
+    else
+        torque_air = 0.0;
+    
+    
+    // double torque_gimbal
+    double torque_gimbal;
+    
+    if (MagOfVector(Falcon.main_thrust[0], Falcon.main_thrust[1]) > .0001 ) // prevent dividing by zero
+        
+        torque_gimbal = (Falcon.cm_location * Falcon.part_height) * twoDCrossMag(Falcon.main_thrust[0], Falcon.main_thrust[1], Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]);
+    else
+        torque_gimbal = 0.0;
+        
+    if (Falcon.GimbalBeta > 0.0001)
+        torque_gimbal = -torque_gimbal;
+    
+    // sum of torque of air resistance, gimbaled thrust, and each nitrogen thruster
+    Falcon.torque = torque_air + torque_gimbal + (sim.Vehicle->NitrogenHeight - Falcon.cm_location * sim.Vehicle->TotalLength) * MagOfVector(Falcon.nit_thrust_right[0],Falcon.nit_thrust_right[1]) - (sim.Vehicle->NitrogenHeight - Falcon.cm_location * sim.Vehicle->TotalLength) * MagOfVector(Falcon.nit_thrust_left[0],Falcon.nit_thrust_left[1]);
+}
+
+void updateTheta(SimulationContext &sim){
+    
+    RocketPart &Falcon = sim.Falcon;
+    
+    bool smallangle = false; //don't want to divide by zero
+    if (std::abs(Falcon.part_top[0]-Falcon.part_bottom[0]) < 0.00000001)
+        smallangle = true;
+    
+    if ((Falcon.part_top[0]-Falcon.part_bottom[0]) >= 0.0)
+    {
+        if ((Falcon.part_top[1]-Falcon.part_bottom[1]) >= 0.0)
+        {
+            //angle is in first quadrant
+            if (!smallangle)
+                Falcon.theta = atan((Falcon.part_top[1]-Falcon.part_bottom[1])/(Falcon.part_top[0]-Falcon.part_bottom[0]));
+            else
+                Falcon.theta = Pi/2.0;
+        }
+        else if ((Falcon.part_top[1]-Falcon.part_bottom[1]) < 0.0)
+        {
+            // angle is in fourth quadrant
+            if (!smallangle)
+                Falcon.theta = atan((Falcon.part_top[1]-Falcon.part_bottom[1])/(Falcon.part_top[0]-Falcon.part_bottom[0])) + 2*Pi;
+            else
+                Falcon.theta = -Pi/2.0;
+        }
+    }
+    else if ((Falcon.part_top[0]-Falcon.part_bottom[0]) < 0.0)
+    {
+        if ((Falcon.part_top[1]-Falcon.part_bottom[1]) >= 0.0)
+        {
+            //angle is in second quadrant
+            if (!smallangle)
+                Falcon.theta = atan((Falcon.part_top[1]-Falcon.part_bottom[1])/(Falcon.part_top[0]-Falcon.part_bottom[0])) + Pi;
+            else
+                Falcon.theta = Pi/2.0;
+        }
+        else if ((Falcon.part_top[1]-Falcon.part_bottom[1]) < 0.0)
+        {
+            // angle is in third quadrant
+            if (!smallangle)
+                Falcon.theta = atan((Falcon.part_top[1]-Falcon.part_bottom[1])/(Falcon.part_top[0]-Falcon.part_bottom[0])) + Pi;
+            else
+                Falcon.theta = -Pi/2.0;
+        }
+    }
+    
+     Falcon.theta += sim.DeltaT * Falcon.omega;
+}
+
+
+template <bool Liftoff>
+static void velocity(SimulationContext &sim){
+    
+    RocketPart &Falcon = sim.Falcon;
+    if (Liftoff)
+    {
+        Falcon.vel_cm[0] = Falcon.vel_cm[0] + sim.DeltaT * (Falcon.gravity[0] + Falcon.air_resistance[0] + Falcon.main_thrust[0] + Falcon.nit_thrust_left[0] + Falcon.nit_thrust_right[0])/Falcon.mass;
+        
+        Falcon.vel_cm[1] = Falcon.vel_cm[1] + sim.DeltaT * (Falcon.gravity[1] + Falcon.air_resistance[1] + Falcon.main_thrust[1] + Falcon.nit_thrust_left[1] + Falcon.nit_thrust_right[1])/Falcon.mass;
+    }
+}
+
+void updateVelocity(SimulationContext &sim){
+    
+    if (sim.CheckList.Liftoff)
+        velocity<true>(sim);
+    else
+        velocity<false>(sim);
+}
+
+template <int Phase>
+static void forces(SimulationContext &sim){
+    
+    const bool Liftoff = (Phase & PHASE_LIFTOFF) != 0;
+    RocketPart &Falcon = sim.Falcon;
+    
+    // since center of Earth is located at [0,-EARTH_RADIUS]
+    Falcon.dist_to_earth = MagOfVector(Falcon.pos_cm[0],Falcon.pos_cm[1] + EARTH_RADIUS);
+    
+    // using F = - GmM/r^2  where  GM = 3.98588 * pow(10,14)
+    double grav_magnitude = 3.98588 * pow(10,14)*(Falcon.mass)/pow(Falcon.dist_to_earth,2.0);
+    
+    Falcon.gravity[0] = - grav_magnitude * Falcon.pos_cm[0]/Falcon.dist_to_earth;
+    Falcon.gravity[1] = - grav_magnitude * (Falcon.pos_cm[1] + EARTH_RADIUS)/Falcon.dist_to_earth;
+    
+    
+    // update air resistance force vector
+    
+    double sin_alpha;
+    double cos_alpha;
+    
+    if (MagOfVector(Falcon.vel_cm[0], Falcon.vel_cm[1]) > .00001) // don't want to divide by zero
+    {
+        sin_alpha = (Falcon.vel_cm[1])/MagOfVector(Falcon.vel_cm[0], Falcon.vel_cm[1]);
+        cos_alpha = (Falcon.vel_cm[0])/MagOfVector(Falcon.vel_cm[0], Falcon.vel_cm[1]);
+    }
+    else
+    {
+        sin_alpha = 0;
+        cos_alpha = 0;
+    }
+    
+    double A = std::abs(Falcon.part_width * Falcon.part_height*(sin(Falcon.theta)*cos_alpha - sin_alpha * cos(Falcon.theta))) +
+    std::abs(Falcon.part_width * Falcon.part_width*(cos(Falcon.theta)*cos_alpha + sin(Falcon.theta)*sin_alpha));
+    
+    sim.air_density = sim.Atmosphere->density(Falcon.dist_to_earth - EARTH_RADIUS);
+    
+    // using formula for air resistance: D = DragCoefficient * .5 * A (in direction of velocity) * airdensity * V^2
+    // using Drag Coefficient of .6
+    
+    
+    double D = .6 * .5 * sim.air_density * pow(MagOfVector(Falcon.vel_cm[0], Falcon.vel_cm[1]),2.0) * A;
+    
+    if ((D*sim.DeltaT < 2.0*Falcon.mass*(MagOfVector(Falcon.vel_cm[0], Falcon.vel_cm[1]))) && (MagOfVector(Falcon.vel_cm[0], Falcon.vel_cm[1]) > 0.0)) // prevent faulty air resistance change in velocity due to high DeltaT, and preventdivision by zero
+    {
+            Falcon.air_resistance[0] = - D * Falcon.vel_cm[0]/MagOfVector(Falcon.vel_cm[0], Falcon.vel_cm[1]);
+            Falcon.air_resistance[1] = - D * Falcon.vel_cm[1]/MagOfVector(Falcon.vel_cm[0], Falcon.vel_cm[1]);
+    }
+    else
+    {
+        Falcon.air_resistance[0] = 0;
+        Falcon.air_resistance[1] = 0;
+    }
+    
+    // update main thrust force vector
+    mainThrust<Phase & THRUST_PHASE>(sim);
+    
+    // update side thrust force vectors
+    if (Liftoff && (Phase & PHASE_ROT_CLOCK))
+    {
+        Falcon.nit_thrust_left[0] =  Falcon.nit_thrust_left[2] * (Falcon.part_top[1] - Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]);
+        
+        Falcon.nit_thrust_left[1] =  - Falcon.nit_thrust_left[2] * (Falcon.part_top[0] - Falcon.part_bottom[0])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]);
+    }
+    else
+    {
+        Falcon.nit_thrust_left[0] = 0;
+        Falcon.nit_thrust_left[1] = 0;
+    }
+    
+    if (Liftoff && (Phase & PHASE_ROT_COUNTCLOCK))
+    {
+        Falcon.nit_thrust_right[0] = - Falcon.nit_thrust_right[2] * (Falcon.part_top[1] - Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]);
+        
+        Falcon.nit_thrust_right[1] = Falcon.nit_thrust_right[2] * (Falcon.part_top[0] - Falcon.part_bottom[0])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]);
+    }
+    else
+    {
+        Falcon.nit_thrust_right[0] = 0;
+        Falcon.nit_thrust_right[1] = 0;
+    }
+}
+
+void updateForces(SimulationContext &sim){
+    
+    FALCON_FORCES[flightPhase(sim.CheckList)](sim);
+}
+
+template <int Phase>
+static void mainThrust(SimulationContext &sim){
+    
+    const bool Burning = (Phase & PHASE_BURNING) != 0;
+    RocketPart &Falcon = sim.Falcon;
+    
+    if ((Phase & PHASE_GIMBAL_CLOCK) && (Falcon.GimbalBeta < Pi/4.0))
+        Falcon.GimbalBeta += Falcon.GimbalRate * sim.DeltaT;
+    if ((Phase & PHASE_GIMBAL_COUNTCLOCK) && (Falcon.GimbalBeta > -Pi/4.0))
+        Falcon.GimbalBeta -= Falcon.GimbalRate * sim.DeltaT;
+    
+    if (Burning)
+    {
+        // equation for thrust vector is cos(Falcon.GimbalBeta) * rocketUnitVector * thrustMagnitude + sin(Falcon.GimbalBeta)*UnitVectorPerpToRocket * thrustMagnitude
+        
+        Falcon.main_thrust[0] = Falcon.main_thrust[2] * cos(Falcon.GimbalBeta)*(Falcon.part_top[0] - Falcon.part_bottom[0])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]) +
+            Falcon.main_thrust[2] * sin(Falcon.GimbalBeta)* -(Falcon.part_top[1] - Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]);
+        
+        Falcon.main_thrust[1] = Falcon.main_thrust[2] * cos(Falcon.GimbalBeta) * (Falcon.part_top[1] - Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]) +
+            Falcon.main_thrust[2] * sin(Falcon.GimbalBeta)* (Falcon.part_top[0] - Falcon.part_bottom[0])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]);
+        
+        if (Falcon.FuelPercentage > 0.00001)
+            Falcon.FuelPercentage = (Falcon.FuelPercentage * sim.Vehicle->BoosterFuelMass - sim.DeltaT * (Falcon.main_thrust[2])/(sim.Vehicle->ExhaustVelocity))/sim.Vehicle->BoosterFuelMass; // mass flow rate formula using thrust and specific impulse
+        else
+        {
+            Falcon.main_thrust[2] = 0.0;
+            Falcon.FuelPercentage = 0.0;
+        }
+    }
+    else
+    {
+        Falcon.main_thrust[0] = 0.0;
+        Falcon.main_thrust[1] = 0.0;
+    }
+}
+
+void updateMainThrust(SimulationContext &sim){
+    
+    FALCON_MAIN_THRUST[flightPhase(sim.CheckList)](sim);
+}
+
+// getSecStagePosition() while the second stage isn't coasting, built for before and after its engine lights
+template <bool Lit>
+static void secondStageStep(SimulationContext &sim){
+    
+    RocketPart &SecondStage = sim.SecondStage;
+    const VehicleConfig &vehicle = *sim.Vehicle;
+
+    // using F = - GmM/r^2  where  GM = 3.98588 * pow(10,14)
+    double grav_magnitude2 = 3.98588 * pow(10.0,14.0)*(SecondStage.mass)/pow(SecondStage.dist_to_earth,2.0);
+    
+    SecondStage.gravity[0] = - grav_magnitude2 * SecondStage.pos_cm[0]/SecondStage.dist_to_earth;
+    SecondStage.gravity[1] = - grav_magnitude2 * (SecondStage.pos_cm[1] + EARTH_RADIUS)/SecondStage.dist_to_earth;
+    
+
+    // update main thrust
+    if (Lit)
+    {
+        
+        SecondStage.main_thrust[0] = SecondStage.main_thrust[2] *(SecondStage.part_top[0] - SecondStage.part_bottom[0])/MagOfVector(SecondStage.part_top[0] - SecondStage.part_bottom[0],SecondStage.part_top[1] - SecondStage.part_bottom[1]);
+    
+        SecondStage.main_thrust[1] = SecondStage.main_thrust[2] * (SecondStage.part_top[1] - SecondStage.part_bottom[1])/MagOfVector(SecondStage.part_top[0] - SecondStage.part_bottom[0],SecondStage.part_top[1] - SecondStage.part_bottom[1]);
+    }
+    else
+    {
+        SecondStage.main_thrust[0] = 0.0; SecondStage.main_thrust[1] = 0.0;
+    }
+    
+    if (SecondStage.FuelPercentage > 0.00001)
+        SecondStage.FuelPercentage = (SecondStage.FuelPercentage * vehicle.SecondStageFuelMass - sim.DeltaT * vehicle.SecondStageThrust/vehicle.ExhaustVelocity)/vehicle.SecondStageFuelMass; // mass flow rate formula using thrust and specific impulse
+    else
+    {
+        SecondStage.main_thrust[2] = 0.0;
+        SecondStage.FuelPercentage = 0.0;
+    }
+    
+    
+    // update velocity
+    SecondStage.vel_cm[0] = SecondStage.vel_cm[0] + sim.DeltaT * (SecondStage.gravity[0] + SecondStage.main_thrust[0])/SecondStage.mass;
+    SecondStage.vel_cm[1] = SecondStage.vel_cm[1] + sim.DeltaT * (SecondStage.gravity[1] + SecondStage.main_thrust[1])/SecondStage.mass;
+    
+    
+    
+    // translation of top and bottom of Second Stage
+    SecondStage.pos_cm[0] += SecondStage.vel_cm[0] * sim.DeltaT;
+    SecondStage.pos_cm[1] += SecondStage.vel_cm[1] * sim.DeltaT;
+    
+    
+    
+    // Rotate Second Stage accordingly
+    SecondStage.part_top[0] = (vehicle.SecondStageHeight/2.0)*cos(SecondStage.theta) + SecondStage.pos_cm[0];
+    SecondStage.part_top[1] = (vehicle.SecondStageHeight/2.0)*sin(SecondStage.theta) + SecondStage.pos_cm[1];
+    
+    SecondStage.part_bottom[0] = (vehicle.SecondStageHeight/2.0)*cos(SecondStage.theta + Pi) + SecondStage.pos_cm[0];
+    SecondStage.part_bottom[1] = (vehicle.SecondStageHeight/2.0)*sin(SecondStage.theta + Pi) + SecondStage.pos_cm[1];
+}
+
+typedef void (*SecondStageStep)(SimulationContext &sim);
+
+// indexed by whether the engine has lit
+static const SecondStageStep SECOND_STAGE_STEPS[2] = {secondStageStep<false>, secondStageStep<true>};
+
+void getSecStagePosition(SimulationContext &sim){
+    
+    RocketPart &SecondStage = sim.SecondStage;
+    const VehicleConfig &vehicle = *sim.Vehicle;
+
+    // update second stage mass
+    SecondStage.mass = vehicle.SecondStageMass + vehicle.SecondStageFuelMass * SecondStage.FuelPercentage +  vehicle.FairingMass;
+    
+    // Find the new angle of the second stage, in version 2.0
+    //updateSecStageAngle();
+  
+    
+    // update gravitational force
+    SecondStage.dist_to_earth = MagOfVector(SecondStage.pos_cm[0],SecondStage.pos_cm[1] + EARTH_RADIUS);
+    
+    // out of fuel and above the air, so follow the orbit exactly instead of stepping it
+    if (secondStageCoasting(sim))
+    {
+        coastSecondStage(sim, sim.DeltaT);
+        return;
+    }
+
+    // the engine lights 4 seconds after separation
+    SECOND_STAGE_STEPS[sim.TimeSinceLaunch - sim.TimeofDetach > 4.0](sim);
+}
+
+double MagOfVector(double x, double y){
+    
+    return sqrt(pow(x,2.0) + pow(y,2.0));
+    
+}
+
+// calculates magnitude of (a,b) in the direction of (c,d)
+double twoDCrossMag(double a, double b, double c, double d) {
+    
+    if ((pow((a*c + b*d)/(MagOfVector(a,b)*MagOfVector(c,d)),2.0) > .99999) && (pow((a*c + b*d)/(MagOfVector(a,b)*MagOfVector(c,d)),2.0) < 1.00001))
+        return 0.0;
+    else
+        return  MagOfVector(a,b) * sqrt(std::abs(1- pow((a*c + b*d)/(MagOfVector(a,b)*MagOfVector(c,d)),2.0)));
+}
+
+
+
+void refreshVariables(SimulationContext &sim){
+    
+    RocketPart &Falcon = sim.Falcon;
+    RocketPart &SecondStage = sim.SecondStage;
+    switches &CheckList = sim.CheckList;
+    const VehicleConfig &vehicle = *sim.Vehicle;
+    
+    sim.TimeSinceLaunch = 0.0;
+    sim.TimeofDetach = 0.0;
+    sim.SimulationTime = 0.0;
+    Falcon.FuelPercentage = 1.0;
+    SecondStage.FuelPercentage = 1.0;
+    MassProperties full = vehicle.Stacked.at(Falcon.FuelPercentage);
+    Falcon.mass = full.mass;
+    Falcon.cm_location = full.cm_location;
+    Falcon.MomentofInertia = full.MomentofInertia;
+    
+    Falcon.pos_cm[0] = 0.0, Falcon.pos_cm[1] = Falcon.cm_location*vehicle.TotalLength;
+    Falcon.vel_cm[0] = 0.0, Falcon.vel_cm[1] = 0.0; Falcon.omega = 0.0;
+    Falcon.GimbalBeta = 0.0;
+    Falcon.torque = 0.0;
+    
+    Falcon.theta = Pi/2.0;
+    Falcon.dist_to_earth = EARTH_RADIUS + Falcon.pos_cm[1];
+    Falcon.part_width = vehicle.Width;
+    SecondStage.part_width = vehicle.Width;
+    Falcon.part_height = vehicle.TotalLength;
+    Falcon.part_top[0] = 0.0, Falcon.part_top[1] = vehicle.TotalLength;
+    Falcon.part_bottom[0] = 0.0, Falcon.part_bottom[1] = 0.0;
+    Falcon.air_resistance[0] = 0.0, Falcon.air_resistance[1] = 0.0;
+    Falcon.main_thrust[0] = 0.0, Falcon.main_thrust[1] = vehicle.ThrustSeaLevel, Falcon.main_thrust[2] = vehicle.ThrustSeaLevel;
+    
+    // couldn't find data on nitrogen thrust magnitude
+    Falcon.nit_thrust_left[0] = 0.0, Falcon.nit_thrust_left[1] = 0.0, Falcon.nit_thrust_left[2] = vehicle.NitrogenThrust;
+    Falcon.nit_thrust_right[0] = 0.0, Falcon.nit_thrust_right[1] = 0.0, Falcon.nit_thrust_right[2] = vehicle.NitrogenThrust;
+    
+    
+    CheckList.rocketOn = false;CheckList.ZoomOut = false;CheckList.RotClock = false;CheckList.RotCountClock = false;CheckList.Detached = false;CheckList.Liftoff = false;CheckList.GimbalClock = false;CheckList.GimbalCountClock = false;CheckList.LegsDeployed = false;CheckList.Exploded = false;CheckList.SecondExploded = false;CheckList.LandedSuccess = false;CheckList.WelcomeScreen = false;CheckList.Paused = false;
+    
+    sim.DeltaT = TIME_INCREMENT;
+}
+
+// separate the second stage from the booster
+void detachStages(SimulationContext &sim){
+    
+    RocketPart &Falcon = sim.Falcon;
+    RocketPart &SecondStage = sim.SecondStage;
+    switches &CheckList = sim.CheckList;
+    const VehicleConfig &vehicle = *sim.Vehicle;
+    
+    if (CheckList.Detached || CheckList.LandedSuccess || CheckList.Exploded || !CheckList.Liftoff)
+        return;
+    
+    CheckList.Detached = true;
+    sim.TimeofDetach = sim.TimeSinceLaunch;
+    double booster_cm = vehicle.Booster.at(Falcon.FuelPercentage).cm_location * vehicle.BoosterLength; // height above part_bottom
+    Falcon.pos_cm[0] = Falcon.part_bottom[0] + booster_cm*cos(Falcon.theta);
+    Falcon.pos_cm[1] = Falcon.part_bottom[1] + booster_cm*sin(Falcon.theta);
+    Falcon.part_height = vehicle.BoosterLength;
+    Falcon.part_top[0] = Falcon.part_bottom[0] + vehicle.BoosterLength*cos(Falcon.theta);
+    Falcon.part_top[1] = Falcon.part_bottom[1] + vehicle.BoosterLength*sin(Falcon.theta);
+    
+    SecondStage.pos_cm[0] = Falcon.part_top[0] + (vehicle.SecondStageHeight/2.0) * (Falcon.part_top[0]-Falcon.part_bottom[0])/MagOfVector(Falcon.part_top[0]-Falcon.part_bottom[0], Falcon.part_top[1]-Falcon.part_bottom[1]);
+    SecondStage.pos_cm[1] = Falcon.part_top[1] + (vehicle.SecondStageHeight/2.0) * (Falcon.part_top[1]-Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0]-Falcon.part_bottom[0], Falcon.part_top[1]-Falcon.part_bottom[1]);
+    SecondStage.vel_cm[0] = Falcon.vel_cm[0] + 7.0 * (Falcon.part_top[0]-Falcon.part_bottom[0])/MagOfVector(Falcon.part_top[0]-Falcon.part_bottom[0], Falcon.part_top[1]-Falcon.part_bottom[1]);
+    SecondStage.vel_cm[1] = Falcon.vel_cm[1] + 7.0 * (Falcon.part_top[1]-Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0]-Falcon.part_bottom[0], Falcon.part_top[1]-Falcon.part_bottom[1]);
+    SecondStage.mass = vehicle.SecondStageMass + vehicle.SecondStageFuelMass + vehicle.FairingMass;
+    SecondStage.dist_to_earth = MagOfVector(SecondStage.pos_cm[0], SecondStage.pos_cm[1] + EARTH_RADIUS);
+    SecondStage.theta = Falcon.theta;
+    SecondStage.part_height = vehicle.SecondStageHeight; //using fairing
+    SecondStage.part_bottom[0] = Falcon.part_top[0];
+    SecondStage.part_bottom[1] = Falcon.part_top[1];
+    SecondStage.part_top[0] = Falcon.part_top[0] + vehicle.SecondStageHeight*cos(SecondStage.theta);
+    SecondStage.part_top[1] = Falcon.part_top[1] + vehicle.SecondStageHeight*sin(SecondStage.theta);
+    
+    SecondStage.main_thrust[2] = vehicle.SecondStageThrust;
+    SecondStage.main_thrust[0] = SecondStage.main_thrust[2] * cos(SecondStage.theta);
+    SecondStage.main_thrust[1] =  SecondStage.main_thrust[2] * sin(SecondStage.theta);
+    
+}
+
+// blend two states of the same part, alpha = 0 gives a and alpha = 1 gives b
+RocketPart interpolateRocketPart(const RocketPart &a, const RocketPart &b, double alpha){
+    
+    // detaching changes the shape of the part, don't blend across it
+    if (a.part_height != b.part_height)
+        return b;
+    
+    RocketPart part = b;
+    
+    for (int i = 0; i < 2; i++)
+    {
+        part.pos_cm[i] = a.pos_cm[i] + alpha * (b.pos_cm[i] - a.pos_cm[i]);
+        part.vel_cm[i] = a.vel_cm[i] + alpha * (b.vel_cm[i] - a.vel_cm[i]);
+        part.part_top[i] = a.part_top[i] + alpha * (b.part_top[i] - a.part_top[i]);
+        part.part_bottom[i] = a.part_bottom[i] + alpha * (b.part_bottom[i] - a.part_bottom[i]);
+    }
+    
+    // updateTheta can hand back the same angle shifted by 2 Pi, so blend along the short way round
+    double dtheta = b.theta - a.theta;
+    while (dtheta > Pi)
+        dtheta -= 2.0*Pi;
+    while (dtheta < -Pi)
+        dtheta += 2.0*Pi;
+    part.theta = a.theta + alpha * dtheta;
+    
+    part.dist_to_earth = a.dist_to_earth + alpha * (b.dist_to_earth - a.dist_to_earth);
+    part.FuelPercentage = a.FuelPercentage + alpha * (b.FuelPercentage - a.FuelPercentage);
+    
+    return part;
+}
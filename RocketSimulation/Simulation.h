@@ -0,0 +1,232 @@
+/* Author: William Bryk
+
+ Headless simulation core for the Falcon v1.1 launch and landing.
+
+ Everything needed to advance the flight lives here: the vehicle constants, the RocketPart and switches
+ state, and the physics update functions. Nothing in this file depends on OpenGL or GLUT, so the core can
+ be stepped on machines without a display (batch runs, tests, benchmarks) as well as from the viewer in main.cpp.
+
+ All of a flight's state is held in a SimulationContext and every physics function takes the context it
+ works on, so there is no shared mutable state between flights.
+ */
+
+#ifndef ROCKETSIMULATION_SIMULATION_H
+#define ROCKETSIMULATION_SIMULATION_H
+
+//CONSTANTS
+const double TIME_INCREMENT = .03;
+
+const double Pi = 3.141592653;
+
+const double EARTH_RADIUS = 6371000.0;
+const double PAD_DIAMETER= 200.0;
+
+
+// data taken from http://spaceflight101.com/spacerockets/falcon-9-v1-1-f9r/
+// this is the vehicle flown unless a flight is given another, the physics reads it from a VehicleConfig (see Vehicle.h)
+
+const double OCTAWEB_MASS = 4200.0;  //9.0 M1D's * 470.0;
+
+const double BOOSTER_LENGTH = 41.2;
+const double BOOSTER_MASS = 19800.0; //without fuel or OctaWeb (Total weight is actually 24000 kg)
+const double BOOSTER_FUEL_MASS = 395700.0;
+const double SPECIFIC_IMPULSE = 282.0;
+const double THRUST_SEALEVEL = 5885000.0;
+const double THRUST_VACUUM = 6444000;
+
+const double INTERSTAGE_LENGTH = 1.9; // estimated gap between top of first stage and beginning of merlin engine of second
+
+const double SECONDSTAGE_LENGTH = 13.8;
+const double SECONDSTAGE_MASS = 3900.0; //without fuel
+const double SECONDSTAGE_FUEL_MASS = 92670;
+
+const double FAIRING_LENGTH = 13.1;
+const double FAIRING_MASS = 1750;
+
+const double TOTAL_LENGTH = 70.0;
+
+// height from bottom of falcon to nitrogen thrusters - necessary to calculate torque
+const double NITROGEN_HEIGHT = 38.0;
+
+
+// keep track of info about Booster, Payload, and general falcon
+class RocketPart
+{
+public:
+    // vectors for center of mass position and velocity
+    double pos_cm[2];
+    double vel_cm[2];
+    double mass;
+    double FuelPercentage = 1.0;
+    double GimbalBeta = 0.0;
+    double GimbalRate = 0.5; // radians per second the engine swivels while a gimbal key is held
+
+    // for rotation
+    double MomentofInertia;
+    double omega;
+    double theta;
+    double torque;
+
+    // distance between pos_cm and center of earth
+    double dist_to_earth;
+
+    // vectors for the top point of the part and bottom point (necessary for orientation)
+    double part_top[2];
+    double part_bottom[2];
+
+    double cm_location; // (number between 0 and 1) (where part_top is 0 and part_bottom is 1)
+
+    double part_width = 3.66;
+    double part_height;
+
+    // forces (ones with 3 have magnitude in the 3rd element)
+    double gravity[2];
+    double air_resistance[2];
+    double main_thrust[3];
+    // nitrogen thrusters
+    double nit_thrust_left[3];
+    double nit_thrust_right[3];
+};
+
+
+// keep track of user inputs
+class switches
+{
+public:
+    bool rocketOn = false;
+    bool ZoomOut = false;
+    bool RotClock = false;
+    bool RotCountClock = false;
+    bool Detached = false;
+    bool Liftoff = false;
+    bool GimbalClock = false;
+    bool GimbalCountClock = false;
+    bool LegsDeployed = false;
+    bool Exploded = false;
+    bool SecondExploded = false;
+    bool LandedSuccess = false;
+    bool WelcomeScreen = true;
+    bool Paused = false;
+};
+
+// The switches the booster's physics branch on, packed into a flight phase: on the pad, stacked ascent (burning
+// or coasting) and the lone booster on its way back (burning or coasting), with which nitrogen thrusters are
+// firing and which way the gimbal is being driven. getPosition() and falconRates() each have a kernel built
+// per phase with these switches folded in at compile time, and pick it from the phase at the start of every
+// step instead of testing the switches all the way through. A booster that has landed or blown up isn't
+// stepped at all (see stepFalconWithContact()). The second stage has a kernel for before and after its engine
+// lights (see getSecStagePosition()), and its coast is its own path (see Kepler.h).
+const int PHASE_DETACHED = 1;
+const int PHASE_LIFTOFF = 2;
+const int PHASE_BURNING = 4;
+const int PHASE_ROT_CLOCK = 8;
+const int PHASE_ROT_COUNTCLOCK = 16;
+const int PHASE_GIMBAL_CLOCK = 32;
+const int PHASE_GIMBAL_COUNTCLOCK = 64;
+const int PHASE_COUNT = 128;
+
+inline int flightPhase(const switches &CheckList){
+    return (CheckList.Detached ? PHASE_DETACHED : 0) | (CheckList.Liftoff ? PHASE_LIFTOFF : 0) | (CheckList.rocketOn ? PHASE_BURNING : 0) |
+        (CheckList.RotClock ? PHASE_ROT_CLOCK : 0) | (CheckList.RotCountClock ? PHASE_ROT_COUNTCLOCK : 0) |
+        (CheckList.GimbalClock ? PHASE_GIMBAL_CLOCK : 0) | (CheckList.GimbalCountClock ? PHASE_GIMBAL_COUNTCLOCK : 0);
+}
+
+// the phases 0 .. PHASE_COUNT - 1 as a parameter pack, for building the kernel tables indexed by flightPhase()
+template <int... Phases> struct PhaseList {};
+template <int N, int... Phases> struct AllPhases : AllPhases<N - 1, N - 1, Phases...> {};
+template <int... Phases> struct AllPhases<0, Phases...> { typedef PhaseList<Phases...> type; };
+
+class AtmosphereTable;
+class VehicleConfig;
+class Timeline;
+class TelemetryRecorder;
+class ReplayRecorder;
+
+// how getPosition's job of moving the booster forward in time is done, see Integrator.h
+enum IntegratorType
+{
+    MixedEuler,         // the original getPosition() scheme
+    SemiImplicitEuler,
+    RungeKutta4,
+    DormandPrince,      // RK5(4) with error control, takes as many substeps as the tolerance needs
+    Verlet              // velocity Verlet, symplectic, meant for coasting
+};
+
+// everything one flight needs, so independent flights can run side by side (one per thread)
+class SimulationContext
+{
+public:
+    RocketPart Falcon, SecondStage;
+    switches CheckList;
+    
+    double DeltaT = TIME_INCREMENT;     // length of the step being taken
+    double TimeSinceLaunch = 0.0;
+    double TimeofDetach = 0.0;
+    double SimulationTime = 0.0;        // advances on every step, even before liftoff
+    
+    // necessary for air resistance calculation
+    const AtmosphereTable *Atmosphere;  // the 1976 US Standard Atmosphere unless set otherwise, see Atmosphere.h
+    const VehicleConfig *Vehicle;       // the Falcon 9 v1.1 unless constructed with another, see Vehicle.h
+    double air_density = 0.0;
+    
+    IntegratorType Integrator = MixedEuler;
+    double Tolerance = 1e-6;            // relative error per step allowed by DormandPrince
+    double AdaptiveStep = 0.01;         // step DormandPrince will try next
+    long long ForceEvaluations = 0;     // times the forces on the booster have been worked out
+    
+    TelemetryRecorder *Telemetry = 0;   // handed the state after every step when set, see Telemetry.h
+    ReplayRecorder *Replay = 0;         // told about every step and control when set, see Replay.h
+    
+    SimulationContext(); // starts on the pad, see refreshVariables()
+    explicit SimulationContext(const VehicleConfig &vehicle);
+};
+
+// runs the physics at a fixed rate no matter how often it is asked to advance
+class FixedStepper
+{
+public:
+    double PhysicsRate = 1000.0;    // substeps per simulated second
+    int MaxSubsteps = 50000;        // per call, so one slow frame can't snowball into the next
+
+    double accumulator = 0.0;       // simulated time owed but not yet stepped
+    double alpha = 0.0;             // how far between PreviousFalcon and Falcon the leftover time falls
+
+    // state before the last substep, for interpolating the drawing
+    RocketPart PreviousFalcon, PreviousSecondStage;
+
+    // scripted controls, applied between substeps and rewound by reset(), see Timeline.h
+    Timeline *Script = 0;
+
+    // live controls, each applied at exactly its Time by ending a substep there, and dropped by reset()
+    Timeline *Controls = 0;
+
+    int advance(SimulationContext &sim, double frame_time);
+    void reset(const SimulationContext &sim);
+};
+
+
+// declare functions, organized by which functions are contained within which
+void refreshVariables(SimulationContext &sim);
+void runUntil(SimulationContext &sim, double t);
+    void step(SimulationContext &sim, double dt);
+        void ExplodeOrNot(SimulationContext &sim);
+        void SecondExplodeOrNot(SimulationContext &sim);
+        void getPosition(SimulationContext &sim);
+            void updateMassAndMoment(SimulationContext &sim);
+            void updateTorque(SimulationContext &sim);
+            void updateTheta(SimulationContext &sim);
+            void updateVelocity(SimulationContext &sim);
+            void updateForces(SimulationContext &sim);
+        void getSecStagePosition(SimulationContext &sim);
+                void updateMainThrust(SimulationContext &sim);
+void detachStages(SimulationContext &sim);
+
+// mass, cm_location and MomentofInertia of the booster worked out from scratch, see MassProperties.h for the cached version
+void massProperties(const VehicleConfig &vehicle, bool detached, double fuel_percentage, double &mass, double &cm_location, double &moment);
+
+RocketPart interpolateRocketPart(const RocketPart &a, const RocketPart &b, double alpha);
+
+double MagOfVector(double x, double y);
+double twoDCrossMag(double a, double b, double c, double d);
+
+#endif
@@ -0,0 +1,134 @@
+/* Author: William Bryk
+
+ See Snapshot.h.
+ */
+
+#include "Snapshot.h"
+#include <cstring>
+
+const char SNAPSHOT_MAGIC[4] = {'F', '9', 'S', 'S'};
+const uint16_t SNAPSHOT_VERSION = 1;
+
+class SnapshotHeader
+{
+public:
+    char magic[4];
+    uint16_t version;
+    uint16_t part_size;     // sizeof(RocketPart), the parts go in as they are in memory
+};
+
+// the rest of the context after the parts, in one piece so it packs with no gaps between fields
+class SnapshotClock
+{
+public:
+    double DeltaT;
+    double TimeSinceLaunch;
+    double TimeofDetach;
+    double SimulationTime;
+    double air_density;
+    double Tolerance;
+    double AdaptiveStep;
+    int64_t ForceEvaluations;
+    int32_t Integrator;
+    uint32_t switches;
+};
+
+const size_t SNAPSHOT_SIZE = sizeof(SnapshotHeader) + 2*sizeof(RocketPart) + sizeof(SnapshotClock);
+
+uint32_t packSwitches(const switches &CheckList){
+
+    const bool flags[] = {CheckList.rocketOn, CheckList.ZoomOut, CheckList.RotClock, CheckList.RotCountClock, CheckList.Detached, CheckList.Liftoff, CheckList.GimbalClock, CheckList.GimbalCountClock, CheckList.LegsDeployed, CheckList.Exploded, CheckList.SecondExploded, CheckList.LandedSuccess, CheckList.WelcomeScreen, CheckList.Paused};
+
+    uint32_t bits = 0;
+    for (size_t i = 0; i < sizeof(flags)/sizeof(flags[0]); i++)
+        bits |= (uint32_t) flags[i] << i;
+    return bits;
+}
+
+switches unpackSwitches(uint32_t bits){
+
+    switches CheckList;
+    bool *flags[] = {&CheckList.rocketOn, &CheckList.ZoomOut, &CheckList.RotClock, &CheckList.RotCountClock, &CheckList.Detached, &CheckList.Liftoff, &CheckList.GimbalClock, &CheckList.GimbalCountClock, &CheckList.LegsDeployed, &CheckList.Exploded, &CheckList.SecondExploded, &CheckList.LandedSuccess, &CheckList.WelcomeScreen, &CheckList.Paused};
+
+    for (size_t i = 0; i < sizeof(flags)/sizeof(flags[0]); i++)
+        *flags[i] = (bits >> i) & 1;
+    return CheckList;
+}
+
+void saveSnapshot(const SimulationContext &sim, SimulationSnapshot &snapshot){
+
+    SnapshotHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.part_size = sizeof(RocketPart);
+
+    SnapshotClock clock;
+    memset(&clock, 0, sizeof(clock));
+    clock.DeltaT = sim.DeltaT;
+    clock.TimeSinceLaunch = sim.TimeSinceLaunch;
+    clock.TimeofDetach = sim.TimeofDetach;
+    clock.SimulationTime = sim.SimulationTime;
+    clock.air_density = sim.air_density;
+    clock.Tolerance = sim.Tolerance;
+    clock.AdaptiveStep = sim.AdaptiveStep;
+    clock.ForceEvaluations = sim.ForceEvaluations;
+    clock.Integrator = sim.Integrator;
+    clock.switches = packSwitches(sim.CheckList);
+
+    snapshot.Bytes.resize(SNAPSHOT_SIZE);
+    unsigned char *out = snapshot.Bytes.data();
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    memcpy(out, &sim.Falcon, sizeof(RocketPart));
+    out += sizeof(RocketPart);
+    memcpy(out, &sim.SecondStage, sizeof(RocketPart));
+    out += sizeof(RocketPart);
+    memcpy(out, &clock, sizeof(clock));
+}
+
+bool restoreSnapshot(const SimulationSnapshot &snapshot, SimulationContext &sim, std::string &error){
+
+    SnapshotHeader header;
+    if (snapshot.Bytes.size() != SNAPSHOT_SIZE)
+    {
+        error = "snapshot is the wrong size for this build";
+        return false;
+    }
+    const unsigned char *in = snapshot.Bytes.data();
+    memcpy(&header, in, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) || (header.version != SNAPSHOT_VERSION) || (header.part_size != sizeof(RocketPart)))
+    {
+        error = "not a snapshot this build can read";
+        return false;
+    }
+    in += sizeof(header);
+
+    SnapshotClock clock;
+    memcpy(&sim.Falcon, in, sizeof(RocketPart));
+    in += sizeof(RocketPart);
+    memcpy(&sim.SecondStage, in, sizeof(RocketPart));
+    in += sizeof(RocketPart);
+    memcpy(&clock, in, sizeof(clock));
+
+    sim.DeltaT = clock.DeltaT;
+    sim.TimeSinceLaunch = clock.TimeSinceLaunch;
+    sim.TimeofDetach = clock.TimeofDetach;
+    sim.SimulationTime = clock.SimulationTime;
+    sim.air_density = clock.air_density;
+    sim.Tolerance = clock.Tolerance;
+    sim.AdaptiveStep = clock.AdaptiveStep;
+    sim.ForceEvaluations = clock.ForceEvaluations;
+    sim.Integrator = (IntegratorType) clock.Integrator;
+    sim.CheckList = unpackSwitches(clock.switches);
+    return true;
+}
+
+bool forkSnapshot(const SimulationSnapshot &snapshot, const VehicleConfig &vehicle, int copies, std::vector<SimulationContext> &sims, std::string &error){
+
+    sims.clear();
+    SimulationContext sim(vehicle);
+    if (!restoreSnapshot(snapshot, sim, error))
+        return false;
+    sims.assign(copies > 0 ? copies : 0, sim);
+    return true;
+}
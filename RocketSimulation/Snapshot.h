@@ -0,0 +1,38 @@
+/* Author: William Bryk
+
+ The complete state of a flight packed into a small binary blob, to be restored later or forked into
+ as many independent flights as needed.
+
+ A snapshot holds both parts, the switches (packed into bits), the step size, the time counters and the
+ integrator settings, which is everything step() reads or writes. The atmosphere table, the vehicle and the
+ recorder pointers belong to whoever is running the flight, so restoring leaves them as they were. Restoring a
+ snapshot and stepping on gives the same flight bit for bit as never having stopped.
+
+ Blobs are native byte order and only meant to be read back by the same build (they are checked for it).
+ */
+
+#ifndef ROCKETSIMULATION_SNAPSHOT_H
+#define ROCKETSIMULATION_SNAPSHOT_H
+
+#include "Simulation.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class SimulationSnapshot
+{
+public:
+    std::vector<unsigned char> Bytes;
+};
+
+// CheckList, one bit per flag in declaration order
+uint32_t packSwitches(const switches &CheckList);
+switches unpackSwitches(uint32_t bits);
+
+void saveSnapshot(const SimulationContext &sim, SimulationSnapshot &snapshot);
+bool restoreSnapshot(const SimulationSnapshot &snapshot, SimulationContext &sim, std::string &error);
+
+// copies fresh contexts flying vehicle, each picking up where the snapshot left off
+bool forkSnapshot(const SimulationSnapshot &snapshot, const VehicleConfig &vehicle, int copies, std::vector<SimulationContext> &sims, std::string &error);
+
+#endif
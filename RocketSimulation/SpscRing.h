@@ -0,0 +1,82 @@
+/* Author: William Bryk
+
+ Fixed size ring buffer for one producer thread and one consumer thread, with no locks.
+
+ The producer owns Head and the consumer owns Tail. Each only ever reads the other's index, and keeps a
+ stale copy of it so the other thread's cache line is only touched when the ring looks full (or empty).
+ Slots are written in place: claim() a slot, fill it, publish() it. A producer that wants to hand slots
+ over in batches can claim() several ahead of the last one published and publish() them together.
+ */
+
+#ifndef ROCKETSIMULATION_SPSCRING_H
+#define ROCKETSIMULATION_SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+template <class T>
+class SpscRing
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) : Head(0), TailCache(0), Tail(0), HeadCache(0) {
+        size_t size = 1;
+        while (size < capacity)
+            size *= 2;
+        Slots.resize(size);
+        Mask = size - 1;
+    }
+
+    size_t capacity() const { return Mask + 1; }
+    // where a slot from claim() or front() sits in the ring, for keeping data that goes with it alongside
+    size_t indexOf(const T *slot) const { return slot - &Slots[0]; }
+
+    // producer: the free slot ahead slots past the next one, or 0 when the ring is full
+    T *claim(size_t ahead = 0) {
+        size_t head = Head.load(std::memory_order_relaxed) + ahead;
+        if (head - TailCache > Mask)
+        {
+            TailCache = Tail.load(std::memory_order_acquire);
+            if (head - TailCache > Mask)
+                return 0;
+        }
+        return &Slots[head & Mask];
+    }
+
+    // producer: hand the next count slots from claim() to the consumer
+    void publish(size_t count = 1) {
+        Head.store(Head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    // consumer: how many slots are ready, and the run of them that doesn't wrap past the end of the ring
+    size_t available() {
+        HeadCache = Head.load(std::memory_order_acquire);
+        return HeadCache - Tail.load(std::memory_order_relaxed);
+    }
+    const T *front(size_t &contiguous) const {
+        size_t tail = Tail.load(std::memory_order_relaxed);
+        size_t start = tail & Mask;
+        contiguous = HeadCache - tail;
+        if (contiguous > capacity() - start)
+            contiguous = capacity() - start;
+        return &Slots[start];
+    }
+
+    // consumer: give count slots from the front back to the producer
+    void release(size_t count) {
+        Tail.store(Tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+private:
+    std::vector<T> Slots;
+    size_t Mask;
+
+    // each thread's index and its copy of the other's share a cache line only that thread writes to
+    alignas(64) std::atomic<size_t> Head;   // written by the producer
+    size_t TailCache;
+    alignas(64) std::atomic<size_t> Tail;   // written by the consumer
+    size_t HeadCache;
+};
+
+#endif
@@ -0,0 +1,231 @@
+/* Author: William Bryk
+
+ See Telemetry.h.
+ */
+
+#include "Telemetry.h"
+#include "Snapshot.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+const size_t TELEMETRY_FIRST_MAP = 4 << 20;    // bytes mapped to begin with, doubled whenever it fills
+// the drain thread's nap when the ring is empty. It shortens when the last drain found the ring half full
+// and lengthens when it found it nearly empty, so a viewer stepping at a few thousand Hz wakes it a few
+// hundred times a second rather than every 200 us; each wake is a trip through the scheduler that a physics
+// thread sharing the core pays for
+const int TELEMETRY_NAP_MIN_MICROSECONDS = 100;
+const int TELEMETRY_NAP_MAX_MICROSECONDS = 5000;
+
+uint32_t telemetrySwitches(const switches &CheckList){
+    return packSwitches(CheckList);
+}
+
+TelemetryRecorder::TelemetryRecorder(size_t ring_records) : Ring(ring_records), Flags(0), Unpublished(0), Steps(0), LastBits(telemetrySwitches(LastSwitches)), Stopping(false), Writing(false), File(-1), Map(0), MapSize(0), Recorded(0), Dropped(0) {
+}
+
+TelemetryRecorder::~TelemetryRecorder(){
+    close();
+}
+
+// the ring is full: hand over what is written so the drain can get at it, then drop the record or wait for room
+TelemetryRecord *TelemetryRecorder::waitForSlot(){
+
+    publishBatch();
+
+    TelemetryRecord *slot = Ring.claim();
+    if (slot)
+        return slot;
+
+    if (!WaitWhenFull)
+    {
+        Dropped.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    while (!(slot = Ring.claim()))
+        std::this_thread::yield();
+    return slot;
+}
+
+void TelemetryRecorder::recordForces(const SimulationContext &sim, const TelemetryRecord *slot){
+
+    TelemetryForces *forces = &Forces[2 * Ring.indexOf(slot)];
+    fillTelemetryForces(forces[0], sim.Falcon);
+    fillTelemetryForces(forces[1], sim.SecondStage);
+}
+
+void TelemetryRecorder::repackSwitches(const switches &CheckList){
+
+    LastSwitches = CheckList;
+    LastBits = telemetrySwitches(CheckList);
+}
+
+void TelemetryRecorder::publishBatch(){
+
+    Ring.publish(Unpublished);
+    Unpublished = 0;
+}
+
+bool TelemetryRecorder::open(const char *path, std::string &error){
+
+    close();
+
+    File = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (File < 0)
+    {
+        error = std::string("could not open ") + path;
+        return false;
+    }
+    if (!grow(TELEMETRY_FIRST_MAP))
+    {
+        error = std::string("could not map ") + path;
+        ::close(File);
+        File = -1;
+        return false;
+    }
+
+    Flags = RecordForces ? TELEMETRY_FORCES : 0;
+    Forces.assign(RecordForces ? 2 * Ring.capacity() : 0, TelemetryForces());
+
+    TelemetryHeader *header = (TelemetryHeader *) Map;
+    memcpy(header->magic, TELEMETRY_MAGIC, sizeof(header->magic));
+    header->record_size = telemetryRecordSize(Flags);
+    header->flags = Flags;
+    header->record_count = 0;
+    header->dropped = 0;
+
+    Steps = 0;
+    Unpublished = 0;
+    Recorded.store(0);
+    Dropped.store(0);
+    Stopping.store(false);
+    Writing = true;
+    Drainer = std::thread(&TelemetryRecorder::drain, this);
+    return true;
+}
+
+void TelemetryRecorder::close(){
+
+    if (!Writing)
+        return;
+
+    publishBatch();
+    Stopping.store(true, std::memory_order_release);
+    Drainer.join();
+    Writing = false;
+
+    uint64_t count = Recorded.load();
+    if (Map)
+    {
+        TelemetryHeader *header = (TelemetryHeader *) Map;
+        header->record_count = count;
+        header->dropped = Dropped.load();
+        munmap(Map, MapSize);
+    }
+    Map = 0;
+    MapSize = 0;
+
+    // if this fails the file just keeps some zeroed space on the end, the header says where the records stop
+    int trimmed = ftruncate(File, sizeof(TelemetryHeader) + count * telemetryRecordSize(Flags));
+    (void) trimmed;
+    ::close(File);
+    File = -1;
+}
+
+// remap the file at least bytes long, only ever called from the thread that owns Map
+bool TelemetryRecorder::grow(size_t bytes){
+
+    size_t size = MapSize ? MapSize : TELEMETRY_FIRST_MAP;
+    while (size < bytes)
+        size *= 2;
+
+    if (Map)
+        munmap(Map, MapSize);
+    Map = 0;
+    MapSize = 0;
+
+    if (ftruncate(File, size) != 0)
+        return false;
+    void *map = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, File, 0);
+    if (map == MAP_FAILED)
+        return false;
+
+    Map = (char *) map;
+    MapSize = size;
+    return true;
+}
+
+// drain thread: each record followed by the forces kept alongside its slot, the way the file lays them out
+void TelemetryRecorder::copyWithForces(char *out, const TelemetryRecord *records, size_t count){
+
+    const TelemetryForces *forces = &Forces[2 * Ring.indexOf(records)];
+    for (size_t i = 0; i < count; i++)
+    {
+        memcpy(out, &records[i], sizeof(TelemetryRecord));
+        out += sizeof(TelemetryRecord);
+        memcpy(out, &forces[2 * i], 2 * sizeof(TelemetryForces));
+        out += 2 * sizeof(TelemetryForces);
+    }
+}
+
+// background thread: copy whatever the ring holds into the file, then nap until there is more
+void TelemetryRecorder::drain(){
+
+    uint64_t count = 0;
+    const size_t record_size = telemetryRecordSize(Flags);
+    int nap = TELEMETRY_NAP_MIN_MICROSECONDS;
+
+    while (true)
+    {
+        bool stopping = Stopping.load(std::memory_order_acquire);
+        size_t waiting = Ring.available();
+
+        if (waiting == 0)
+        {
+            if (stopping)
+                break;
+            std::this_thread::sleep_for(std::chrono::microseconds(nap));
+            continue;
+        }
+
+        if (waiting > Ring.capacity()/2)
+            nap = std::max(nap/2, TELEMETRY_NAP_MIN_MICROSECONDS);
+        else if (waiting < Ring.capacity()/8)
+            nap = std::min(nap*2, TELEMETRY_NAP_MAX_MICROSECONDS);
+
+        while (waiting > 0)
+        {
+            size_t contiguous;
+            const TelemetryRecord *records = Ring.front(contiguous);
+
+            size_t offset = sizeof(TelemetryHeader) + count * record_size;
+            size_t bytes = contiguous * record_size;
+            if ((offset + bytes <= MapSize) || grow(offset + bytes))
+            {
+                if (Flags & TELEMETRY_FORCES)
+                    copyWithForces(Map + offset, records, contiguous);
+                else
+                    memcpy(Map + offset, records, bytes);
+                count += contiguous;
+            }
+            else
+                Dropped.fetch_add(contiguous, std::memory_order_relaxed);   // out of disk
+
+            Ring.release(contiguous);
+            waiting -= contiguous;
+        }
+
+        // keep the header current, so a run that dies part way still leaves a readable file
+        if (Map)
+        {
+            TelemetryHeader *header = (TelemetryHeader *) Map;
+            header->record_count = count;
+            header->dropped = Dropped.load(std::memory_order_relaxed);
+        }
+        Recorded.store(count, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,178 @@
+/* Author: William Bryk
+
+ Binary flight recorder.
+
+ With SimulationContext::Telemetry set, step() hands the recorder the state after every step. record()
+ copies it into a slot of a lock-free ring (see SpscRing.h) and returns, handing the slots it has written
+ to a background thread TELEMETRY_BATCH at a time; the thread drains them into a memory-mapped file,
+ growing the mapping as it fills. The ring is kept small enough to stay in cache and the copy is a straight
+ run of doubles with nothing worked out on the way, which is what keeps record() cheap. If the drain falls
+ so far behind that the ring fills, the record is dropped and counted in the header, unless WaitWhenFull
+ is set (for headless runs that want every step and would rather be held up).
+
+ A record only holds the state a step can't be worked back out from: where each part is, how it is
+ moving and turning, its fuel and mass, the gimbal angle and the switches. The forces follow from that
+ state and the vehicle, so they are only written when RecordForces is set, as a TelemetryForces per part
+ after each record (TELEMETRY_FORCES in the header flags).
+
+ The file is a TelemetryHeader followed by one record per step, all native byte order and doubles, so it
+ can be read back with a single mmap or fread.
+ */
+
+#ifndef ROCKETSIMULATION_TELEMETRY_H
+#define ROCKETSIMULATION_TELEMETRY_H
+
+#include "Simulation.h"
+#include "SpscRing.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+const char TELEMETRY_MAGIC[8] = {'F', '9', 'T', 'L', 'M', 'v', '3', '\0'};
+
+class TelemetryHeader
+{
+public:
+    char magic[8];
+    uint32_t record_size;           // telemetryRecordSize(flags), to catch a reader built against another layout
+    uint32_t flags;                 // TELEMETRY_FORCES
+    uint64_t record_count;
+    uint64_t dropped;               // records lost to a full ring
+};
+
+const uint32_t TELEMETRY_FORCES = 1;    // each record is followed by the Falcon's then the second stage's TelemetryForces
+
+// the state of one part at the end of a step, in the order RocketPart keeps it so the copy is two straight runs
+class TelemetryPart
+{
+public:
+    double pos_cm[2];
+    double vel_cm[2];
+    double mass;
+    double FuelPercentage;
+    double GimbalBeta;
+    double omega;
+    double theta;
+};
+
+// what the step worked out from the state, only recorded with RecordForces
+class TelemetryForces
+{
+public:
+    double torque;
+    double cm_location;
+    double air_resistance[2];
+    double main_thrust[2];
+};
+
+class TelemetryRecord
+{
+public:
+    double SimulationTime;
+    double TimeSinceLaunch;
+    uint32_t switches;              // CheckList, one bit per flag in declaration order (see packSwitches)
+    uint32_t step;                  // steps recorded so far, wraps
+    TelemetryPart Falcon;
+    TelemetryPart SecondStage;
+};
+
+inline void fillTelemetryPart(TelemetryPart &out, const RocketPart &part){
+    out.pos_cm[0] = part.pos_cm[0]; out.pos_cm[1] = part.pos_cm[1];
+    out.vel_cm[0] = part.vel_cm[0]; out.vel_cm[1] = part.vel_cm[1];
+    out.mass = part.mass;
+    out.FuelPercentage = part.FuelPercentage;
+    out.GimbalBeta = part.GimbalBeta;
+    out.omega = part.omega;
+    out.theta = part.theta;
+}
+
+inline void fillTelemetryForces(TelemetryForces &out, const RocketPart &part){
+    out.torque = part.torque;
+    out.cm_location = part.cm_location;
+    out.air_resistance[0] = part.air_resistance[0]; out.air_resistance[1] = part.air_resistance[1];
+    out.main_thrust[0] = part.main_thrust[0]; out.main_thrust[1] = part.main_thrust[1];
+}
+
+// bytes per record in a file with these header flags
+inline size_t telemetryRecordSize(uint32_t flags){
+    return sizeof(TelemetryRecord) + ((flags & TELEMETRY_FORCES) ? 2 * sizeof(TelemetryForces) : 0);
+}
+
+uint32_t telemetrySwitches(const switches &CheckList);
+
+const size_t TELEMETRY_BATCH = 16;      // records written before they are handed to the drain together
+
+class TelemetryRecorder
+{
+public:
+    explicit TelemetryRecorder(size_t ring_records = 2048);
+    ~TelemetryRecorder();
+
+    // start writing to path, false with a message if the file can't be set up
+    bool open(const char *path, std::string &error);
+    // drain what is left, fill in the header and trim the file to size
+    void close();
+    bool isOpen() const { return Writing; }
+
+    // called by step() on the physics thread
+    void record(const SimulationContext &sim) {
+        TelemetryRecord *slot = Ring.claim(Unpublished);
+        if (!slot && !(slot = waitForSlot()))
+            return;
+
+        // the switches hardly ever change, so they are only packed again when they do
+        if (memcmp(&LastSwitches, &sim.CheckList, sizeof(switches)))
+            repackSwitches(sim.CheckList);
+
+        slot->SimulationTime = sim.SimulationTime;
+        slot->TimeSinceLaunch = sim.TimeSinceLaunch;
+        slot->switches = LastBits;
+        slot->step = Steps++;
+        fillTelemetryPart(slot->Falcon, sim.Falcon);
+        fillTelemetryPart(slot->SecondStage, sim.SecondStage);
+        if (RecordForces)
+            recordForces(sim, slot);
+
+        if (++Unpublished == TELEMETRY_BATCH)
+            publishBatch();
+    }
+
+    bool WaitWhenFull = false;
+    bool RecordForces = false;      // set before open()
+
+    uint64_t recorded() const { return Recorded.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return Dropped.load(std::memory_order_relaxed); }
+
+private:
+    TelemetryRecord *waitForSlot();
+    void recordForces(const SimulationContext &sim, const TelemetryRecord *slot);
+    void repackSwitches(const switches &CheckList);
+    void publishBatch();
+    void drain();
+    void copyWithForces(char *out, const TelemetryRecord *records, size_t count);
+    bool grow(size_t bytes);
+
+    SpscRing<TelemetryRecord> Ring;
+    std::vector<TelemetryForces> Forces;    // two per slot of Ring, with RecordForces
+    uint32_t Flags;
+    size_t Unpublished;             // records written but not yet handed to the drain
+    uint32_t Steps;
+    switches LastSwitches;
+    uint32_t LastBits;
+
+    std::thread Drainer;
+    std::atomic<bool> Stopping;
+    bool Writing;
+
+    int File;
+    char *Map;
+    size_t MapSize;
+
+    std::atomic<uint64_t> Recorded;
+    std::atomic<uint64_t> Dropped;
+};
+
+#endif
@@ -0,0 +1,148 @@
+/* Author: William Bryk
+
+ See Timeline.h.
+ */
+
+#include "Timeline.h"
+#include "Replay.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+// same as runUntil(), events this close to the current time count as now
+const double TIMELINE_EPSILON = 1e-9;
+
+static const struct { const char *name; TimelineAction action; } ACTION_NAMES[] = {
+    {"engine on", EngineOn}, {"engine off", EngineOff},
+    {"gimbal-clock on", GimbalClockOn}, {"gimbal-clock off", GimbalClockOff},
+    {"gimbal-counterclock on", GimbalCountClockOn}, {"gimbal-counterclock off", GimbalCountClockOff},
+    {"gimbal-center", GimbalCenter},
+    {"rotate-clock on", RotClockOn}, {"rotate-clock off", RotClockOff},
+    {"rotate-counterclock on", RotCountClockOn}, {"rotate-counterclock off", RotCountClockOff},
+    {"legs on", LegsOn}, {"legs off", LegsOff},
+    {"detach", Detach},
+};
+
+const char *timelineActionName(TimelineAction action){
+
+    for (size_t i = 0; i < sizeof(ACTION_NAMES)/sizeof(ACTION_NAMES[0]); i++)
+        if (ACTION_NAMES[i].action == action)
+            return ACTION_NAMES[i].name;
+    return "unknown";
+}
+
+bool timelineActionFromName(const char *name, TimelineAction &action){
+
+    for (size_t i = 0; i < sizeof(ACTION_NAMES)/sizeof(ACTION_NAMES[0]); i++)
+    {
+        if (!strcmp(ACTION_NAMES[i].name, name))
+        {
+            action = ACTION_NAMES[i].action;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool loadTimeline(const char *path, Timeline &timeline, std::string &error){
+
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        error = std::string("could not open ") + path;
+        return false;
+    }
+
+    timeline.Events.clear();
+    timeline.Next = 0;
+
+    char line[256];
+    for (int line_number = 1; fgets(line, sizeof(line), file); line_number++)
+    {
+        char *comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
+
+        // the words after the time, joined back up with single spaces
+        char *word = strtok(line, " \t\r\n");
+        if (!word)
+            continue;
+
+        char *end;
+        double time = strtod(word, &end);
+        std::string command;
+        for (word = strtok(0, " \t\r\n"); word; word = strtok(0, " \t\r\n"))
+            command += (command.empty() ? "" : " ") + std::string(word);
+
+        TimelineEvent event;
+        event.Time = time;
+        if ((*end != '\0') || !(time >= 0.0) || !timelineActionFromName(command.c_str(), event.Action))
+        {
+            char message[64];
+            snprintf(message, sizeof(message), ":%d: expected '<seconds> <command>'", line_number);
+            error = path + std::string(message);
+            fclose(file);
+            return false;
+        }
+        timeline.Events.push_back(event);
+    }
+    fclose(file);
+
+    std::stable_sort(timeline.Events.begin(), timeline.Events.end(), [](const TimelineEvent &a, const TimelineEvent &b) { return a.Time < b.Time; });
+    return true;
+}
+
+void applyTimelineAction(SimulationContext &sim, TimelineAction action){
+
+    switches &CheckList = sim.CheckList;
+
+    if (sim.Replay)
+        sim.Replay->action(action);
+
+    switch (action)
+    {
+        case EngineOn:
+            CheckList.rocketOn = true;
+            // 3..2..1.. LIFTOFF!!!!!!
+            CheckList.Liftoff = true;
+            break;
+        case EngineOff: CheckList.rocketOn = false; break;
+        case GimbalClockOn: CheckList.GimbalClock = true; break;
+        case GimbalClockOff: CheckList.GimbalClock = false; break;
+        case GimbalCountClockOn: CheckList.GimbalCountClock = true; break;
+        case GimbalCountClockOff: CheckList.GimbalCountClock = false; break;
+        case GimbalCenter: sim.Falcon.GimbalBeta = 0.0; break;
+        case RotClockOn: CheckList.RotClock = true; break;
+        case RotClockOff: CheckList.RotClock = false; break;
+        case RotCountClockOn: CheckList.RotCountClock = true; break;
+        case RotCountClockOff: CheckList.RotCountClock = false; break;
+        case LegsOn: CheckList.LegsDeployed = true; break;
+        case LegsOff: CheckList.LegsDeployed = false; break;
+        case Detach: detachStages(sim); break;
+    }
+}
+
+void applyDueEvents(SimulationContext &sim, Timeline &timeline){
+
+    while ((timeline.Next < timeline.Events.size()) && (timeline.Events[timeline.Next].Time <= sim.SimulationTime + TIMELINE_EPSILON))
+    {
+        applyTimelineAction(sim, timeline.Events[timeline.Next].Action);
+        timeline.Next++;
+    }
+}
+
+void runTimeline(SimulationContext &sim, Timeline &timeline, double t){
+
+    applyDueEvents(sim, timeline);
+
+    while (t - sim.SimulationTime > TIMELINE_EPSILON)
+    {
+        double stop = t;
+        if (timeline.Next < timeline.Events.size())
+            stop = std::min(stop, timeline.Events[timeline.Next].Time);
+
+        runUntil(sim, stop);
+        applyDueEvents(sim, timeline);
+    }
+}
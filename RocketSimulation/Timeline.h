@@ -0,0 +1,60 @@
+/* Author: William Bryk
+
+ Scripted flights: the keyboard controls as a list of timed commands.
+
+ A timeline file has one event per line, the simulation time in seconds (SimulationTime, so counted from the
+ last reset) then the command:
+
+     # hop
+     0.0    engine on
+     8.0    engine off
+     20.5   legs on
+     31.25  gimbal-clock on
+
+ Commands are engine, gimbal-clock, gimbal-counterclock, rotate-clock, rotate-counterclock and legs, each
+ followed by on or off, plus gimbal-center and detach. They do exactly what the matching key does in the
+ viewer. runTimeline() ends a step on every event time and applies the event between steps, so the same
+ timeline, step size and integrator always give the same flight to the last bit, with or without a display.
+ */
+
+#ifndef ROCKETSIMULATION_TIMELINE_H
+#define ROCKETSIMULATION_TIMELINE_H
+
+#include "Simulation.h"
+#include <string>
+#include <vector>
+
+enum TimelineAction { EngineOn, EngineOff, GimbalClockOn, GimbalClockOff, GimbalCountClockOn, GimbalCountClockOff, GimbalCenter, RotClockOn, RotClockOff, RotCountClockOn, RotCountClockOff, LegsOn, LegsOff, Detach };
+
+class TimelineEvent
+{
+public:
+    double Time;
+    TimelineAction Action;
+};
+
+class Timeline
+{
+public:
+    std::vector<TimelineEvent> Events;  // in time order, events at the same time in file order
+    size_t Next = 0;                    // first event not applied yet
+
+    void rewind() { Next = 0; }
+};
+
+// read a timeline file, false with a message naming the line when it can't
+bool loadTimeline(const char *path, Timeline &timeline, std::string &error);
+
+const char *timelineActionName(TimelineAction action);
+bool timelineActionFromName(const char *name, TimelineAction &action);
+
+// what the key for action does
+void applyTimelineAction(SimulationContext &sim, TimelineAction action);
+
+// apply every event that is due by the current SimulationTime
+void applyDueEvents(SimulationContext &sim, Timeline &timeline);
+
+// runUntil() that also stops on each event time on the way to t and applies it there
+void runTimeline(SimulationContext &sim, Timeline &timeline, double t);
+
+#endif
@@ -0,0 +1,48 @@
+/* Author: William Bryk
+
+ Hands the latest version of something from one writer thread to one reader thread, with no locks and no
+ waiting on either side.
+
+ There are three slots. The writer fills its back slot and publish() swaps it with the middle one; the
+ reader's read() swaps its front slot with the middle one if anything new was published since, then
+ reads the front. Neither thread ever touches a slot the other one holds, so the reader always sees a
+ complete version, never one half written, and a writer publishing faster than the reader reads just
+ overwrites versions nobody looked at.
+ */
+
+#ifndef ROCKETSIMULATION_TRIPLEBUFFER_H
+#define ROCKETSIMULATION_TRIPLEBUFFER_H
+
+#include <atomic>
+
+template <class T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : Front(0), Middle(1), Back(2) {}
+
+    // writer: the slot to fill, which still holds whatever was in it three publishes ago
+    T &back() { return Slots[Back]; }
+    // writer: make the back slot the latest version
+    void publish() {
+        Back = Middle.exchange(Back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // reader: the latest published version, or the one read last time if nothing new was published
+    const T &read() {
+        if (Middle.load(std::memory_order_relaxed) & FRESH)
+            Front = Middle.exchange(Front, std::memory_order_acq_rel) & INDEX;
+        return Slots[Front];
+    }
+
+private:
+    static const unsigned INDEX = 3;
+    static const unsigned FRESH = 4;    // set on Middle when it holds a version the reader hasn't had
+
+    T Slots[3];
+    unsigned Front;                     // only the reader's
+    alignas(64) std::atomic<unsigned> Middle;
+    alignas(64) unsigned Back;          // only the writer's
+};
+
+#endif
@@ -0,0 +1,157 @@
+/* Author: William Bryk
+
+ See Vehicle.h.
+ */
+
+#include "Vehicle.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+
+// one line of the file and where it goes
+class VehicleParameter
+{
+public:
+    const char *Name;
+    double VehicleConfig::*Value;
+    bool Positive;      // false for the ones that may be zero
+};
+
+static const VehicleParameter PARAMETERS[] = {
+    {"octaweb_mass", &VehicleConfig::OctawebMass, false},
+    {"booster_length", &VehicleConfig::BoosterLength, true},
+    {"booster_mass", &VehicleConfig::BoosterMass, false},
+    {"booster_fuel_mass", &VehicleConfig::BoosterFuelMass, true},
+    {"specific_impulse", &VehicleConfig::SpecificImpulse, true},
+    {"thrust_sealevel", &VehicleConfig::ThrustSeaLevel, false},
+    {"thrust_vacuum", &VehicleConfig::ThrustVacuum, false},
+    {"interstage_length", &VehicleConfig::InterstageLength, false},
+    {"secondstage_length", &VehicleConfig::SecondStageLength, true},
+    {"secondstage_mass", &VehicleConfig::SecondStageMass, false},
+    {"secondstage_fuel_mass", &VehicleConfig::SecondStageFuelMass, true},
+    {"fairing_length", &VehicleConfig::FairingLength, false},
+    {"fairing_mass", &VehicleConfig::FairingMass, false},
+    {"total_length", &VehicleConfig::TotalLength, true},  // only checked, prepare() adds it up
+    {"nitrogen_height", &VehicleConfig::NitrogenHeight, false},
+    {"nitrogen_thrust", &VehicleConfig::NitrogenThrust, false},
+    {"width", &VehicleConfig::Width, true},
+};
+
+VehicleConfig::VehicleConfig(){
+
+    OctawebMass = OCTAWEB_MASS;
+    BoosterLength = BOOSTER_LENGTH;
+    BoosterMass = BOOSTER_MASS;
+    BoosterFuelMass = BOOSTER_FUEL_MASS;
+    SpecificImpulse = SPECIFIC_IMPULSE;
+    ThrustSeaLevel = THRUST_SEALEVEL;
+    ThrustVacuum = THRUST_VACUUM;
+    InterstageLength = INTERSTAGE_LENGTH;
+    SecondStageLength = SECONDSTAGE_LENGTH;
+    SecondStageMass = SECONDSTAGE_MASS;
+    SecondStageFuelMass = SECONDSTAGE_FUEL_MASS;
+    FairingLength = FAIRING_LENGTH;
+    FairingMass = FAIRING_MASS;
+    NitrogenHeight = NITROGEN_HEIGHT;
+    NitrogenThrust = 10000.0;
+    Width = 3.66;
+
+    prepare();
+}
+
+void VehicleConfig::prepare(){
+
+    // each worked out the way the step used to, so the answers don't move by a bit
+    ExhaustVelocity = SpecificImpulse * 9.8;
+    SecondStageThrust = ThrustVacuum/9.0;
+    SecondStageHeight = SecondStageLength + FairingLength;
+    TotalLength = BoosterLength + InterstageLength + SecondStageLength + FairingLength;
+
+    Stacked.build(*this, false, 1024);
+    Booster.build(*this, true, 1024);
+}
+
+bool loadVehicle(const char *path, VehicleConfig &vehicle, std::string &error){
+
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        error = std::string("could not open ") + path;
+        return false;
+    }
+
+    VehicleConfig loaded;
+    double total_length = -1.0;
+
+    char line[256];
+    for (int line_number = 1; fgets(line, sizeof(line), file); line_number++)
+    {
+        char *comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
+
+        char *name = strtok(line, " \t\r\n");
+        if (!name)
+            continue;
+        char *word = strtok(0, " \t\r\n");
+        char *extra = strtok(0, " \t\r\n");
+
+        const VehicleParameter *parameter = 0;
+        for (size_t i = 0; i < sizeof(PARAMETERS)/sizeof(PARAMETERS[0]); i++)
+            if (!strcmp(PARAMETERS[i].Name, name))
+                parameter = &PARAMETERS[i];
+
+        char *end = 0;
+        double value = word ? strtod(word, &end) : 0.0;
+
+        const char *problem = 0;
+        if (!parameter)
+            problem = "unknown parameter";
+        else if (!word || (*end != '\0') || extra)
+            problem = "expected '<parameter> <value>'";
+        else if (parameter->Positive ? !(value > 0.0) : !(value >= 0.0))
+            problem = parameter->Positive ? "must be more than zero" : "can't be negative";
+
+        if (problem)
+        {
+            char message[128];
+            snprintf(message, sizeof(message), ":%d: %s", line_number, problem);
+            error = path + std::string(message);
+            fclose(file);
+            return false;
+        }
+        if (parameter->Value == &VehicleConfig::TotalLength)
+            total_length = value;
+        else
+            loaded.*(parameter->Value) = value;
+    }
+    fclose(file);
+
+    loaded.prepare();
+
+    // massProperties() places each part by the four lengths but measures the center of mass along TotalLength
+    char message[192];
+    if ((total_length >= 0.0) && (std::abs(total_length - loaded.TotalLength) > 0.001))
+        snprintf(message, sizeof(message), ": total_length %g isn't booster_length + interstage_length + secondstage_length + fairing_length (%g)", total_length, loaded.TotalLength);
+    else if (loaded.NitrogenHeight > loaded.BoosterLength)
+        snprintf(message, sizeof(message), ": nitrogen_height %g is above the top of the booster (%g)", loaded.NitrogenHeight, loaded.BoosterLength);
+    else
+        message[0] = '\0';
+
+    if (message[0])
+    {
+        error = path + std::string(message);
+        return false;
+    }
+
+    vehicle = loaded;
+    return true;
+}
+
+const VehicleConfig &falcon9Vehicle(){
+
+    static const VehicleConfig falcon9;
+    return falcon9;
+}
@@ -0,0 +1,81 @@
+/* Author: William Bryk
+
+ Vehicle definitions read from a file instead of compiled in.
+
+ A VehicleConfig holds everything about the rocket the physics reads: masses, lengths, engines and nitrogen
+ thrusters. prepare() works out what follows from them once, so a step costs the same as it did with the
+ constants: the mass tables of both configurations (see MassProperties.h) and the handful of products and
+ quotients the step would otherwise repeat. Every SimulationContext points at one (the Falcon 9 v1.1 of the
+ constants in Simulation.h unless set otherwise), so flights of different vehicles can run side by side, in
+ an ensemble or in the lanes of a RocketBatch, without rebuilding anything.
+
+ The step loads these figures rather than having them folded in as constants, but the fields it reads share
+ the config's first cache line and cost it no measurable time.
+
+ A vehicle file has one parameter per line, its name then its value, and anything after # is a comment.
+ Parameters that are left out keep their Falcon 9 v1.1 value:
+
+     # Falcon 9 with a stretched tank
+     booster_length      44.0
+     booster_fuel_mass   420000
+
+ The total length is the booster, interstage, second stage and fairing added up, so stretching one part
+ stretches the rocket. total_length may still be given as a check, and a file is turned down when it doesn't
+ match the parts to the millimeter or when nitrogen_height puts the thrusters above the top of the booster.
+
+ The names are the lowercase forms of the constants in Simulation.h (octaweb_mass, booster_length,
+ booster_mass, booster_fuel_mass, specific_impulse, thrust_sealevel, thrust_vacuum, interstage_length,
+ secondstage_length, secondstage_mass, secondstage_fuel_mass, fairing_length, fairing_mass, total_length,
+ nitrogen_height), plus nitrogen_thrust in newtons per thruster and width in meters.
+ */
+
+#ifndef ROCKETSIMULATION_VEHICLE_H
+#define ROCKETSIMULATION_VEHICLE_H
+
+#include "MassProperties.h"
+#include <string>
+
+class alignas(64) VehicleConfig
+{
+public:
+    VehicleConfig();    // the Falcon 9 v1.1, prepared
+
+    // what the step reads, kept together at the front
+    double BoosterLength;
+    double BoosterFuelMass;
+    double TotalLength;             // BoosterLength + InterstageLength + SecondStageLength + FairingLength
+    double NitrogenHeight;
+    double ThrustSeaLevel;
+    double ExhaustVelocity;         // SpecificImpulse * 9.8
+    double SecondStageThrust;       // one vacuum engine, ThrustVacuum/9.0
+    double SecondStageHeight;       // SecondStageLength + FairingLength
+    double SecondStageMass;
+    double SecondStageFuelMass;
+    double FairingMass;
+
+    double OctawebMass;
+    double BoosterMass;
+    double SpecificImpulse;
+    double ThrustVacuum;
+    double InterstageLength;
+    double SecondStageLength;
+    double FairingLength;
+    double NitrogenThrust;
+    double Width;
+
+    // massProperties() tabulated for the stacked vehicle and the lone booster
+    MassTable Stacked, Booster;
+
+    const MassTable &massTable(bool detached) const { return detached ? Booster : Stacked; }
+
+    // work out everything above the parameters from them, after changing any of them
+    void prepare();
+};
+
+// read a vehicle file over the Falcon 9 v1.1 and prepare it, false with a message naming the line when it can't
+bool loadVehicle(const char *path, VehicleConfig &vehicle, std::string &error);
+
+// the Falcon 9 v1.1, built the first time it is asked for
+const VehicleConfig &falcon9Vehicle();
+
+#endif
@@ -0,0 +1,84 @@
+/* Author: William Bryk
+
+ See WarpControl.h.
+ */
+
+#include "WarpControl.h"
+#include "Atmosphere.h"
+#include "Kepler.h"
+#include "Vehicle.h"
+#include <algorithm>
+#include <cmath>
+
+// speed below which a thrusting part is treated as standing still when limiting its change in velocity
+const double SLOW_SPEED = 100.0;
+
+// the longest step part can take, burning or not, under tolerance
+static double partStepLimit(const SimulationContext &sim, const RocketPart &part, bool burning, bool gimballing, bool in_orbit, double tolerance){
+
+    double limit = HUGE_VAL;
+    double speed = MagOfVector(part.vel_cm[0], part.vel_cm[1]);
+    double r = MagOfVector(part.pos_cm[0], part.pos_cm[1] + EARTH_RADIUS);
+    double angle = 10.0 * tolerance;
+
+    if (burning && (part.main_thrust[2] > 0.0))
+    {
+        double accel = part.main_thrust[2]/part.mass;
+        double mass_flow = part.main_thrust[2]/sim.Vehicle->ExhaustVelocity;
+        limit = std::min(limit, tolerance * std::max(speed, SLOW_SPEED)/accel);
+        limit = std::min(limit, tolerance * part.mass/mass_flow);
+    }
+
+    double density = sim.Atmosphere->density(r - EARTH_RADIUS);
+    if ((density > 0.0) && (speed > 0.0))
+    {
+        // the most drag the part can see, side on
+        double area = part.part_width * part.part_height + part.part_width * part.part_width;
+        double drag = .6 * .5 * density * speed * speed * area;
+        limit = std::min(limit, tolerance * part.mass * speed/drag);
+    }
+
+    // turning at omega, and speeding up or slowing down under whatever torque it had last step
+    double spin = std::abs(part.omega);
+    double spin_up = (part.MomentofInertia > 0.0) ? std::abs(part.torque)/part.MomentofInertia : 0.0;
+    if (spin_up > 0.0)
+        limit = std::min(limit, (sqrt(spin * spin + 2.0 * spin_up * angle) - spin)/spin_up);
+    else if (spin > 0.0)
+        limit = std::min(limit, angle/spin);
+    if (gimballing)
+        limit = std::min(limit, angle/part.GimbalRate);
+
+    // a Kepler coast is exact at any step, anything else follows gravity step by step
+    if (!in_orbit)
+        limit = std::min(limit, tolerance * sqrt(r * r * r/EARTH_GM));
+
+    double height = MagOfVector(part.part_bottom[0], part.part_bottom[1] + EARTH_RADIUS) - EARTH_RADIUS;
+    double climb = (part.vel_cm[0] * part.pos_cm[0] + part.vel_cm[1] * (part.pos_cm[1] + EARTH_RADIUS))/r;
+    if ((climb < 0.0) && (height > 0.0))
+        limit = std::min(limit, 10.0 * tolerance * height/(-climb));
+
+    return limit;
+}
+
+double WarpControl::stepLimit(const SimulationContext &sim) const{
+
+    const switches &CheckList = sim.CheckList;
+    double limit = MaxStep;
+
+    // a booster that has blown up or landed isn't going anywhere
+    if (!CheckList.Exploded && !CheckList.LandedSuccess && (CheckList.Liftoff || CheckList.rocketOn))
+        limit = std::min(limit, partStepLimit(sim, sim.Falcon, CheckList.rocketOn, CheckList.GimbalClock || CheckList.GimbalCountClock, false, Tolerance));
+
+    if (CheckList.Detached && !CheckList.SecondExploded)
+        limit = std::min(limit, partStepLimit(sim, sim.SecondStage, true, false, secondStageCoasting(sim), Tolerance));
+
+    return std::max(limit, MinStep);
+}
+
+double WarpControl::maxWarp(const SimulationContext &sim) const{
+    return StepBudget * stepLimit(sim);
+}
+
+double WarpControl::stepSize(const SimulationContext &sim, double warp) const{
+    return std::max(MinStep, std::min(warp/StepBudget, stepLimit(sim)));
+}
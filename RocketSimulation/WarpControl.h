@@ -0,0 +1,47 @@
+/* Author: William Bryk
+
+ Time warp that keeps the physics honest.
+
+ Doubling the warp used to mean the same millisecond steps, twice as many of them, until the stepper
+ couldn't keep up and silently dropped time. Taking longer steps instead is no better blindly: drag gets
+ zeroed by updateForces()'s guard, burns lose fuel in big coarse chunks, and the booster can sail through
+ its landing in one step.
+
+ WarpControl works out, from the flight as it stands, the longest step every part of it can take while
+ staying inside Tolerance:
+
+     thrust       velocity changes by at most Tolerance of itself (or of SLOW_SPEED, from a standstill),
+                  and mass by at most Tolerance of itself
+     drag         velocity changes by at most Tolerance of itself, well inside updateForces()'s guard
+     attitude     the part turns by at most 10 x Tolerance radians, and the engine gimbals by no more
+     gravity      at most Tolerance of an orbit radian
+     the ground   a descending part covers at most 10 x Tolerance of its height
+
+ and then spends at most StepBudget steps per second of real time. The step is as short as the budget
+ allows (never under MinStep, the old fixed step) and as long as the warp needs, up to that limit; warp
+ beyond what the budget can carry at the limit is capped, so burns, the atmosphere and the last stretch to
+ the ground run slower than asked while coasting runs as fast as asked.
+ */
+
+#ifndef ROCKETSIMULATION_WARPCONTROL_H
+#define ROCKETSIMULATION_WARPCONTROL_H
+
+#include "Simulation.h"
+
+class WarpControl
+{
+public:
+    double Tolerance = 1e-3;
+    double MinStep = 0.001;         // never shorter, whatever the budget (seconds)
+    double MaxStep = 1.0;           // never longer, whatever the flight
+    double StepBudget = 200000.0;   // steps per second of real time, about 5% of a core
+
+    // the longest step the flight can take right now
+    double stepLimit(const SimulationContext &sim) const;
+    // the most warp the budget can carry at that step
+    double maxWarp(const SimulationContext &sim) const;
+    // the step to run the flight at warp with (warp should already be within maxWarp())
+    double stepSize(const SimulationContext &sim, double warp) const;
+};
+
+#endif
@@ -0,0 +1,96 @@
+/* Author: William Bryk
+
+ See WorkStealingPool.h.
+ */
+
+#include "WorkStealingPool.h"
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// one worker's share of the tasks
+class TaskQueue
+{
+public:
+    std::deque<int> tasks;
+    std::mutex lock;
+
+    // the owner takes from the back
+    bool pop(int &task){
+        std::lock_guard<std::mutex> guard(lock);
+        if (tasks.empty())
+            return false;
+        task = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+
+    // thieves take from the front, away from the owner
+    bool steal(int &task){
+        std::lock_guard<std::mutex> guard(lock);
+        if (tasks.empty())
+            return false;
+        task = tasks.front();
+        tasks.pop_front();
+        return true;
+    }
+};
+
+int defaultThreadCount(){
+
+    int count = (int) std::thread::hardware_concurrency();
+    return (count > 0) ? count : 1;
+}
+
+void runParallel(int task_count, int thread_count, const std::function<void(int task, int worker)> &task){
+
+    if (task_count <= 0)
+        return;
+
+    if (thread_count <= 0)
+        thread_count = defaultThreadCount();
+    if (thread_count > task_count)
+        thread_count = task_count;
+
+    // hand out contiguous blocks, reversed so each owner starts at the low end of its block
+    std::vector<TaskQueue> queues(thread_count);
+    for (int w = 0; w < thread_count; w++)
+    {
+        int begin = (int) ((long long) task_count * w / thread_count);
+        int end = (int) ((long long) task_count * (w + 1) / thread_count);
+        for (int i = end - 1; i >= begin; i--)
+            queues[w].tasks.push_back(i);
+    }
+
+    // tasks are never added once work starts, so a worker that finds every queue empty is done
+    std::function<void(int)> work = [&](int worker){
+        int index;
+        while (true)
+        {
+            if (queues[worker].pop(index))
+            {
+                task(index, worker);
+                continue;
+            }
+
+            bool stole = false;
+            for (int k = 1; k < thread_count && !stole; k++)
+                stole = queues[(worker + k) % thread_count].steal(index);
+
+            if (!stole)
+                return;
+            task(index, worker);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int w = 1; w < thread_count; w++)
+        threads.push_back(std::thread(work, w));
+
+    // the calling thread is worker 0
+    work(0);
+
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+}
@@ -0,0 +1,22 @@
+/* Author: William Bryk
+
+ Small work-stealing thread pool for running many independent flights.
+
+ Every worker starts with its own contiguous block of task indices. It works from the back of its own
+ queue, and once that runs dry it steals from the front of the other workers' queues, so a few long
+ flights on one thread don't leave the rest of the cores idle.
+ */
+
+#ifndef ROCKETSIMULATION_WORKSTEALINGPOOL_H
+#define ROCKETSIMULATION_WORKSTEALINGPOOL_H
+
+#include <functional>
+
+// number of workers to use when the caller asks for 0
+int defaultThreadCount();
+
+// call task(index, worker) once for every index in [0, task_count), spread over thread_count threads.
+// returns once every task has finished
+void runParallel(int task_count, int thread_count, const std::function<void(int task, int worker)> &task);
+
+#endif
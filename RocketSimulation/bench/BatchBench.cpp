@@ -0,0 +1,112 @@
+/* Author: William Bryk
+
+ Throughput of the batched booster kernel against the scalar getPosition() path.
+
+ Every vehicle starts from the same ascent, 30 s after liftoff, each with a slightly different attitude
+ so no two lanes are identical. All three runs step the same vehicles by the same amount.
+
+ usage: BatchBench [--vehicles N] [--steps N] [--dt seconds]
+ */
+
+#include "../RocketBatch.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+
+    int vehicles = 4096;
+    int steps = 1000;
+    double dt = 0.001;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--vehicles") && i + 1 < argc)
+            vehicles = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--steps") && i + 1 < argc)
+            steps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--dt") && i + 1 < argc)
+            dt = atof(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [--vehicles N] [--steps N] [--dt seconds]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (vehicles < 1 || steps < 1)
+    {
+        fprintf(stderr, "need at least one vehicle and one step\n");
+        return 1;
+    }
+
+    // fly one vehicle up to the starting point
+    SimulationContext ascent;
+    ascent.CheckList.Liftoff = true;
+    ascent.CheckList.rocketOn = true;
+    runUntil(ascent, 10.0);
+    ascent.CheckList.GimbalClock = true;
+    runUntil(ascent, 10.1);
+    ascent.CheckList.GimbalClock = false;
+    runUntil(ascent, 30.0);
+
+    std::vector<SimulationContext> flights(vehicles, ascent);
+    for (int i = 0; i < vehicles; i++)
+    {
+        flights[i].Falcon.theta += 0.001 * (i % 17);
+        flights[i].Falcon.omega += 0.0001 * (i % 5);
+        flights[i].CheckList.RotClock = (i % 3 == 0);
+        flights[i].DeltaT = dt;
+    }
+
+    RocketBatch scalar_batch, simd_batch;
+    scalar_batch.resize(vehicles);
+    for (int i = 0; i < vehicles; i++)
+        loadBatchLane(scalar_batch, i, flights[i]);
+    simd_batch = scalar_batch;
+
+    // scalar path, one context at a time
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < vehicles; i++)
+        for (int s = 0; s < steps; s++)
+            getPosition(flights[i]);
+    double scalar_seconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++)
+        stepBatchScalar(scalar_batch, dt);
+    double batch_seconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; s++)
+        stepBatchSimd(simd_batch, dt);
+    double simd_seconds = secondsSince(start);
+
+    // how far the batch drifted from the scalar path, and from itself
+    double worst_position = 0.0, worst_velocity = 0.0, worst_lanes = 0.0;
+    for (int i = 0; i < vehicles; i++)
+    {
+        const RocketPart &Falcon = flights[i].Falcon;
+        worst_position = std::fmax(worst_position, MagOfVector(simd_batch.pos_x[i] - Falcon.pos_cm[0], simd_batch.pos_y[i] - Falcon.pos_cm[1]));
+        worst_velocity = std::fmax(worst_velocity, MagOfVector(simd_batch.vel_x[i] - Falcon.vel_cm[0], simd_batch.vel_y[i] - Falcon.vel_cm[1]));
+        worst_lanes = std::fmax(worst_lanes, MagOfVector(simd_batch.pos_x[i] - scalar_batch.pos_x[i], simd_batch.pos_y[i] - scalar_batch.pos_y[i]));
+    }
+
+    double vehicle_steps = (double) vehicles * steps;
+
+    printf("vehicles %d, steps %d, dt %g s, simd width %d\n", vehicles, steps, dt, batchSimdWidth());
+    printf("%-18s %10s %14s %9s\n", "path", "seconds", "ns/vehicle-step", "speedup");
+    printf("%-18s %10.3f %14.1f %9.2f\n", "getPosition", scalar_seconds, 1e9 * scalar_seconds/vehicle_steps, 1.0);
+    printf("%-18s %10.3f %14.1f %9.2f\n", "batch scalar", batch_seconds, 1e9 * batch_seconds/vehicle_steps, scalar_seconds/batch_seconds);
+    printf("%-18s %10.3f %14.1f %9.2f\n", "batch simd", simd_seconds, 1e9 * simd_seconds/vehicle_steps, scalar_seconds/simd_seconds);
+    printf("largest difference from getPosition: %.3g m, %.3g m/s\n", worst_position, worst_velocity);
+    printf("largest difference simd vs scalar batch: %.3g m\n", worst_lanes);
+
+    return 0;
+}
@@ -0,0 +1,214 @@
+/* Author: William Bryk
+
+ Time per call of each function on the physics hot path, and of a whole step(), in every phase of a flight.
+
+ Each phase starts from a state flown to ahead of time: on the pad, powered ascent, the booster falling
+ after separation under a burning second stage, the second stage burnt out and coasting above the air, and the booster's
+ landing burn. A sample is batch calls in a row from a fresh copy of that state, and the best and median
+ of repeats samples are reported, in ns per call. getSecStagePosition() is only timed once there is a second
+ stage to move.
+
+ The results go to stdout (or --out) as JSON so runs can be kept and compared over time.
+
+ usage: PhysicsBench [--batch N] [--repeats N] [--dt seconds] [--integrator name] [--out file]
+ */
+
+#include "../Simulation.h"
+#include "../Integrator.h"
+#include "../Kepler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+typedef void (*PhysicsFunction)(SimulationContext &sim);
+
+class BenchFunction
+{
+public:
+    const char *Name;
+    PhysicsFunction Function;
+    bool NeedsSecondStage;
+};
+
+class BenchPhase
+{
+public:
+    const char *Name;
+    SimulationContext Start;
+};
+
+class BenchResult
+{
+public:
+    const char *Phase;
+    const char *Function;
+    double Best;        // ns per call
+    double Median;
+};
+
+static void wholeStep(SimulationContext &sim){
+    step(sim, sim.DeltaT);
+}
+
+const BenchFunction FUNCTIONS[] = {
+    {"getPosition", getPosition, false},
+    {"updateForces", updateForces, false},
+    {"updateMassAndMoment", updateMassAndMoment, false},
+    {"updateTorque", updateTorque, false},
+    {"updateTheta", updateTheta, false},
+    {"updateMainThrust", updateMainThrust, false},
+    {"getSecStagePosition", getSecStagePosition, true},
+    {"step", wholeStep, false},
+};
+
+static void flyUntil(SimulationContext &sim, double t, double dt){
+    sim.DeltaT = dt;
+    runUntil(sim, t);
+}
+
+// the states every phase starts from, all at step size dt
+static std::vector<BenchPhase> flightPhases(double dt, IntegratorType integrator){
+
+    std::vector<BenchPhase> phases;
+    SimulationContext sim;
+    sim.CheckList.WelcomeScreen = false;
+    sim.Integrator = integrator;
+    sim.DeltaT = dt;
+
+    BenchPhase pad = {"pad", sim};
+    phases.push_back(pad);
+
+    // straight up, nobody at the controls to keep a pitched over rocket from tumbling
+    SimulationContext ascent = sim;
+    ascent.CheckList.Liftoff = true;
+    ascent.CheckList.rocketOn = true;
+    flyUntil(ascent, 30.0, dt);
+    BenchPhase powered = {"ascent", ascent};
+    phases.push_back(powered);
+
+    SimulationContext detached = ascent;
+    flyUntil(detached, 55.0, dt);
+    detachStages(detached);
+    detached.CheckList.rocketOn = false;
+    flyUntil(detached, 60.0, dt);
+    BenchPhase separated = {"detached", detached};
+    phases.push_back(separated);
+
+    // on until the second stage burns out above the air, a second at a time
+    SimulationContext coast = detached;
+    while (!secondStageCoasting(coast) && !coast.CheckList.SecondExploded && (coast.SimulationTime < 3000.0))
+        flyUntil(coast, coast.SimulationTime + 1.0, dt);
+    if (secondStageCoasting(coast))
+    {
+        BenchPhase coasting = {"coast", coast};
+        phases.push_back(coasting);
+    }
+    else
+        fprintf(stderr, "the second stage never coasted, skipping the coast phase\n");
+
+    // a hop off the pad with the engine lit again on the way down
+    SimulationContext landing = sim;
+    landing.CheckList.Liftoff = true;
+    landing.CheckList.rocketOn = true;
+    landing.CheckList.LegsDeployed = true;
+    flyUntil(landing, 10.0, dt);
+    landing.CheckList.rocketOn = false;
+    flyUntil(landing, 13.5, dt);
+    landing.CheckList.rocketOn = true;
+    BenchPhase burn = {"landing", landing};
+    phases.push_back(burn);
+
+    return phases;
+}
+
+// best and median ns per call of batch calls in a row, over repeats samples
+static void timeFunction(const BenchPhase &phase, const BenchFunction &function, int batch, int repeats, double &best, double &median){
+
+    std::vector<double> samples(repeats);
+    for (int r = 0; r < repeats; r++)
+    {
+        SimulationContext sim = phase.Start;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < batch; i++)
+            function.Function(sim);
+        samples[r] = 1e9 * std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()/batch;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    best = samples.front();
+    median = (repeats % 2) ? samples[repeats/2] : 0.5 * (samples[repeats/2 - 1] + samples[repeats/2]);
+}
+
+int main(int argc, char** argv) {
+
+    int batch = 1000;
+    int repeats = 15;
+    double dt = 0.001;
+    IntegratorType integrator = MixedEuler;
+    const char *out_path = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--batch") && i + 1 < argc)
+            batch = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--repeats") && i + 1 < argc)
+            repeats = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--dt") && i + 1 < argc)
+            dt = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--integrator") && i + 1 < argc && integratorFromName(argv[i + 1], integrator))
+            i++;
+        else if (!strcmp(argv[i], "--out") && i + 1 < argc)
+            out_path = argv[++i];
+        else
+        {
+            batch = 0;
+            break;
+        }
+    }
+    if (batch < 1 || repeats < 1 || !(dt > 0.0))
+    {
+        fprintf(stderr, "usage: %s [--batch N] [--repeats N] [--dt seconds] [--integrator name] [--out file]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<BenchPhase> phases = flightPhases(dt, integrator);
+
+    std::vector<BenchResult> results;
+    for (size_t p = 0; p < phases.size(); p++)
+        for (size_t f = 0; f < sizeof(FUNCTIONS)/sizeof(FUNCTIONS[0]); f++)
+        {
+            if (FUNCTIONS[f].NeedsSecondStage && !phases[p].Start.CheckList.Detached)
+                continue;
+            BenchResult result = {phases[p].Name, FUNCTIONS[f].Name, 0.0, 0.0};
+            timeFunction(phases[p], FUNCTIONS[f], batch, repeats, result.Best, result.Median);
+            results.push_back(result);
+        }
+
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "could not open %s\n", out_path);
+        return 1;
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"PhysicsBench\",\n");
+    fprintf(out, "  \"unit\": \"ns/call\",\n");
+    fprintf(out, "  \"dt\": %g,\n", dt);
+    fprintf(out, "  \"integrator\": \"%s\",\n", integratorName(integrator));
+    fprintf(out, "  \"batch\": %d,\n", batch);
+    fprintf(out, "  \"repeats\": %d,\n", repeats);
+    fprintf(out, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+        fprintf(out, "    {\"phase\": \"%s\", \"function\": \"%s\", \"best\": %.3f, \"median\": %.3f}%s\n",
+                results[i].Phase, results[i].Function, results[i].Best, results[i].Median, (i + 1 < results.size()) ? "," : "");
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
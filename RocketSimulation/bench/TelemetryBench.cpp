@@ -0,0 +1,127 @@
+/* Author: William Bryk
+
+ Cost of recording telemetry on every step.
+
+ Flies the same powered ascent at the full physics rate with and without a TelemetryRecorder attached,
+ one straight after the other for a number of rounds, and reports the best time per step of each and the
+ median of what recording added in each round (the rounds next to each other see the same machine, so
+ the median holds up better than the difference of the bests when other work comes and goes). The physics
+ thread's own CPU time is what record() adds to a step; the wall time also has the drain thread in it
+ whenever the two share a core. Recording is meant to add under 1% to the physics thread, and the bench
+ exits with 1 when the median overhead is over that. --forces records the forces as well (see Telemetry.h).
+
+ usage: TelemetryBench [--steps N] [--rounds N] [--file path] [--forces]
+ */
+
+#include "../Telemetry.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <time.h>
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double threadSeconds(){
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + 1e-9 * now.tv_nsec;
+}
+
+// ns per step, wall clock and physics thread CPU, for steps steps of a fresh ascent, recording to recorder if it isn't 0
+static void flyAscent(int steps, TelemetryRecorder *recorder, double &wall, double &cpu){
+
+    SimulationContext sim;
+    sim.CheckList.WelcomeScreen = false;
+    sim.CheckList.Liftoff = true;
+    sim.CheckList.rocketOn = true;
+    sim.Telemetry = recorder;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double cpu_start = threadSeconds();
+    for (int i = 0; i < steps; i++)
+        step(sim, 0.001);
+    cpu = 1e9 * (threadSeconds() - cpu_start)/steps;
+    wall = 1e9 * secondsSince(start)/steps;
+}
+
+const double TELEMETRY_BUDGET = 0.01;     // what recording may add to the physics thread's step
+
+static double median(std::vector<double> values){
+    std::sort(values.begin(), values.end());
+    return values[values.size()/2];
+}
+
+int main(int argc, char** argv) {
+
+    int steps = 100000;
+    int rounds = 15;
+    const char *path = "telemetry_bench.tlm";
+    bool forces = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--steps") && i + 1 < argc)
+            steps = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--rounds") && i + 1 < argc)
+            rounds = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--file") && i + 1 < argc)
+            path = argv[++i];
+        else if (!strcmp(argv[i], "--forces"))
+            forces = true;
+        else
+        {
+            fprintf(stderr, "usage: %s [--steps N] [--rounds N] [--file path] [--forces]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (steps < 1 || rounds < 1)
+    {
+        fprintf(stderr, "need at least one step and one round\n");
+        return 1;
+    }
+
+    TelemetryRecorder recorder;
+    recorder.RecordForces = forces;
+    std::string error;
+    if (!recorder.open(path, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    double plain_wall = 1e300, plain_cpu = 1e300, recorded_wall = 1e300, recorded_cpu = 1e300;
+    std::vector<double> added_wall, added_cpu;
+    for (int round = 0; round < rounds; round++)
+    {
+        double wall0, cpu0, wall1, cpu1;
+        flyAscent(steps, 0, wall0, cpu0);
+        flyAscent(steps, &recorder, wall1, cpu1);
+
+        plain_wall = std::min(plain_wall, wall0); plain_cpu = std::min(plain_cpu, cpu0);
+        recorded_wall = std::min(recorded_wall, wall1); recorded_cpu = std::min(recorded_cpu, cpu1);
+        added_wall.push_back((wall1 - wall0)/wall0);
+        added_cpu.push_back((cpu1 - cpu0)/cpu0);
+    }
+    recorder.close();
+
+    printf("steps per round     %d\n", steps);
+    printf("                    physics thread     wall\n");
+    printf("without telemetry   %8.2f ns/step   %8.2f ns/step\n", plain_cpu, plain_wall);
+    printf("with telemetry      %8.2f ns/step   %8.2f ns/step\n", recorded_cpu, recorded_wall);
+    printf("overhead of bests   %8.2f percent   %8.2f percent\n", 100.0 * (recorded_cpu - plain_cpu)/plain_cpu, 100.0 * (recorded_wall - plain_wall)/plain_wall);
+    printf("median overhead     %8.2f percent   %8.2f percent\n", 100.0 * median(added_cpu), 100.0 * median(added_wall));
+    printf("records written     %llu (%llu dropped) to %s, %u bytes each\n", (unsigned long long) recorder.recorded(), (unsigned long long) recorder.dropped(), path, (unsigned) telemetryRecordSize(forces ? TELEMETRY_FORCES : 0));
+
+    if (median(added_cpu) > TELEMETRY_BUDGET)
+    {
+        printf("over budget         recording adds more than %g percent to the physics thread\n", 100.0 * TELEMETRY_BUDGET);
+        return 1;
+    }
+    return 0;
+}
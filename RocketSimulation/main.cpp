@@ -9,21 +9,34 @@ Naturally, the next step is to make an option to automate the launch, delivery,
  An even cooler version could include a launch and landing on Mars (you would be able to fast forward the months-long-journey!)
  */
 
+#ifdef __APPLE__
 #include <GLUT/glut.h>
+#else
+#include <GL/glut.h>
+#endif
 #include <cmath>
 #include <iostream>
 #include <string>
 #include <cstdlib>
-#import "SOIL.h"
-
-GLdouble TimeSinceLaunch = 0.0;
-GLdouble TimeofDetach = 0.0;
-
-//CONSTANTS
-const GLdouble TIME_INCREMENT = .03;
-
-GLdouble DeltaT = TIME_INCREMENT;
-
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "SOIL.h"
+#include "Simulation.h"
+#include "Integrator.h"
+#include "Kepler.h"
+#include "Vehicle.h"
+#include "Timeline.h"
+#include "Telemetry.h"
+#include "Replay.h"
+#include "Profiler.h"
+#include "WarpControl.h"
+#include "RenderBatch.h"
+#include "HudText.h"
+#include "SpscRing.h"
+#include "TripleBuffer.h"
 
 //const GLdouble gfDeltatheta = .1;
 
@@ -38,144 +51,154 @@ GLdouble height_Earth = 400.0;
 // cutoff to accurately draw atmosphere color
 const GLdouble SPACE_HEIGHT = 100000.0;
 
-const GLdouble Pi = 3.141592653;
-
-// necessary for air resistance calculation
-GLdouble T;
-GLdouble pressure;
-GLdouble air_density;
-
-const GLdouble EARTH_RADIUS = 6371000.0;
-const GLdouble PAD_DIAMETER= 200.0;
-
-
-// data taken from http://spaceflight101.com/spacerockets/falcon-9-v1-1-f9r/
-
-const GLdouble OCTAWEB_MASS = 4200.0;  //9.0 M1D's * 470.0;
-
-const GLdouble BOOSTER_LENGTH = 41.2;
-const GLdouble BOOSTER_MASS = 19800.0; //without fuel or OctaWeb (Total weight is actually 24000 kg)
-const GLdouble BOOSTER_FUEL_MASS = 395700.0;
-const GLdouble SPECIFIC_IMPULSE = 282.0;
-const GLdouble THRUST_SEALEVEL = 5885000.0;
-const GLdouble THRUST_VACUUM = 6444000;
-
-const GLdouble INTERSTAGE_LENGTH = 1.9; // estimated gap between top of first stage and beginning of merlin engine of second
-
-const GLdouble SECONDSTAGE_LENGTH = 13.8;
-const GLdouble SECONDSTAGE_MASS = 3900.0; //without fuel
-const GLdouble SECONDSTAGE_FUEL_MASS = 92670;
-
-const GLdouble FAIRING_LENGTH = 13.1;
-const GLdouble FAIRING_MASS = 1750;
-
-const GLdouble TOTAL_LENGTH = 70.0;
-
-
-
-// height from bottom of falcon to nitrogen thrusters - necessary to calculate torque
-const GLdouble NITROGEN_HEIGHT = 38.0;
-
-GLdouble star_locations[80][2]={0.0};
 
-// array of texture ID's
-GLuint	texture[5];
+// the stars sit still in the window, the clouds sit still in the world, both drawn from a PointField
+const int STAR_COUNT = 79;
+const int CLOUD_CELLS = 10;             // clouds this many 300 m cells each way from the rocket
+const GLdouble CLOUD_SPACING = 300.0;
+PointField Stars;
+PointField Clouds;
+
+// the flight being shown, which belongs to the simulation thread once it starts (as does everything down to
+// TimeWarp), see simulationLoop()
+SimulationContext Sim;
+VehicleConfig FlownVehicle;    // when one is given with --vehicle
+
+// controls read from the timeline file named on the command line, if there is one
+Timeline Script;
+
+// every physics step goes to TELEMETRY_FILE while recording, toggled with 't'
+TelemetryRecorder Recorder;
+const char *TELEMETRY_FILE = "flight.tlm";
+
+// recording also writes a replay, which can be opened again with --replay and scrubbed through
+ReplayRecorder ReplayWriter;
+const char *REPLAY_FILE = "flight.replay";
+
+// playing a replay back: Sim is put in the recorded state at ReplayTime every frame instead of being flown
+ReplayPlayer Player;
+bool Replaying = false;
+GLdouble ReplayTime = 0.0;
+
+// how long each part of a frame takes, rolling p50/p99 in the HUD and a Chrome trace to TRACE_FILE toggled with 'f'
+FrameProfiler Profiler;
+const char *TRACE_FILE = "frame_trace.json";
+
+// physics runs at a fixed rate, the drawing is interpolated between the last two physics states
+FixedStepper Stepper;
+
+// simulated seconds per real second, doubled and halved with 'w' and 'q'. ActualWarp is what the flight can
+// take of it: Warp picks the steps, and holds the warp down through burns, the air and landings
+GLdouble TimeWarp = 1.0;
+GLdouble ActualWarp = 1.0;
+WarpControl Warp;
+const GLdouble MAX_TIME_WARP = 2048.0;
+const GLdouble MIN_TIME_WARP = 1.0/4096.0;
+const GLdouble MAX_COAST_TIME_WARP = 16777216.0; // once only a coasting second stage is left, see orbitalCoast()
+
+// what Draw() needs from the simulation thread, published after every time it advances
+class ViewerFrame
+{
+public:
+    RocketPart Falcon, SecondStage;     // interpolated for drawing
+    switches CheckList;
+    GLdouble SimulationTime = 0.0;
+    GLdouble TimeSinceLaunch = 0.0;
+    GLdouble TimeofDetach = 0.0;
+    GLdouble NitrogenHeight = 0.0;      // of the vehicle being flown, for drawing the thrusters
+    IntegratorType Integrator = MixedEuler;
+    long long ForceEvaluations = 0;
+    GLdouble TimeWarp = 1.0;
+    GLdouble ActualWarp = 1.0;
+    GLdouble ReplayEnd = 0.0;
+    bool Recording = false;
+    long long RecordingDropped = 0;     // records the telemetry drain couldn't keep up with
+    long long InputCount = 0;           // keys whose effect is in this frame
+    std::chrono::steady_clock::time_point InputTime;   // when the last of them was pressed
+};
+TripleBuffer<ViewerFrame> Frames;
 
-// keep track of info about Booster, Payload, and general falcon
-class RocketPart
+// keys go from the GLUT callbacks to the simulation thread in order, and are handled there
+class KeyEvent
 {
 public:
-    // vectors for center of mass position and velocity
-    GLdouble pos_cm[2];
-    GLdouble vel_cm[2];
-    GLdouble mass;
-    GLdouble FuelPercentage = 1.0;
-    GLdouble GimbalBeta = 0.0;
-    
-    // for rotation
-    GLdouble MomentofInertia;
-    GLdouble omega;
-    GLdouble theta;
-    GLdouble torque;
-    
-    // distance between pos_cm and center of earth
-    GLdouble dist_to_earth;
-    
-    // vectors for the top point of the part and bottom point (necessary for orientation)
-    GLdouble part_top[2];
-    GLdouble part_bottom[2];
-    
-    GLdouble cm_location; // (number between 0 and 1) (where part_top is 0 and part_bottom is 1)
-    
-    GLdouble part_width = 3.66;
-    GLdouble part_height;
-    
-    // forces (ones with 3 have magnitude in the 3rd element)
-    GLdouble gravity[2];
-    GLdouble air_resistance[2];
-    GLdouble main_thrust[3];
-    // nitrogen thrusters
-    GLdouble nit_thrust_left[3];
-    GLdouble nit_thrust_right[3];
+    int Key;
+    bool Special;       // an arrow key rather than a character
+    bool Down;
+    std::chrono::steady_clock::time_point Time;    // when GLUT handed it over
 };
+SpscRing<KeyEvent> Keys(256);
 
+// flight controls from the keys, which the stepper applies at the simulation time matching when the key went
+// (KeySimTime while the key is handled) rather than whenever the simulation thread got round to it
+Timeline Controls;
+GLdouble KeySimTime = 0.0;
 
-// keep track of user inputs
-class switches
+// keys waiting for the simulation to reach the time they were pressed at, for the input latency in the HUD
+class PendingInput
 {
 public:
-    GLboolean rocketOn = false;
-    GLboolean ZoomOut = false;
-    GLboolean RotClock = false;
-    GLboolean RotCountClock = false;
-    GLboolean Detached = false;
-    GLboolean Liftoff = false;
-    GLboolean GimbalClock = false;
-    GLboolean GimbalCountClock = false;
-    GLboolean LegsDeployed = false;
-    GLboolean Exploded = false;
-    GLboolean SecondExploded = false;
-    GLboolean LandedSuccess = false;
-    GLboolean WelcomeScreen = true;
-    GLboolean Paused = false;
+    GLdouble SimTime;       // its effect is in once the simulation gets here
+    GLdouble Handled;       // the simulation time just after handling it, for spotting a reset or seek back past it
+    std::chrono::steady_clock::time_point Time;
 };
+std::vector<PendingInput> PendingInputs;
+long long InputsApplied = 0;
+std::chrono::steady_clock::time_point LastInputTime;
+
+std::thread SimulationThread;
+std::atomic<bool> SimulationRunning(false);
 
-// create Objects
-RocketPart Falcon, SecondStage;
-switches CheckList;
+// the parts being drawn this frame, from the latest ViewerFrame
+RocketPart ViewFalcon, ViewSecondStage;
 
+// ms from the latest key being pressed to the first frame drawn with its effect
+GLdouble InputLatency = 0.0;
+long long InputsSeen = 0;
+
+// array of texture ID's
+GLuint	texture[5];
+
+// every shape of the frame, drawn in a handful of calls, see RenderBatch.h
+RenderBatch Scene;
+
+// the text over the zoomed in view, and the values each line of it last showed
+HudText Hud;
+HudLine HudLines[4];
 
 
 // declare functions, organized by which functions are contained within which
 void getStars();
+void getClouds();
 
 void Initialize();
 int LoadGLTextures();
 void Timer(int iUnused);
     void Draw();
+        void setCamera(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top);
         void drawClouds(GLdouble color);
         void drawStars();
-        void ExplodeOrNot();
-            void drawExplosion();
-        void SecondExplodeOrNot();
-            void drawSecondExplosion();
-        void getPosition();
-            void updateMassAndMoment();
-            void updateTorque();
-            void updateTheta();
-            void updateVelocity();
-            void updateForces();
-        void getSecStagePosition();
-                void updateMainThrust();
-void drawText(GLdouble x, GLdouble y, char *string_text);
+        void drawExplosion();
+        void drawSecondExplosion();
+        void drawFlame(const RocketPart &part, GLdouble length_x, GLdouble length_y);
+void simulationLoop();
+    void handleKey(const KeyEvent &event);
+        void handleKeyUp(unsigned char key);
+        void handleKeyPressed(unsigned char key);
+        void handleKeySpecialUp(int key);
+        void handleKeySpecial(int key);
+            void control(TimelineAction action);
+    void updateInputs();
+    void advanceSimulation(GLdouble frame_time);
+        bool orbitalCoast();
+    void seekReplay(GLdouble t);
+    void publishFrame();
+void stopSimulation();
 void keyUp (unsigned char key, int x, int y);
 void keyPressed (unsigned char key, int x, int y);
 void keySpecialUp (int key, int x, int y);
 void keySpecial(int key, int x, int y);
-void refreshVariables();
-
-GLdouble MagOfVector(GLdouble x, GLdouble y);
-GLdouble twoDCrossMag(GLdouble a, GLdouble b, GLdouble c, GLdouble d);
+    void pushKey(int key, bool special, bool down);
 
 
 
@@ -183,31 +206,58 @@ GLdouble twoDCrossMag(GLdouble a, GLdouble b, GLdouble c, GLdouble d);
 int main(int iArgc, char** cppArgv) {
     
     //initiallize some variables
-    // calculated with bottom of falcon as baseline
-    Falcon.mass = OCTAWEB_MASS + BOOSTER_MASS + BOOSTER_FUEL_MASS + SECONDSTAGE_MASS + SECONDSTAGE_FUEL_MASS + FAIRING_MASS;
-    Falcon.cm_location =
-    (OCTAWEB_MASS * 0 +BOOSTER_MASS * BOOSTER_LENGTH/2.0 + BOOSTER_FUEL_MASS * Falcon.FuelPercentage * BOOSTER_LENGTH * Falcon.FuelPercentage/2.0 +(SECONDSTAGE_MASS + SECONDSTAGE_FUEL_MASS) * (BOOSTER_LENGTH + INTERSTAGE_LENGTH +SECONDSTAGE_LENGTH/2.0) +FAIRING_MASS * (BOOSTER_LENGTH + INTERSTAGE_LENGTH +SECONDSTAGE_LENGTH + FAIRING_LENGTH/2.0))/(Falcon.mass*TOTAL_LENGTH);
-    
-    Falcon.pos_cm[0] = 0.0, Falcon.pos_cm[1] = Falcon.cm_location*TOTAL_LENGTH;
-    Falcon.vel_cm[0] = 0.0, Falcon.vel_cm[1] = 0.0;
+    Sim.CheckList.WelcomeScreen = true;
+    Stepper.Controls = &Controls;
+    Stepper.reset(Sim);
     
+    getStars();
+    getClouds();
     
-
-    Falcon.theta = Pi/2.0;
-    Falcon.dist_to_earth = EARTH_RADIUS + Falcon.pos_cm[1];
-    Falcon.part_height = TOTAL_LENGTH; //using fairing
-    Falcon.part_top[0] = 0.0, Falcon.part_top[1] = TOTAL_LENGTH;
-    Falcon.part_bottom[0] = 0.0, Falcon.part_bottom[1] = 0.0;
-    Falcon.air_resistance[0] = 0.0, Falcon.air_resistance[1] = 0.0;
-    Falcon.main_thrust[0] = 0.0, Falcon.main_thrust[1] = THRUST_SEALEVEL, Falcon.main_thrust[2] = THRUST_SEALEVEL;
+    glutInit(&iArgc, cppArgv);
     
-    // couldn't find data on nitrogen thrust magnitude
-    Falcon.nit_thrust_left[0] = 0.0, Falcon.nit_thrust_left[1] = 0.0, Falcon.nit_thrust_left[2] = 10000.0;
-    Falcon.nit_thrust_right[0] = 0.0, Falcon.nit_thrust_right[1] = 0.0, Falcon.nit_thrust_right[2] = 10000.0;
+    int arg = 1;
     
-    getStars();
+    // fly a vehicle read from a file instead of the Falcon 9 v1.1, see Vehicle.h
+    if ((iArgc > arg + 1) && !strcmp(cppArgv[arg], "--vehicle"))
+    {
+        std::string error;
+        if (!loadVehicle(cppArgv[arg + 1], FlownVehicle, error))
+        {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        Sim = SimulationContext(FlownVehicle);
+        Sim.CheckList.WelcomeScreen = true;
+        Stepper.reset(Sim);
+        arg += 2;
+    }
     
-    glutInit(&iArgc, cppArgv);
+    // scrub through a recorded flight (flown with the same vehicle)
+    if ((iArgc > arg + 1) && !strcmp(cppArgv[arg], "--replay"))
+    {
+        std::string error;
+        if (!Player.open(cppArgv[arg + 1], *Sim.Vehicle, error))
+        {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        Replaying = true;
+        seekReplay(Player.startTime());
+        Sim.CheckList.WelcomeScreen = false;
+    }
+    // fly a timeline instead of waiting for the keyboard
+    else if (iArgc > arg)
+    {
+        std::string error;
+        if (!loadTimeline(cppArgv[arg], Script, error))
+        {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        Stepper.Script = &Script;
+        Stepper.reset(Sim);
+        Sim.CheckList.WelcomeScreen = false;
+    }
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
     glutInitWindowSize(600, 600);
     glutInitWindowPosition(0, 0);
@@ -226,6 +276,12 @@ int main(int iArgc, char** cppArgv) {
     glutSpecialFunc(keySpecial);
     glutSpecialUpFunc(keySpecialUp);
     
+    // from here on only the simulation thread touches Sim, Draw() works from the frames it publishes
+    publishFrame();
+    SimulationRunning = true;
+    SimulationThread = std::thread(simulationLoop);
+    atexit(stopSimulation);
+    
     glutMainLoop();
     return 0;
 }
@@ -244,1093 +300,782 @@ void Timer(int iUnused)
     glutTimerFunc(30, Timer, 0);
 }
 
-void Draw() {
-    glClear(GL_COLOR_BUFFER_BIT);
+// only ever the latest whole frame the simulation thread has published
+const ViewerFrame &readFrame() {
+    ProfileScope scope(Profiler, "read frame");
     
-    if (CheckList.WelcomeScreen)
+    const ViewerFrame &View = Frames.read();
+    ViewFalcon = View.Falcon;
+    ViewSecondStage = View.SecondStage;
+    if (View.InputCount != InputsSeen)
     {
-        // draw instructions;
-        glColor3d(1.0f, 1.0f, 1.0f);
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_TEXTURE_2D);
-        
-        glBindTexture(GL_TEXTURE_2D, texture[4]);
-        glBegin(GL_QUADS);
-        glTexCoord2d(0.0, 0.0); // Point 1. Drawing Counterclockwise...
-        glVertex2d(-width/2.0,-height/2.0);
-        
-        glTexCoord2d(1.0, 0.0); // point 2.
-        glVertex2d(width/2.0,-height/2.0);
-        
-        glTexCoord2d(1.0, 1.0); // point 3.
-        glVertex2d(width/2.0,height/2.0);
-        
-        glTexCoord2d(0.0, 1.0); // point 4.
-        glVertex2d(-width/2.0,height/2.0);
-        
-        glEnd();
-        glDisable(GL_TEXTURE_2D);
-        glDisable(GL_DEPTH_TEST);
-        glutSwapBuffers();
-        
-        glMatrixMode(GL_PROJECTION);
-        
-        glLoadIdentity();
-        
-        glOrtho(-width/2.0, width/2.0, -height/2.0, height/2.0, -1.0, 1.0);
-        return;
+        InputsSeen = View.InputCount;
+        InputLatency = std::chrono::duration<GLdouble, std::milli>(std::chrono::steady_clock::now() - View.InputTime).count();
     }
+    return View;
+}
+
+void Draw() {
+    ProfileFrame frame(Profiler);
     
-    // draw the sky color according to the height
-    GLdouble sky_color = 2.0 - pow(2.0, (Falcon.dist_to_earth - EARTH_RADIUS)/SPACE_HEIGHT);
-    if (sky_color < 0.0)
-        sky_color = 0.0;
-    glClearColor(.55 * sky_color, .8 * sky_color, sky_color, 0.0);
+    const ViewerFrame &View = readFrame();
     
-    if (!CheckList.ZoomOut) // if user is looking at zoomed in view
+    // the font goes through the back buffer, so it has to be made before anything is drawn
+    if (!Hud.ready())
+        Hud.build(GLUT_BITMAP_8_BY_13);
+    
+    if (View.CheckList.WelcomeScreen)
     {
-        
-        glColor3d(1.0f, 1.0f, 1.0f);
-        drawClouds(sky_color);
-        
-        // Input stars into the image
-        drawStars();
-        
-        
-        // show user Falcon data
-        char s[200];
-        char s2[200];
-        sprintf(s, " Altitude = %f m | x-location = %f m | Fuel = %f Percent", MagOfVector(Falcon.part_bottom[0],Falcon.part_bottom[1]+EARTH_RADIUS) - EARTH_RADIUS, Falcon.part_bottom[0], 100.0 * Falcon.FuelPercentage);
-        sprintf(s2," Time Since Launch = %f s | Velocity y = %f m/s, Velocity x = %f m/s", TimeSinceLaunch, Falcon.vel_cm[1], Falcon.vel_cm[0]);
-        glColor3d(1.0f, 1.0f, 1.0f);
-        glColor3d(1.0, 1.0, 1.0);
-        drawText(Falcon.pos_cm[0] - width/2.0 , Falcon.pos_cm[1] + height/2.4 , s);
-        drawText(Falcon.pos_cm[0] - width/2.0 , Falcon.pos_cm[1] + height/2.2 , s2);
-        
-        // draw ground depending on rocket position on Earth (ground could be on left or right)
-        
-        if ((Falcon.dist_to_earth - EARTH_RADIUS) < MagOfVector(width, height)) // when ground should be
-            //visible from window frame
         {
-        
-            // getting vector from Earth center to point on surface on line to Falcon center of mass
-            
-            GLdouble D[2];
-            D[0] = EARTH_RADIUS * Falcon.pos_cm[0]/MagOfVector(Falcon.pos_cm[0], EARTH_RADIUS + Falcon.pos_cm[1]);
-            D[1] = EARTH_RADIUS * (EARTH_RADIUS + Falcon.pos_cm[1])/MagOfVector(Falcon.pos_cm[0], EARTH_RADIUS + Falcon.pos_cm[1]);
-        
-            glColor3d(1.0f, 1.0f, 1.0f);
-            glColor3d(0.0, .8, 0.0);
-            glBegin(GL_QUADS);
-        
-            glVertex3d(D[0]*((EARTH_RADIUS - 20000.0)/EARTH_RADIUS) - 20000.0 * D[1]/MagOfVector(D[0], D[1]), - EARTH_RADIUS + D[1]*((EARTH_RADIUS - 20000.0)/EARTH_RADIUS) + 20000.0 * D[0]/MagOfVector(D[0], D[1]), 0.0);
-            glVertex3d(D[0]*((EARTH_RADIUS - 20000.0)/EARTH_RADIUS) + 20000.0 * D[1]/MagOfVector(D[0], D[1]), - EARTH_RADIUS + D[1]*((EARTH_RADIUS - 20000.0)/EARTH_RADIUS) - 20000.0 * D[0]/MagOfVector(D[0], D[1]), 0.0);
-        
-            glVertex3d(D[0] + 20000.0 * D[1]/MagOfVector(D[0], D[1]), - EARTH_RADIUS + D[1] - 20000.0 * D[0]/MagOfVector(D[0], D[1]), 0.0);
-        
-            glVertex3d(D[0] - 20000.0 * D[1]/MagOfVector(D[0], D[1]), - EARTH_RADIUS + D[1] + 20000.0 * D[0]/MagOfVector(D[0], D[1]), 0.0);
-
-            glEnd();
+            ProfileScope scope(Profiler, "clear");
+            glClear(GL_COLOR_BUFFER_BIT);
         }
         
-        // draw landing pad
-        glColor3d(1.0f, 1.0f, 1.0f);
-        glColor3d(.3, .3, .3);
-        glBegin(GL_QUADS);
-        glVertex3d(-PAD_DIAMETER/2.0, -10.0,0.0);
-        
-        glVertex3d(PAD_DIAMETER/2.0, -10.0,0.0);
+        // draw instructions
+        setCamera(-width/2.0, width/2.0, -height/2.0, height/2.0);
+        Scene.begin(0.0, 0.0);
+        Scene.setColor(1.0, 1.0, 1.0);
+        Scene.setTexture(texture[4]);
+        double x[4] = {-width/2.0, width/2.0, width/2.0, -width/2.0};
+        double y[4] = {-height/2.0, -height/2.0, height/2.0, height/2.0};
+        double u[4] = {0.0, 1.0, 1.0, 0.0};
+        double v[4] = {0.0, 0.0, 1.0, 1.0};
+        Scene.quad(x, y, u, v);
         
-        glVertex3d(PAD_DIAMETER/2.0, 0.0,0.0);
-        
-        glVertex3d(-PAD_DIAMETER/2.0, 0.0,0.0);
-        glEnd();
-        
-        if (!CheckList.Detached)
         {
-            // draw Rocket;
-            glColor3d(1.0f, 1.0f, 1.0f);
-            glEnable(GL_DEPTH_TEST);
-            glEnable(GL_TEXTURE_2D);
-            //glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-        
-            glBindTexture(GL_TEXTURE_2D, texture[0]);
-            glBegin(GL_QUADS);
-            glTexCoord2d(0.46, 0.05); // Point 1. Drawing Counterclockwise...
-            glVertex2d(Falcon.part_bottom[0]-(Falcon.part_width/2.0)*sin(Falcon.theta), Falcon.part_bottom[1]+(Falcon.part_width/2.0)*cos(Falcon.theta));
-        
-            glTexCoord2d(0.54, 0.05); // point 2.
-            glVertex2d(Falcon.part_bottom[0]+(Falcon.part_width/2.0)*sin(Falcon.theta), Falcon.part_bottom[1]-(Falcon.part_width/2.0)*cos(Falcon.theta));
-        
-            glTexCoord2d(0.54, .93); // point 3.
-            glVertex2d(Falcon.part_top[0]+(Falcon.part_width/2.0)*sin(Falcon.theta), Falcon.part_top[1]-(Falcon.part_width/2.0)*cos(Falcon.theta));
-        
-            glTexCoord2d(0.46, .93); // point 4.
-            glVertex2d(Falcon.part_top[0]-(Falcon.part_width/2.0)*sin(Falcon.theta), Falcon.part_top[1]+(Falcon.part_width/2.0)*cos(Falcon.theta));
-        
-            glEnd();
-            glDisable(GL_TEXTURE_2D);
-            glDisable(GL_DEPTH_TEST);
+            ProfileScope scope(Profiler, "submit");
+            Scene.draw();
         }
-        else if (CheckList.Detached)
+        
         {
-            // draw rocket;
-            glColor3d(1.0f, 1.0f, 1.0f);
-            glEnable(GL_DEPTH_TEST);
-            glEnable(GL_TEXTURE_2D);
-            
-            glBindTexture(GL_TEXTURE_2D, texture[0]);
-            glBegin(GL_QUADS);
-            glTexCoord2d(0.46, 0.05); // Point 1. Drawing Counterclockwise...
-            glVertex2d(Falcon.part_bottom[0]-(Falcon.part_width/2.0)*sin(Falcon.theta), Falcon.part_bottom[1]+(Falcon.part_width/2.0)*cos(Falcon.theta));
-            
-            glTexCoord2d(0.54, 0.05); // point 2.
-            glVertex2d(Falcon.part_bottom[0]+(Falcon.part_width/2.0)*sin(Falcon.theta), Falcon.part_bottom[1]-(Falcon.part_width/2.0)*cos(Falcon.theta));
-            
-            glTexCoord2d(0.54, .61); // point 3.
-            glVertex2d(Falcon.part_top[0]+(Falcon.part_width/2.0)*sin(Falcon.theta), Falcon.part_top[1]-(Falcon.part_width/2.0)*cos(Falcon.theta));
-            
-            glTexCoord2d(0.46, .61); // point 4.
-            glVertex2d(Falcon.part_top[0]-(Falcon.part_width/2.0)*sin(Falcon.theta), Falcon.part_top[1]+(Falcon.part_width/2.0)*cos(Falcon.theta));
-            
-            glEnd();
-            glDisable(GL_TEXTURE_2D);
-            glDisable(GL_DEPTH_TEST);
-            
-            
-            // draw second stage;
-            glColor3d(1.0f, 1.0f, 1.0f);
-            glEnable(GL_DEPTH_TEST);
-            glEnable(GL_TEXTURE_2D);
-            //glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-            
-            glBindTexture(GL_TEXTURE_2D, texture[0]);
-            glBegin(GL_QUADS);
-            glTexCoord2d(0.46, 0.7); // Point 1. Drawing Counterclockwise...
-            glVertex2d(SecondStage.part_bottom[0]-(SecondStage.part_width/2.0)*sin(SecondStage.theta), SecondStage.part_bottom[1]+(SecondStage.part_width/2.0)*cos(SecondStage.theta));
-            
-            glTexCoord2d(0.54, 0.7); // point 2.
-            glVertex2d(SecondStage.part_bottom[0]+(SecondStage.part_width/2.0)*sin(SecondStage.theta), SecondStage.part_bottom[1]-(SecondStage.part_width/2.0)*cos(SecondStage.theta));
-            
-            glTexCoord2d(0.54, .93); // point 3.
-            glVertex2d(SecondStage.part_top[0]+(SecondStage.part_width/2.0)*sin(SecondStage.theta), SecondStage.part_top[1]-(SecondStage.part_width/2.0)*cos(SecondStage.theta));
-            
-            glTexCoord2d(0.46, .93); // point 4.
-            glVertex2d(SecondStage.part_top[0]-(SecondStage.part_width/2.0)*sin(SecondStage.theta), SecondStage.part_top[1]+(SecondStage.part_width/2.0)*cos(SecondStage.theta));
-            
-            glEnd();
-            glDisable(GL_TEXTURE_2D);
-            glDisable(GL_DEPTH_TEST);
-            
-            
-            // draw Second Stage propulsion
-            if (TimeSinceLaunch - TimeofDetach > 4.0){
-            glColor3d(1.0f, 1.0f, 1.0f);
-            glEnable(GL_DEPTH_TEST);
-            glEnable(GL_TEXTURE_2D);
-            glBindTexture(GL_TEXTURE_2D, texture[2]);
-            glBegin(GL_TRIANGLES);
-            glTexCoord2d(0.4, 0.35); // Point 1. Drawing Counterclockwise...
-            glVertex2d(SecondStage.part_bottom[0]-(SecondStage.part_width/2.0)*sin(SecondStage.theta), SecondStage.part_bottom[1]+(SecondStage.part_width/2.0)*cos(SecondStage.theta));
-            
-            glTexCoord2d(0.5, 0.0); // point 2.
-            glVertex2d(SecondStage.part_bottom[0] - 20.0 * SecondStage.main_thrust[0]/SecondStage.main_thrust[2], SecondStage.part_bottom[1] - 15.0 * SecondStage.main_thrust[1]/SecondStage.main_thrust[2]);
-            
-            glTexCoord2d(0.6, 0.35); // point 3.
-            glVertex2d(SecondStage.part_bottom[0]+(SecondStage.part_width/2.0)*sin(SecondStage.theta), SecondStage.part_bottom[1]-(SecondStage.part_width/2.0)*cos(SecondStage.theta));
-            
-            glEnd();
-            glDisable(GL_TEXTURE_2D);
-            glDisable(GL_DEPTH_TEST);
-                
-            }
-            
+            ProfileScope scope(Profiler, "swap");
+            glutSwapBuffers();
         }
         
+        return;
+    }
+    
+    if (!View.CheckList.ZoomOut) // if user is looking at zoomed in view
+    {
+        // draw the sky color according to the height
+        GLdouble sky_color = 2.0 - pow(2.0, (ViewFalcon.dist_to_earth - EARTH_RADIUS)/SPACE_HEIGHT);
+        if (sky_color < 0.0)
+            sky_color = 0.0;
+        glClearColor(.55 * sky_color, .8 * sky_color, sky_color, 0.0);
         
-        // draw center of mass of rocket
-        if (!CheckList.Exploded && !CheckList.LandedSuccess)
         {
-            glColor3d(1.0f, 1.0f, 1.0f);
-            glColor3d(0.0, 0.0, 1.0);
-            glPointSize(3);
-            glBegin(GL_POINTS);
-            glVertex3d(Falcon.pos_cm[0], Falcon.pos_cm[1], 0.0);
-            glEnd();
+            ProfileScope scope(Profiler, "clear");
+            glClear(GL_COLOR_BUFFER_BIT);
         }
         
-        // draw nitrogen thrust
-        if (!CheckList.LandedSuccess){
-        glColor3d(1.0f, 1.0f, 1.0f);
-        glColor3d(.2, 1.0, 1.0);
-        glBegin(GL_LINES);
-        glVertex3d(Falcon.part_bottom[0] + NITROGEN_HEIGHT*(Falcon.part_top[0] - Falcon.part_bottom[0])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0], Falcon.part_top[1] - Falcon.part_bottom[1]),Falcon.part_bottom[1] + NITROGEN_HEIGHT*(Falcon.part_top[1] - Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0], Falcon.part_top[1] - Falcon.part_bottom[1]), 0.0);
-        
-        glVertex3d(Falcon.part_bottom[0] + NITROGEN_HEIGHT*(Falcon.part_top[0] - Falcon.part_bottom[0])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0], Falcon.part_top[1] - Falcon.part_bottom[1]) - 7.0 * Falcon.nit_thrust_left[0]/MagOfVector(Falcon.nit_thrust_left[0], Falcon.nit_thrust_left[1]),Falcon.part_bottom[1] + NITROGEN_HEIGHT*(Falcon.part_top[1] - Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0], Falcon.part_top[1] - Falcon.part_bottom[1]) - 7.0* Falcon.nit_thrust_left[1]/MagOfVector(Falcon.nit_thrust_left[0], Falcon.nit_thrust_left[1]), 0.0);
-        
-        glVertex3d(Falcon.part_bottom[0] + NITROGEN_HEIGHT*(Falcon.part_top[0] - Falcon.part_bottom[0])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0], Falcon.part_top[1] - Falcon.part_bottom[1]),Falcon.part_bottom[1] + NITROGEN_HEIGHT*(Falcon.part_top[1] - Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0], Falcon.part_top[1] - Falcon.part_bottom[1]), 0.0);
-        
-        glVertex3d(Falcon.part_bottom[0] + NITROGEN_HEIGHT*(Falcon.part_top[0] - Falcon.part_bottom[0])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0], Falcon.part_top[1] - Falcon.part_bottom[1]) - 7.0 * Falcon.nit_thrust_right[0]/MagOfVector(Falcon.nit_thrust_right[0], Falcon.nit_thrust_right[1]),Falcon.part_bottom[1] + NITROGEN_HEIGHT*(Falcon.part_top[1] - Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0], Falcon.part_top[1] - Falcon.part_bottom[1]) - 7.0* Falcon.nit_thrust_right[1]/MagOfVector(Falcon.nit_thrust_right[0], Falcon.nit_thrust_right[1]), 0.0);
-        glEnd();
-        }
+        // follow center of rocket
+        setCamera(-width/2.0, width/2.0, -height/2.0, height/2.0);
+        Scene.begin(ViewFalcon.pos_cm[0], ViewFalcon.pos_cm[1]);
         
-        if (CheckList.rocketOn && (Falcon.FuelPercentage > 0.0) && !CheckList.LandedSuccess)
         {
-            // draw Falcon propulsion
-            glColor3d(1.0f, 1.0f, 1.0f);
-            glEnable(GL_DEPTH_TEST);
-            glEnable(GL_TEXTURE_2D);
-            glBindTexture(GL_TEXTURE_2D, texture[2]);
-            glBegin(GL_TRIANGLES);
-            glTexCoord2d(0.4, 0.35); // Point 1. Drawing Counterclockwise...
-            glVertex2d(Falcon.part_bottom[0]-(Falcon.part_width/2.0)*sin(Falcon.theta), Falcon.part_bottom[1]+(Falcon.part_width/2.0)*cos(Falcon.theta));
-            
-            glTexCoord2d(0.5, 0.0); // point 2.
-            glVertex2d(Falcon.part_bottom[0] - 20.0 * Falcon.main_thrust[0]/Falcon.main_thrust[2], Falcon.part_bottom[1] - 20.0 * Falcon.main_thrust[1]/Falcon.main_thrust[2]);
-            
-            glTexCoord2d(0.6, 0.35); // point 3.
-            glVertex2d(Falcon.part_bottom[0]+(Falcon.part_width/2.0)*sin(Falcon.theta), Falcon.part_bottom[1]-(Falcon.part_width/2.0)*cos(Falcon.theta));
-            
-            glEnd();
-            glDisable(GL_TEXTURE_2D);
-            glDisable(GL_DEPTH_TEST);
+            ProfileScope scope(Profiler, "clouds");
+            drawClouds(sky_color);
         }
         
-        if (CheckList.LegsDeployed)
+        // Input stars into the image
         {
-            // draw legs
-            glColor3d(1.0f, 1.0f, 1.0f);
-            glColor3d(0.1, 0.1, 0.1);
-            glLineWidth(3);
-            glBegin(GL_LINES);
-            glVertex2d(Falcon.part_bottom[0]-(Falcon.part_width/2.0)*sin(Falcon.theta), Falcon.part_bottom[1]+(Falcon.part_width/2.0)*cos(Falcon.theta));
-            
-            glVertex2d(Falcon.part_bottom[0]-5.0*(Falcon.part_width/2.0)*sin(Falcon.theta + Pi/7.5), Falcon.part_bottom[1]+5.0*(Falcon.part_width/2.0)*cos(Falcon.theta + Pi/7.5));
-            
-            glVertex2d(Falcon.part_bottom[0]+(Falcon.part_width/2.0)*sin(Falcon.theta), Falcon.part_bottom[1]-(Falcon.part_width/2.0)*cos(Falcon.theta));
-            
-            glVertex2d(Falcon.part_bottom[0]+5.0*(Falcon.part_width/2.0)*sin(Falcon.theta - Pi/7.5), Falcon.part_bottom[1]-5.0*(Falcon.part_width/2.0)*cos(Falcon.theta - Pi/7.5));
-            
-            glEnd();
+            ProfileScope scope(Profiler, "stars");
+            drawStars();
         }
         
-        if (CheckList.Liftoff)
-            ExplodeOrNot();
-        
-        if (CheckList.Detached)
-            SecondExplodeOrNot();
-        
-    
-        glutSwapBuffers();
-        
-        if (!CheckList.Exploded && !CheckList.LandedSuccess && !CheckList.Paused && !CheckList.WelcomeScreen)
-            getPosition();
-        
-        if (!CheckList.SecondExploded && !CheckList.Paused && !CheckList.WelcomeScreen && CheckList.Detached)
-            getSecStagePosition();
-        
-        // follow center of rocket
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        glOrtho(Falcon.pos_cm[0] - width/2.0, Falcon.pos_cm[0] + width/2.0, Falcon.pos_cm[1] - height/2.0, Falcon.pos_cm[1] + height/2.0, -1.0, 1.0);
-    }
-    else if (CheckList.ZoomOut) // if user is looking at zoomed out view (for perspective)
-    {
-        // SCALING EVERYTHING BY FACTOR OF 15000
-        
-        glClearColor(0.0, 0.0, 0.0, 0.0);
-        glColor3d(1.0f, 1.0f, 1.0f);
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_TEXTURE_2D);
-        //glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-        
-        glBindTexture(GL_TEXTURE_2D, texture[1]);
-        glBegin(GL_QUADS);
-        
-        glTexCoord2d(0.06, 0.0);
-        glVertex2d(-480.0, -910.0);
-        
-        glTexCoord2d(.98, 0.0); // point 2.
-        glVertex2d(520.0, -910.0);
-        
-        glTexCoord2d(.98, 1.0); // point 3.
-        glVertex2d(520.0, 65.0);
-        
-        glTexCoord2d(0.06, 1.0); // point 4.
-        glVertex2d(-480.0, 65.0);
-        
-        
-        glEnd();
-        glDisable(GL_TEXTURE_2D);
-        glDisable(GL_DEPTH_TEST);
-        
-        // zoomed out rocket
-        glBegin(GL_LINES);
-        glVertex2d(Falcon.part_bottom[0]/15000.0, Falcon.part_bottom[1]/15000.0);
-        glVertex2d(Falcon.part_bottom[0]/15000.0 + .2*(Falcon.part_top[0] - Falcon.part_bottom[0]), Falcon.part_bottom[1]/15000.0 + .2*(Falcon.part_top[1] - Falcon.part_bottom[1]));
-        glEnd();
-        
-        
-        // zoomed out Second Stage as a point
-        
-        glPointSize(3);
-        glBegin(GL_POINTS);
-        if (!CheckList.Detached)
-            glVertex2d(Falcon.part_bottom[0]/15000.0 + .2*(Falcon.part_top[0] - Falcon.part_bottom[0]), Falcon.part_bottom[1]/15000.0 + .2*(Falcon.part_top[1] - Falcon.part_bottom[1]));
-        else if (CheckList.Detached)
-            glVertex2d(SecondStage.part_top[0]/15000.0, SecondStage.part_top[1]/15000.0);
-        glEnd();
-        
-        
-        
-        if (CheckList.Liftoff)
-            ExplodeOrNot();
-        
-        if (CheckList.Detached)
-            SecondExplodeOrNot();
-        
-        glutSwapBuffers();
-        
-        // update the position of the rocket
-        if (!CheckList.Exploded && !CheckList.LandedSuccess && !CheckList.Paused && !CheckList.WelcomeScreen)
-            getPosition();
-        
-        // if detached, update the position of the second stage
-        if (!CheckList.SecondExploded && !CheckList.Paused && !CheckList.WelcomeScreen && CheckList.Detached)
-            getSecStagePosition();
-        
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        glOrtho(-width_Earth*2.5, width_Earth*2.5, -height_Earth*3.5, height_Earth*1.5, -1.0, 1.0);
-    }
-    
-}
-
-// draw stagnant clouds so user can see how fast rocket is travelling
-void drawClouds(GLdouble color) {
-    glColor3d(color*.9, color*.9, color*.9);
-    glPointSize(30);
-         glBegin(GL_POINTS);
-    
-    for (int i = 0; i < 10; i++)
-    {
-        for (int j = 0; j < 10; j++)
+        // draw ground depending on rocket position on Earth (ground could be on left or right)
         {
-            int x_loc = Falcon.pos_cm[0]/300;
-            int y_loc = Falcon.pos_cm[1]/300;
+            ProfileScope scope(Profiler, "ground");
+            if ((ViewFalcon.dist_to_earth - EARTH_RADIUS) < MagOfVector(width, height)) // when ground should be
+                //visible from window frame
+            {
+                // getting vector from Earth center to point on surface on line to Falcon center of mass
+                GLdouble D[2];
+                D[0] = EARTH_RADIUS * ViewFalcon.pos_cm[0]/MagOfVector(ViewFalcon.pos_cm[0], EARTH_RADIUS + ViewFalcon.pos_cm[1]);
+                D[1] = EARTH_RADIUS * (EARTH_RADIUS + ViewFalcon.pos_cm[1])/MagOfVector(ViewFalcon.pos_cm[0], EARTH_RADIUS + ViewFalcon.pos_cm[1]);
+                
+                // along the surface and down into the ground, 20 km each way
+                GLdouble along[2] = {20000.0 * D[1]/MagOfVector(D[0], D[1]), - 20000.0 * D[0]/MagOfVector(D[0], D[1])};
+                GLdouble depth = (EARTH_RADIUS - 20000.0)/EARTH_RADIUS;
+                
+                double x[4] = {D[0]*depth - along[0], D[0]*depth + along[0], D[0] + along[0], D[0] - along[0]};
+                double y[4] = {- EARTH_RADIUS + D[1]*depth - along[1], - EARTH_RADIUS + D[1]*depth + along[1], - EARTH_RADIUS + D[1] + along[1], - EARTH_RADIUS + D[1] - along[1]};
+                Scene.setColor(0.0, .8, 0.0);
+                Scene.quad(x, y);
+            }
             
-            glVertex3d(300*(x_loc - i)+90.0,300*(y_loc - j)+230.0, 0.0);
-            glVertex3d(300*(x_loc - i)+90.0,300*(y_loc + j)+230.0, 0.0);
-            glVertex3d(300*(x_loc + i)+90.0,300*(y_loc - j)+230.0, 0.0);
-            glVertex3d(300*(x_loc + i)+90.0,300*(y_loc + j)+230.0, 0.0);
+            // draw landing pad
+            double pad_x[4] = {-PAD_DIAMETER/2.0, PAD_DIAMETER/2.0, PAD_DIAMETER/2.0, -PAD_DIAMETER/2.0};
+            double pad_y[4] = {-10.0, -10.0, 0.0, 0.0};
+            Scene.setColor(.3, .3, .3);
+            Scene.quad(pad_x, pad_y);
         }
-    }
-         glEnd();
-}
-
-void drawStars(){
-    
-    glColor3d(0.8, 0.8, 0.8);
-    glPointSize(1);
-    glBegin(GL_POINTS);
-    
-    for (int i = 0; i < 79; i++)
-            glVertex3d(Falcon.pos_cm[0] - width/2.0 + star_locations[i][0] * width, Falcon.pos_cm[1] - height/2.0 + star_locations[i][1] * height, 0.0);
-    glEnd();
-    
-    // Easter Egg
-    glColor3d(0.8, 0.2, 0.2);
-    glPointSize(3);
-    glBegin(GL_POINTS);
-    glVertex3d(Falcon.pos_cm[0] - width/2.0 + .65 * width, Falcon.pos_cm[1] - height/2.0 + .85 * height, 0.0);
-    glEnd();
-}
-
-
-
-void getStars() {
-    for (int i = 0; i < 80; i++)
-    {
-        // generate random locations for stars
-        star_locations[i][0] = static_cast <GLdouble> (rand()) / static_cast <GLdouble> (RAND_MAX);
-        star_locations[i][1] = static_cast <GLdouble> (rand()) / static_cast <GLdouble> (RAND_MAX);
-    }
-}
-
-void ExplodeOrNot(){
-    
-    if (MagOfVector(Falcon.part_top[0], Falcon.part_top[1] + EARTH_RADIUS) < EARTH_RADIUS)
-    {
-        CheckList.Exploded = true;
-        Falcon.vel_cm[0] = 0.0; Falcon.vel_cm[1] = 0.0; Falcon.omega = 0.0;
-        if (!CheckList.ZoomOut)
-            drawExplosion();
-            
-    }
-    else if (MagOfVector(Falcon.part_bottom[0], Falcon.part_bottom[1] + EARTH_RADIUS) < EARTH_RADIUS)
-    {
-        GLdouble vel_bottom = MagOfVector(Falcon.vel_cm[0] + Falcon.omega*Falcon.cm_location*Falcon.part_height* (Falcon.part_top[1]-Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0]-Falcon.part_bottom[0], Falcon.part_top[1]-Falcon.part_bottom[1]), Falcon.vel_cm[1] + Falcon.omega*Falcon.cm_location*Falcon.part_height* (Falcon.part_bottom[0]-Falcon.part_top[0])/MagOfVector(Falcon.part_top[0]-Falcon.part_bottom[0], Falcon.part_top[1]-Falcon.part_bottom[1]));
         
-        if ((vel_bottom > 60.0) || !CheckList.LegsDeployed || (Falcon.part_bottom[0] > PAD_DIAMETER/2.0) ||  (Falcon.part_bottom[0] < -PAD_DIAMETER/2.0) || CheckList.Exploded)
         {
-            CheckList.Exploded = true;
-            Falcon.vel_cm[0] = 0.0; Falcon.vel_cm[1] = 0.0; Falcon.omega = 0.0;
-            if (!CheckList.ZoomOut)
-                drawExplosion();
+            ProfileScope scope(Profiler, "rocket");
+            Scene.setColor(1.0, 1.0, 1.0);
+            Scene.setTexture(texture[0]);
+            if (!View.CheckList.Detached)
+            {
+                // draw Rocket
+                Scene.partQuad(ViewFalcon, 0.46, 0.54, 0.05, 0.93);
+            }
+            else if (View.CheckList.Detached)
+            {
+                // draw booster and second stage from their parts of the texture
+                Scene.partQuad(ViewFalcon, 0.46, 0.54, 0.05, 0.61);
+                Scene.partQuad(ViewSecondStage, 0.46, 0.54, 0.7, 0.93);
+                
+                // draw Second Stage propulsion
+                if (View.TimeSinceLaunch - View.TimeofDetach > 4.0)
+                    drawFlame(ViewSecondStage, 20.0, 15.0);
+            }
         }
-        else if ((Falcon.theta > 2.0*Pi/3.0)||(Falcon.theta < Pi/3.0) )
+        
         {
-            if ((Falcon.theta > Pi) || (Falcon.theta < 0.0))
+            ProfileScope scope(Profiler, "effects");
+            // draw center of mass of rocket
+            if (!View.CheckList.Exploded && !View.CheckList.LandedSuccess)
             {
-                CheckList.Exploded = true;
-                Falcon.pos_cm[0] = (Falcon.part_top[0] + Falcon.part_bottom[0])/2.0; Falcon.pos_cm[1] = 0.0;
-                if (!CheckList.ZoomOut)
-                    drawExplosion();
+                Scene.setColor(0.0, 0.0, 1.0);
+                Scene.setPointSize(3);
+                Scene.point(ViewFalcon.pos_cm[0], ViewFalcon.pos_cm[1]);
             }
-            else if (Falcon.theta > 2.0*Pi/3.0 )
-                Falcon.theta += .3 * DeltaT;
-            else if (Falcon.theta < Pi/3.0)
-                Falcon.theta -= .3 * DeltaT;
-            
-            Falcon.part_top[0] = Falcon.part_bottom[0] + Falcon.part_height * cos(Falcon.theta);
-            Falcon.part_top[1] = Falcon.part_bottom[1] + Falcon.part_height * sin(Falcon.theta);
             
-            // update pos_cm based on top and bottom and Falcon.cm_location
-            Falcon.pos_cm[0] = Falcon.cm_location*(Falcon.part_top[0] - Falcon.part_bottom[0]) + Falcon.part_bottom[0];
-            Falcon.pos_cm[1] = Falcon.cm_location*(Falcon.part_top[1] - Falcon.part_bottom[1]) + Falcon.part_bottom[1];
+            // draw nitrogen thrust
+            if (!View.CheckList.LandedSuccess)
+            {
+                GLdouble length = MagOfVector(ViewFalcon.part_top[0] - ViewFalcon.part_bottom[0], ViewFalcon.part_top[1] - ViewFalcon.part_bottom[1]);
+                GLdouble thrusters[2];
+                thrusters[0] = ViewFalcon.part_bottom[0] + View.NitrogenHeight*(ViewFalcon.part_top[0] - ViewFalcon.part_bottom[0])/length;
+                thrusters[1] = ViewFalcon.part_bottom[1] + View.NitrogenHeight*(ViewFalcon.part_top[1] - ViewFalcon.part_bottom[1])/length;
+                GLdouble left = MagOfVector(ViewFalcon.nit_thrust_left[0], ViewFalcon.nit_thrust_left[1]);
+                GLdouble right = MagOfVector(ViewFalcon.nit_thrust_right[0], ViewFalcon.nit_thrust_right[1]);
+                
+                Scene.setColor(.2, 1.0, 1.0);
+                Scene.setLineWidth(1);
+                Scene.line(thrusters[0], thrusters[1], thrusters[0] - 7.0 * ViewFalcon.nit_thrust_left[0]/left, thrusters[1] - 7.0 * ViewFalcon.nit_thrust_left[1]/left);
+                Scene.line(thrusters[0], thrusters[1], thrusters[0] - 7.0 * ViewFalcon.nit_thrust_right[0]/right, thrusters[1] - 7.0 * ViewFalcon.nit_thrust_right[1]/right);
+            }
             
-            Falcon.vel_cm[0] = 0.0; Falcon.vel_cm[1] = 0.0; Falcon.omega = 0.0;
+            // draw Falcon propulsion
+            if (View.CheckList.rocketOn && (ViewFalcon.FuelPercentage > 0.0) && !View.CheckList.LandedSuccess)
+                drawFlame(ViewFalcon, 20.0, 20.0);
             
+            if (View.CheckList.LegsDeployed)
+            {
+                // draw legs
+                GLdouble half_width = ViewFalcon.part_width/2.0;
+                Scene.setColor(0.1, 0.1, 0.1);
+                Scene.setLineWidth(3);
+                Scene.line(ViewFalcon.part_bottom[0] - half_width*sin(ViewFalcon.theta), ViewFalcon.part_bottom[1] + half_width*cos(ViewFalcon.theta),
+                           ViewFalcon.part_bottom[0] - 5.0*half_width*sin(ViewFalcon.theta + Pi/7.5), ViewFalcon.part_bottom[1] + 5.0*half_width*cos(ViewFalcon.theta + Pi/7.5));
+                Scene.line(ViewFalcon.part_bottom[0] + half_width*sin(ViewFalcon.theta), ViewFalcon.part_bottom[1] - half_width*cos(ViewFalcon.theta),
+                           ViewFalcon.part_bottom[0] + 5.0*half_width*sin(ViewFalcon.theta - Pi/7.5), ViewFalcon.part_bottom[1] - 5.0*half_width*cos(ViewFalcon.theta - Pi/7.5));
+            }
         }
-        else
+        
         {
-            CheckList.LandedSuccess = true;
-            Falcon.vel_cm[0] = 0.0; Falcon.vel_cm[1] = 0.0; Falcon.omega = 0.0;
-            
-            // fix angle so that rocket is upright
-            if (Falcon.theta < Pi/2.0 - .01)
-                Falcon.theta += .2 * DeltaT;
-            else if (Falcon.theta > Pi/2.0 + .01)
-                Falcon.theta -= .2 * DeltaT;
-                
-            Falcon.part_top[0] = Falcon.part_bottom[0] + Falcon.part_height * cos(Falcon.theta);
-            Falcon.part_top[1] = Falcon.part_bottom[1] + Falcon.part_height * sin(Falcon.theta);
+            ProfileScope scope(Profiler, "explosions");
+            if (View.CheckList.Exploded)
+                drawExplosion();
             
-            // HousePartyProtocol();
+            if (View.CheckList.SecondExploded)
+                drawSecondExplosion();
         }
-    }
-    
-}
-
-void SecondExplodeOrNot(){
-    
-    if ((MagOfVector(SecondStage.part_top[0], SecondStage.part_top[1] + EARTH_RADIUS) < EARTH_RADIUS) || (MagOfVector(SecondStage.part_bottom[0], SecondStage.part_bottom[1] + EARTH_RADIUS) < EARTH_RADIUS))
-    {
-        CheckList.SecondExploded = true;
-        SecondStage.vel_cm[0] = 0.0; SecondStage.vel_cm[1] = 0.0; SecondStage.omega = 0.0; // left omega for a version 2 of this program
-        
-        if (!CheckList.ZoomOut)
-            drawSecondExplosion();
-    }
-}
-
-void drawExplosion(){
-    
-    glColor3d(1.0f, 1.0f, 1.0f);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_TEXTURE_2D);
-    //glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
-    
-    glBindTexture(GL_TEXTURE_2D, texture[3]);
-    glBegin(GL_QUADS);
-    
-    glTexCoord2d(0.0, 0.0); // point 1
-    glVertex2d(Falcon.pos_cm[0] - 50.0, Falcon.pos_cm[1] - 50.0);
-    
-    glTexCoord2d(1.0, 0.0); // point 2
-    glVertex2d(Falcon.pos_cm[0] + 50.0, Falcon.pos_cm[1] - 50.0);
-    
-    glTexCoord2d(1.0, 1.0); // point 3
-    glVertex2d(Falcon.pos_cm[0] + 50.0, Falcon.pos_cm[1] + 50.0);
-    
-    glTexCoord2d(0.0, 1.0); // point 4
-    glVertex2d(Falcon.pos_cm[0] - 50.0, Falcon.pos_cm[1] + 50.0);
-    glEnd();
-    
-    glDisable(GL_TEXTURE_2D);
-    glDisable(GL_DEPTH_TEST);
-}
-
-void drawSecondExplosion(){
-    glColor3d(1.0f, 1.0f, 1.0f);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_TEXTURE_2D);
-    
-    glBindTexture(GL_TEXTURE_2D, texture[3]);
-    glBegin(GL_QUADS);
-    
-    glTexCoord2d(0.0, 0.0); // point 1
-    glVertex2d(SecondStage.pos_cm[0] - 30.0, SecondStage.pos_cm[1] - 30.0);
-    
-    glTexCoord2d(1.0, 0.0); // point 2
-    glVertex2d(SecondStage.pos_cm[0] + 30.0, SecondStage.pos_cm[1] - 30.0);
-    
-    glTexCoord2d(1.0, 1.0); // point 3
-    glVertex2d(SecondStage.pos_cm[0] + 30.0, SecondStage.pos_cm[1] + 30.0);
-    
-    glTexCoord2d(0.0, 1.0); // point 4
-    glVertex2d(SecondStage.pos_cm[0] - 30.0, SecondStage.pos_cm[1] + 30.0);
-    glEnd();
-    
-    glDisable(GL_TEXTURE_2D);
-    glDisable(GL_DEPTH_TEST);
-}
-
-void getPosition(){
-    
-    if (CheckList.Liftoff)
-        TimeSinceLaunch += DeltaT;
-    
-    // translation of top and bottom of Falcon
-    Falcon.pos_cm[0] += Falcon.vel_cm[0] * DeltaT;
-    Falcon.pos_cm[1] += Falcon.vel_cm[1] * DeltaT;
-
-    GLdouble dist2top;
-    GLdouble dist2bottom;
-    if (!CheckList.Detached)
-    {
-        dist2bottom = Falcon.cm_location * TOTAL_LENGTH;
-        dist2top = TOTAL_LENGTH - dist2bottom;
-    }
-    else
-    {
-        dist2bottom = Falcon.cm_location * BOOSTER_LENGTH;
-        dist2top = BOOSTER_LENGTH - dist2bottom;
-    }
-    Falcon.part_top[0] = dist2top*cos(Falcon.theta) + Falcon.pos_cm[0];
-    Falcon.part_top[1] = dist2top*sin(Falcon.theta) + Falcon.pos_cm[1];
-    Falcon.part_bottom[0] = dist2bottom*cos(Falcon.theta + Pi) + Falcon.pos_cm[0];
-    Falcon.part_bottom[1] = dist2bottom*sin(Falcon.theta + Pi) + Falcon.pos_cm[1];
-    
-    
-    // update Mass and Moment of Inertia
-    updateMassAndMoment();
-    
-    // update top and bottom using torque
-    updateTorque();
-    
-    Falcon.omega += DeltaT * Falcon.torque/Falcon.MomentofInertia;
-    
-    //ROTATION
-    updateTheta();
-    updateForces();
-    updateVelocity();
-
-    
-}
-
-void updateMassAndMoment(){
-    if (!CheckList.Detached)
-    {
-        Falcon.mass = OCTAWEB_MASS + BOOSTER_MASS + BOOSTER_FUEL_MASS * Falcon.FuelPercentage + SECONDSTAGE_MASS + SECONDSTAGE_FUEL_MASS +  FAIRING_MASS;
-        
-        // calculated with bottom of falcon as baseline
-        Falcon.cm_location =
-        (OCTAWEB_MASS * 0 +
-         BOOSTER_MASS * BOOSTER_LENGTH/2.0 +
-         BOOSTER_FUEL_MASS * Falcon.FuelPercentage * BOOSTER_LENGTH * Falcon.FuelPercentage/2.0 +
-         (SECONDSTAGE_MASS + SECONDSTAGE_FUEL_MASS) * (BOOSTER_LENGTH + INTERSTAGE_LENGTH +
-                                                           SECONDSTAGE_LENGTH/2.0) +
-         FAIRING_MASS * (BOOSTER_LENGTH + INTERSTAGE_LENGTH +
-                           SECONDSTAGE_LENGTH + FAIRING_LENGTH/2.0))/Falcon.mass;
-        
-        // make between 0 and 1
-        Falcon.cm_location = Falcon.cm_location/TOTAL_LENGTH;
-        
-        // approximating using a small width approximation
-        // using lots of parallel axis theorem
-        Falcon.MomentofInertia = OCTAWEB_MASS * pow(Falcon.cm_location,2.0) +
         
-        (1.0/12.0)* BOOSTER_MASS * pow(BOOSTER_LENGTH,2.0) + BOOSTER_MASS * pow(std::abs(Falcon.cm_location * TOTAL_LENGTH - BOOSTER_LENGTH/2.0),2.0) +
-        
-        (1.0/12.0)* BOOSTER_FUEL_MASS * Falcon.FuelPercentage * pow(BOOSTER_LENGTH * Falcon.FuelPercentage,2.0) + BOOSTER_FUEL_MASS * Falcon.FuelPercentage * pow(std::abs(Falcon.cm_location * TOTAL_LENGTH - BOOSTER_LENGTH * Falcon.FuelPercentage/2.0),2.0) +
-        
-        (1.0/12.0) * (SECONDSTAGE_MASS + SECONDSTAGE_FUEL_MASS) * pow(SECONDSTAGE_LENGTH,2.0) + (SECONDSTAGE_MASS + SECONDSTAGE_FUEL_MASS) * pow(std::abs(Falcon.cm_location * TOTAL_LENGTH - (BOOSTER_LENGTH + INTERSTAGE_LENGTH + SECONDSTAGE_LENGTH/2.0)),2.0) +
-        
-        (1.0/12.0) * FAIRING_MASS * pow(FAIRING_LENGTH,2.0) + pow(std::abs(Falcon.cm_location * TOTAL_LENGTH - (BOOSTER_LENGTH + INTERSTAGE_LENGTH + SECONDSTAGE_LENGTH + FAIRING_LENGTH/2.0)),2.0);
-        
-    }
-    else
-    {
-        // update Falcon mass without second stage
-        Falcon.mass = OCTAWEB_MASS + BOOSTER_MASS + BOOSTER_FUEL_MASS * Falcon.FuelPercentage;
-        
-        
-        Falcon.cm_location = (OCTAWEB_MASS * 0 +
-                              BOOSTER_MASS * BOOSTER_LENGTH/2.0 +
-                              BOOSTER_FUEL_MASS * Falcon.FuelPercentage * BOOSTER_LENGTH * Falcon.FuelPercentage/2.0)/Falcon.mass;
-        
-        // make between 0 and 1
-        Falcon.cm_location = Falcon.cm_location/BOOSTER_LENGTH;
+        {
+            ProfileScope scope(Profiler, "submit");
+            Scene.draw();
+        }
         
-        Falcon.MomentofInertia = OCTAWEB_MASS * pow(Falcon.cm_location,2.0) +
+        // show user Falcon data
+        {
+            ProfileScope scope(Profiler, "hud format");
+            GLdouble altitude = MagOfVector(ViewFalcon.part_bottom[0],ViewFalcon.part_bottom[1]+EARTH_RADIUS) - EARTH_RADIUS;
+            if (HudLines[0].changed({shownAt(altitude, 6), shownAt(ViewFalcon.part_bottom[0], 6), shownAt(100.0 * ViewFalcon.FuelPercentage, 6)}))
+                sprintf(HudLines[0].Text, " Altitude = %f m | x-location = %f m | Fuel = %f Percent", altitude, ViewFalcon.part_bottom[0], 100.0 * ViewFalcon.FuelPercentage);
+            if (HudLines[1].changed({shownAt(View.TimeSinceLaunch, 6), shownAt(ViewFalcon.vel_cm[1], 6), shownAt(ViewFalcon.vel_cm[0], 6)}))
+                sprintf(HudLines[1].Text, " Time Since Launch = %f s | Velocity y = %f m/s, Velocity x = %f m/s", View.TimeSinceLaunch, ViewFalcon.vel_cm[1], ViewFalcon.vel_cm[0]);
+            if (Replaying)
+            {
+                if (HudLines[2].changed({1.0, shownAt(View.SimulationTime, 2), shownAt(View.ReplayEnd, 2), View.TimeWarp}))
+                    sprintf(HudLines[2].Text, " Replay = %.2f of %.2f s | Time Warp = %gx | [ ] 10 s , . 1 s", View.SimulationTime, View.ReplayEnd, View.TimeWarp);
+            }
+            else if (HudLines[2].changed({0.0, (double) View.Integrator, View.TimeWarp, shownAt(View.ActualWarp, 1), (double) View.ForceEvaluations, (double) View.Recording, (double) View.RecordingDropped}))
+            {
+                char held[40] = "";
+                if (View.ActualWarp < View.TimeWarp)
+                    sprintf(held, " (held at %.1fx)", View.ActualWarp);
+                // warp can outrun the telemetry drain, and the records it drops are counted here as they go
+                char recording[48] = "";
+                if (View.Recording && View.RecordingDropped)
+                    sprintf(recording, " | Recording (%lld dropped)", View.RecordingDropped);
+                else if (View.Recording)
+                    sprintf(recording, " | Recording");
+                sprintf(HudLines[2].Text, " Integrator = %s | Time Warp = %gx%s | Force Evaluations = %lld%s", integratorName(View.Integrator), View.TimeWarp, held, View.ForceEvaluations, recording);
+            }
+            GLdouble p50 = Profiler.percentile("frame", 50.0);
+            GLdouble p99 = Profiler.percentile("frame", 99.0);
+            if (HudLines[3].changed({shownAt(p50, 2), shownAt(p99, 2), shownAt(InputLatency, 1), (double) Profiler.isTracing()}))
+                sprintf(HudLines[3].Text, " Frame p50 = %.2f ms | p99 = %.2f ms | Input latency = %.1f ms%s", p50, p99, InputLatency, Profiler.isTracing() ? " | Tracing" : "");
+        }
         
-        (1.0/12.0)* BOOSTER_MASS * pow(BOOSTER_LENGTH,2.0) + BOOSTER_MASS * pow(std::abs(Falcon.cm_location * TOTAL_LENGTH - BOOSTER_LENGTH/2.0),2.0) +
+        // the camera is on the rocket, so the text goes relative to it
+        {
+            ProfileScope scope(Profiler, "hud text");
+            GLdouble pixel = width/glutGet(GLUT_WINDOW_WIDTH);
+            Hud.setLine(0, - width/2.0 , height/2.4 , pixel, HudLines[0].Text);
+            Hud.setLine(1, - width/2.0 , height/2.2 , pixel, HudLines[1].Text);
+            Hud.setLine(2, - width/2.0 , height/2.6 , pixel, HudLines[2].Text);
+            Hud.setLine(3, - width/2.0 , height/2.8 , pixel, HudLines[3].Text);
+            Hud.draw();
+        }
         
-        (1.0/12.0)* BOOSTER_FUEL_MASS * Falcon.FuelPercentage * pow(BOOSTER_LENGTH * Falcon.FuelPercentage,2.0) + BOOSTER_FUEL_MASS * Falcon.FuelPercentage * pow(std::abs(Falcon.cm_location * TOTAL_LENGTH - BOOSTER_LENGTH * Falcon.FuelPercentage/2.0),2.0);
+        {
+            ProfileScope scope(Profiler, "swap");
+            glutSwapBuffers();
+        }
     }
-}
-
-void updateTorque(){
-    
-    GLdouble torque_air;
-    
-    if (MagOfVector(Falcon.air_resistance[0], Falcon.air_resistance[1]) > .00001 ) // prevent dividing by zero
+    else if (View.CheckList.ZoomOut) // if user is looking at zoomed out view (for perspective)
     {
-    
-        torque_air = ((Falcon.part_height/2.0) - Falcon.cm_location * Falcon.part_height) * twoDCrossMag(Falcon.air_resistance[0], Falcon.air_resistance[1],Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]);
-    
-        // need to check whether torque is positive or negative, do this by finding sin(theta - alpha) where alpha
-        // is angle of air resistance
-        GLdouble sin_theta_alpha = sin(Falcon.theta)*(Falcon.air_resistance[0]/MagOfVector(Falcon.air_resistance[0], Falcon.air_resistance[1])) - (Falcon.air_resistance[1]/MagOfVector(Falcon.air_resistance[0], Falcon.air_resistance[1]))*cos(Falcon.theta);
-    
-        if ((sin_theta_alpha > 0.00001) && (sin_theta_alpha < Pi))
-            torque_air = -torque_air;
-    
-    }
-    else
-        torque_air = 0.0;
-    
-    
-    // GLdouble torque_gimbal
-    GLdouble torque_gimbal;
-    
-    if (MagOfVector(Falcon.main_thrust[0], Falcon.main_thrust[1]) > .0001 ) // prevent dividing by zero
-        
-        torque_gimbal = (Falcon.cm_location * Falcon.part_height) * twoDCrossMag(Falcon.main_thrust[0], Falcon.main_thrust[1], Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]);
-    else
-        torque_gimbal = 0.0;
+        // SCALING EVERYTHING BY FACTOR OF 15000
         
-    if (Falcon.GimbalBeta > 0.0001)
-        torque_gimbal = -torque_gimbal;
-    
-    // sum of torque of air resistance, gimbaled thrust, and each nitrogen thruster
-    Falcon.torque = torque_air + torque_gimbal + (NITROGEN_HEIGHT - Falcon.cm_location * TOTAL_LENGTH) * MagOfVector(Falcon.nit_thrust_right[0],Falcon.nit_thrust_right[1]) - (NITROGEN_HEIGHT - Falcon.cm_location * TOTAL_LENGTH) * MagOfVector(Falcon.nit_thrust_left[0],Falcon.nit_thrust_left[1]);
-}
-
-void updateTheta(){
-    
-    GLboolean smallangle = false; //don't want to divide by zero
-    if (std::abs(Falcon.part_top[0]-Falcon.part_bottom[0]) < 0.00000001)
-        smallangle = true;
-    
-    if ((Falcon.part_top[0]-Falcon.part_bottom[0]) >= 0.0)
-    {
-        if ((Falcon.part_top[1]-Falcon.part_bottom[1]) >= 0.0)
+        glClearColor(0.0, 0.0, 0.0, 0.0);
         {
-            //angle is in first quadrant
-            if (!smallangle)
-                Falcon.theta = atan((Falcon.part_top[1]-Falcon.part_bottom[1])/(Falcon.part_top[0]-Falcon.part_bottom[0]));
-            else
-                Falcon.theta = Pi/2.0;
+            ProfileScope scope(Profiler, "clear");
+            glClear(GL_COLOR_BUFFER_BIT);
         }
-        else if ((Falcon.part_top[1]-Falcon.part_bottom[1]) < 0.0)
+        
+        setCamera(-width_Earth*2.5, width_Earth*2.5, -height_Earth*3.5, height_Earth*1.5);
+        Scene.begin(0.0, 0.0);
+        
         {
-            // angle is in fourth quadrant
-            if (!smallangle)
-                Falcon.theta = atan((Falcon.part_top[1]-Falcon.part_bottom[1])/(Falcon.part_top[0]-Falcon.part_bottom[0])) + 2*Pi;
-            else
-                Falcon.theta = -Pi/2.0;
+            ProfileScope scope(Profiler, "earth view");
+            double x[4] = {-480.0, 520.0, 520.0, -480.0};
+            double y[4] = {-910.0, -910.0, 65.0, 65.0};
+            double u[4] = {0.06, .98, .98, 0.06};
+            double v[4] = {0.0, 0.0, 1.0, 1.0};
+            Scene.setColor(1.0, 1.0, 1.0);
+            Scene.setTexture(texture[1]);
+            Scene.quad(x, y, u, v);
+            
+            // zoomed out rocket
+            Scene.setLineWidth(1);
+            Scene.line(ViewFalcon.part_bottom[0]/15000.0, ViewFalcon.part_bottom[1]/15000.0,
+                       ViewFalcon.part_bottom[0]/15000.0 + .2*(ViewFalcon.part_top[0] - ViewFalcon.part_bottom[0]), ViewFalcon.part_bottom[1]/15000.0 + .2*(ViewFalcon.part_top[1] - ViewFalcon.part_bottom[1]));
+            
+            // zoomed out Second Stage as a point
+            Scene.setPointSize(3);
+            if (!View.CheckList.Detached)
+                Scene.point(ViewFalcon.part_bottom[0]/15000.0 + .2*(ViewFalcon.part_top[0] - ViewFalcon.part_bottom[0]), ViewFalcon.part_bottom[1]/15000.0 + .2*(ViewFalcon.part_top[1] - ViewFalcon.part_bottom[1]));
+            else if (View.CheckList.Detached)
+                Scene.point(ViewSecondStage.part_top[0]/15000.0, ViewSecondStage.part_top[1]/15000.0);
         }
-    }
-    else if ((Falcon.part_top[0]-Falcon.part_bottom[0]) < 0.0)
-    {
-        if ((Falcon.part_top[1]-Falcon.part_bottom[1]) >= 0.0)
+        
         {
-            //angle is in second quadrant
-            if (!smallangle)
-                Falcon.theta = atan((Falcon.part_top[1]-Falcon.part_bottom[1])/(Falcon.part_top[0]-Falcon.part_bottom[0])) + Pi;
-            else
-                Falcon.theta = Pi/2.0;
+            ProfileScope scope(Profiler, "submit");
+            Scene.draw();
         }
-        else if ((Falcon.part_top[1]-Falcon.part_bottom[1]) < 0.0)
+        
         {
-            // angle is in third quadrant
-            if (!smallangle)
-                Falcon.theta = atan((Falcon.part_top[1]-Falcon.part_bottom[1])/(Falcon.part_top[0]-Falcon.part_bottom[0])) + Pi;
-            else
-                Falcon.theta = -Pi/2.0;
+            ProfileScope scope(Profiler, "swap");
+            glutSwapBuffers();
         }
     }
-    
-     Falcon.theta += DeltaT * Falcon.omega;
 }
 
-
-void updateVelocity(){
-    if (CheckList.Liftoff)
-    {
-        Falcon.vel_cm[0] = Falcon.vel_cm[0] + DeltaT * (Falcon.gravity[0] + Falcon.air_resistance[0] + Falcon.main_thrust[0] + Falcon.nit_thrust_left[0] + Falcon.nit_thrust_right[0])/Falcon.mass;
-        
-        Falcon.vel_cm[1] = Falcon.vel_cm[1] + DeltaT * (Falcon.gravity[1] + Falcon.air_resistance[1] + Falcon.main_thrust[1] + Falcon.nit_thrust_left[1] + Falcon.nit_thrust_right[1])/Falcon.mass;
-    }
+// look at [left, right] x [bottom, top], measured from the origin the scene is built around
+void setCamera(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top) {
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(left, right, bottom, top, -1.0, 1.0);
 }
 
-void updateForces(){
-    
-    // since center of Earth is located at [0,-EARTH_RADIUS]
-    Falcon.dist_to_earth = MagOfVector(Falcon.pos_cm[0],Falcon.pos_cm[1] + EARTH_RADIUS);
+// engine flame out the bottom of part, stretched along the thrust by length_x and length_y
+void drawFlame(const RocketPart &part, GLdouble length_x, GLdouble length_y) {
+    GLdouble across[2] = {(part.part_width/2.0)*sin(part.theta), (part.part_width/2.0)*cos(part.theta)};
     
-    // using F = - GmM/r^2  where  GM = 3.98588 * pow(10,14)
-    GLdouble grav_magnitude = 3.98588 * pow(10,14)*(Falcon.mass)/pow(Falcon.dist_to_earth,2.0);
+    double x[3] = {part.part_bottom[0] - across[0], part.part_bottom[0] - length_x * part.main_thrust[0]/part.main_thrust[2], part.part_bottom[0] + across[0]};
+    double y[3] = {part.part_bottom[1] + across[1], part.part_bottom[1] - length_y * part.main_thrust[1]/part.main_thrust[2], part.part_bottom[1] - across[1]};
+    double u[3] = {0.4, 0.5, 0.6};
+    double v[3] = {0.35, 0.0, 0.35};
     
-    Falcon.gravity[0] = - grav_magnitude * Falcon.pos_cm[0]/Falcon.dist_to_earth;
-    Falcon.gravity[1] = - grav_magnitude * (Falcon.pos_cm[1] + EARTH_RADIUS)/Falcon.dist_to_earth;
-    
-    
-    // update air resistance force vector
-    
-    GLdouble sin_alpha;
-    GLdouble cos_alpha;
+    Scene.setColor(1.0, 1.0, 1.0);
+    Scene.setTexture(texture[2]);
+    Scene.triangle(x, y, u, v);
+}
+
+// handle the keys and run the physics as real time goes by, publishing a frame for Draw() every time round
+void simulationLoop() {
+    std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
     
-    if (MagOfVector(Falcon.vel_cm[0], Falcon.vel_cm[1]) > .00001) // don't want to divide by zero
-    {
-        sin_alpha = (Falcon.vel_cm[1])/MagOfVector(Falcon.vel_cm[0], Falcon.vel_cm[1]);
-        cos_alpha = (Falcon.vel_cm[0])/MagOfVector(Falcon.vel_cm[0], Falcon.vel_cm[1]);
-    }
-    else
+    while (SimulationRunning.load(std::memory_order_acquire))
     {
-        sin_alpha = 0;
-        cos_alpha = 0;
+        // the simulation time that goes with last: as far as the stepper has got, plus the time it still owes
+        GLdouble clock = Sim.SimulationTime + Stepper.accumulator;
+        bool stepping = !Replaying && !Sim.CheckList.Paused && !Sim.CheckList.WelcomeScreen;
+        
+        for (size_t ready = Keys.available(); ready > 0; )
+        {
+            size_t run;
+            const KeyEvent *events = Keys.front(run);
+            for (size_t i = 0; i < run; i++)
+            {
+                GLdouble behind = std::max(0.0, std::chrono::duration<GLdouble>(events[i].Time - last).count());
+                GLdouble before = Sim.SimulationTime;
+                KeySimTime = stepping ? clock + behind * ActualWarp : Sim.SimulationTime;
+                handleKey(events[i]);
+                
+                // a key that sent the flight back in time (a reset) took effect on the spot
+                PendingInput input = {(Sim.SimulationTime < before) ? Sim.SimulationTime : KeySimTime, Sim.SimulationTime, events[i].Time};
+                PendingInputs.push_back(input);
+            }
+            Keys.release(run);
+            ready -= run;
+        }
+        
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        advanceSimulation(std::chrono::duration<GLdouble>(now - last).count());
+        last = now;
+        
+        updateInputs();
+        publishFrame();
+        
+        // a physics step is a millisecond, no point coming round much faster
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
-    
-    GLdouble A = std::abs(Falcon.part_width * Falcon.part_height*(sin(Falcon.theta)*cos_alpha - sin_alpha * cos(Falcon.theta))) +
-    std::abs(Falcon.part_width * Falcon.part_width*(cos(Falcon.theta)*cos_alpha + sin(Falcon.theta)*sin_alpha));
-    
-    // using wikipedia for formula for air_density. Not as accurate outside troposphere
-    
-    if ( ((Falcon.dist_to_earth - EARTH_RADIUS) < 43000.0) && ((Falcon.dist_to_earth - EARTH_RADIUS) > 0.0) )
+}
+
+// the keys whose time the simulation has now reached are in the next frame
+void updateInputs() {
+    size_t done = 0;
+    while ((done < PendingInputs.size()) && ((PendingInputs[done].SimTime <= Sim.SimulationTime) || (Sim.SimulationTime < PendingInputs[done].Handled)))
     {
-        T = 288.15 - .0065 * (Falcon.dist_to_earth - EARTH_RADIUS);
-        pressure = 101.325*pow((1 - .0065 * (Falcon.dist_to_earth - EARTH_RADIUS)/288.15),(9.80665*.02896/(8.31447*.0065)));
-        air_density = 1000.0 * pressure * .0289644/(T * 8.31447);
+        LastInputTime = PendingInputs[done].Time;
+        InputsApplied++;
+        done++;
     }
+    PendingInputs.erase(PendingInputs.begin(), PendingInputs.begin() + done);
+}
+
+void handleKey(const KeyEvent &event) {
+    if (event.Special && event.Down)
+        handleKeySpecial(event.Key);
+    else if (event.Special)
+        handleKeySpecialUp(event.Key);
+    else if (event.Down)
+        handleKeyPressed((unsigned char) event.Key);
     else
-    {
-        air_density = 0.0;
-    }
-    
-    // using formula for air resistance: D = DragCoefficient * .5 * A (in direction of velocity) * airdensity * V^2
-    // using Drag Coefficient of .6
-    
-    
-    GLdouble D = .6 * .5 * air_density * pow(MagOfVector(Falcon.vel_cm[0], Falcon.vel_cm[1]),2.0) * A;
+        handleKeyUp((unsigned char) event.Key);
+}
+
+// run the physics substeps that fit in frame_time seconds of real time
+void advanceSimulation(GLdouble frame_time) {
     
-    if ((D*DeltaT < 2.0*Falcon.mass*(MagOfVector(Falcon.vel_cm[0], Falcon.vel_cm[1]))) && (MagOfVector(Falcon.vel_cm[0], Falcon.vel_cm[1]) > 0.0)) // prevent faulty air resistance change in velocity due to high DeltaT, and preventdivision by zero
-    {
-            Falcon.air_resistance[0] = - D * Falcon.vel_cm[0]/MagOfVector(Falcon.vel_cm[0], Falcon.vel_cm[1]);
-            Falcon.air_resistance[1] = - D * Falcon.vel_cm[1]/MagOfVector(Falcon.vel_cm[0], Falcon.vel_cm[1]);
-    }
-    else
+    // a replay plays forward from wherever the last seek left it, no interpolation needed
+    if (Replaying)
     {
-        Falcon.air_resistance[0] = 0;
-        Falcon.air_resistance[1] = 0;
+        if (!Sim.CheckList.Paused)
+            seekReplay(ReplayTime + frame_time * TimeWarp);
+        ActualWarp = TimeWarp;
+        return;
     }
     
-    // update main thrust force vector
-    updateMainThrust();
-    
-    // update side thrust force vectors
-    if (CheckList.RotClock && CheckList.Liftoff)
-    {
-        Falcon.nit_thrust_left[0] =  Falcon.nit_thrust_left[2] * (Falcon.part_top[1] - Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]);
-        
-        Falcon.nit_thrust_left[1] =  - Falcon.nit_thrust_left[2] * (Falcon.part_top[0] - Falcon.part_bottom[0])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]);
-    }
+    // back down to the normal warp limit if the second stage drops into the air
+    if (!orbitalCoast() && (TimeWarp > MAX_TIME_WARP))
+        TimeWarp = MAX_TIME_WARP;
+    ActualWarp = TimeWarp;
+    
+    // a coasting second stage moves along its orbit exactly at any step, so one step per couple of frames is plenty
+    if (orbitalCoast())
+        Stepper.PhysicsRate = 30.0/TimeWarp;
+    // DormandPrince picks its own substeps, so it is handed fewer, longer steps as the warp goes up
+    else if (Sim.Integrator == DormandPrince)
+        Stepper.PhysicsRate = (TimeWarp < 100.0) ? 100.0/TimeWarp : 1.0;
+    // otherwise as long a step as the warp needs and the flight can take, and no more warp than that carries
     else
     {
-        Falcon.nit_thrust_left[0] = 0;
-        Falcon.nit_thrust_left[1] = 0;
+        ActualWarp = std::min(TimeWarp, Warp.maxWarp(Sim));
+        Stepper.PhysicsRate = 1.0/Warp.stepSize(Sim, ActualWarp);
     }
     
-    if (CheckList.RotCountClock && CheckList.Liftoff)
-    {
-        Falcon.nit_thrust_right[0] = - Falcon.nit_thrust_right[2] * (Falcon.part_top[1] - Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]);
-        
-        Falcon.nit_thrust_right[1] = Falcon.nit_thrust_right[2] * (Falcon.part_top[0] - Falcon.part_bottom[0])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]);
-    }
-    else
-    {
-        Falcon.nit_thrust_right[0] = 0;
-        Falcon.nit_thrust_right[1] = 0;
-    }
+    if (!Sim.CheckList.Paused && !Sim.CheckList.WelcomeScreen)
+        Stepper.advance(Sim, frame_time * ActualWarp);
 }
 
-void updateMainThrust(){
-    
-    if ((CheckList.GimbalClock) && (Falcon.GimbalBeta < Pi/4.0))
-        Falcon.GimbalBeta += .5* DeltaT;
-    if ((CheckList.GimbalCountClock) && (Falcon.GimbalBeta > -Pi/4.0))
-        Falcon.GimbalBeta -= .5* DeltaT;
+// true when the booster is down and the second stage is coasting above the atmosphere (or gone), so nothing needs Euler steps
+bool orbitalCoast() {
+    return (Sim.CheckList.Exploded || Sim.CheckList.LandedSuccess) && Sim.CheckList.Detached && (Sim.CheckList.SecondExploded || secondStageCoasting(Sim));
+}
+
+// show the recorded flight at time t, kept within the recording
+void seekReplay(GLdouble t) {
+    ReplayTime = std::max(Player.startTime(), std::min(t, Player.endTime()));
+    Player.seek(Sim, ReplayTime);
+}
+
+// hand Draw() the state as it stands, blended between the last two physics states
+void publishFrame() {
+    ViewerFrame &frame = Frames.back();
     
-    if (CheckList.rocketOn)
+    // a replay is shown exactly where the last seek left it
+    if (Replaying)
     {
-        // equation for thrust vector is cos(Falcon.GimbalBeta) * rocketUnitVector * thrustMagnitude + sin(Falcon.GimbalBeta)*UnitVectorPerpToRocket * thrustMagnitude
-        
-        Falcon.main_thrust[0] = Falcon.main_thrust[2] * cos(Falcon.GimbalBeta)*(Falcon.part_top[0] - Falcon.part_bottom[0])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]) +
-            Falcon.main_thrust[2] * sin(Falcon.GimbalBeta)* -(Falcon.part_top[1] - Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]);
-        
-        Falcon.main_thrust[1] = Falcon.main_thrust[2] * cos(Falcon.GimbalBeta) * (Falcon.part_top[1] - Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]) +
-            Falcon.main_thrust[2] * sin(Falcon.GimbalBeta)* (Falcon.part_top[0] - Falcon.part_bottom[0])/MagOfVector(Falcon.part_top[0] - Falcon.part_bottom[0],Falcon.part_top[1] - Falcon.part_bottom[1]);
-        
-        if (Falcon.FuelPercentage > 0.00001)
-            Falcon.FuelPercentage = (Falcon.FuelPercentage * BOOSTER_FUEL_MASS - DeltaT * (THRUST_SEALEVEL)/(SPECIFIC_IMPULSE * 9.8))/BOOSTER_FUEL_MASS; // mass flow rate formula using thrust and specific impulse
-        else
-        {
-            Falcon.main_thrust[2] = 0.0;
-            Falcon.FuelPercentage = 0.0;
-        }
+        frame.Falcon = Sim.Falcon;
+        frame.SecondStage = Sim.SecondStage;
+        frame.ReplayEnd = Player.endTime();
     }
     else
     {
-        Falcon.main_thrust[0] = 0.0;
-        Falcon.main_thrust[1] = 0.0;
+        frame.Falcon = interpolateRocketPart(Stepper.PreviousFalcon, Sim.Falcon, Stepper.alpha);
+        frame.SecondStage = interpolateRocketPart(Stepper.PreviousSecondStage, Sim.SecondStage, Stepper.alpha);
     }
+    frame.CheckList = Sim.CheckList;
+    frame.SimulationTime = Sim.SimulationTime;
+    frame.TimeSinceLaunch = Sim.TimeSinceLaunch;
+    frame.TimeofDetach = Sim.TimeofDetach;
+    frame.NitrogenHeight = Sim.Vehicle->NitrogenHeight;
+    frame.Integrator = Sim.Integrator;
+    frame.ForceEvaluations = Sim.ForceEvaluations;
+    frame.TimeWarp = TimeWarp;
+    frame.ActualWarp = ActualWarp;
+    frame.Recording = Recorder.isOpen();
+    frame.RecordingDropped = (long long) Recorder.dropped();
+    frame.InputCount = InputsApplied;
+    frame.InputTime = LastInputTime;
+    
+    Frames.publish();
 }
 
-void getSecStagePosition(){
+// GLUT leaves by calling exit(), so the simulation thread is stopped from atexit
+void stopSimulation() {
+    SimulationRunning = false;
+    if (SimulationThread.joinable())
+        SimulationThread.join();
+}
 
-    // update second stage mass
-    SecondStage.mass = SECONDSTAGE_MASS + SECONDSTAGE_FUEL_MASS * SecondStage.FuelPercentage +  FAIRING_MASS;
+// draw stagnant clouds so user can see how fast rocket is travelling
+void drawClouds(GLdouble color) {
     
-    // Find the new angle of the second stage, in version 2.0
-    //updateSecStageAngle();
-  
+    // the field is a block of clouds around the cell the rocket is in, moved along a cell at a time
+    GLdouble x_loc = (int) (ViewFalcon.pos_cm[0]/CLOUD_SPACING);
+    GLdouble y_loc = (int) (ViewFalcon.pos_cm[1]/CLOUD_SPACING);
     
-    // update gravitational force
-    SecondStage.dist_to_earth = MagOfVector(SecondStage.pos_cm[0],SecondStage.pos_cm[1] + EARTH_RADIUS);
-
-    // using F = - GmM/r^2  where  GM = 3.98588 * pow(10,14)
-    GLdouble grav_magnitude2 = 3.98588 * pow(10.0,14.0)*(SecondStage.mass)/pow(SecondStage.dist_to_earth,2.0);
+    Clouds.Color[0] = Clouds.Color[1] = Clouds.Color[2] = color*.9;
+    Clouds.draw(CLOUD_SPACING*x_loc - ViewFalcon.pos_cm[0], CLOUD_SPACING*y_loc - ViewFalcon.pos_cm[1], 1.0, 1.0);
+}
+void drawStars(){
     
-    SecondStage.gravity[0] = - grav_magnitude2 * SecondStage.pos_cm[0]/SecondStage.dist_to_earth;
-    SecondStage.gravity[1] = - grav_magnitude2 * (SecondStage.pos_cm[1] + EARTH_RADIUS)/SecondStage.dist_to_earth;
+    // stars are kept as fractions of the window, so they stretch with it when zooming
+    Stars.draw(- width/2.0, - height/2.0, width, height);
     
+    // Easter Egg
+    Scene.setColor(0.8, 0.2, 0.2);
+    Scene.setPointSize(3);
+    Scene.point(ViewFalcon.pos_cm[0] - width/2.0 + .65 * width, ViewFalcon.pos_cm[1] - height/2.0 + .85 * height);
+}
 
-    // update main thrust
-    if (TimeSinceLaunch - TimeofDetach > 4.0)
-    {
-        
-        SecondStage.main_thrust[0] = SecondStage.main_thrust[2] *(SecondStage.part_top[0] - SecondStage.part_bottom[0])/MagOfVector(SecondStage.part_top[0] - SecondStage.part_bottom[0],SecondStage.part_top[1] - SecondStage.part_bottom[1]);
-    
-        SecondStage.main_thrust[1] = SecondStage.main_thrust[2] * (SecondStage.part_top[1] - SecondStage.part_bottom[1])/MagOfVector(SecondStage.part_top[0] - SecondStage.part_bottom[0],SecondStage.part_top[1] - SecondStage.part_bottom[1]);
-    }
-    else
-    {
-        SecondStage.main_thrust[0] = 0.0; SecondStage.main_thrust[1] = 0.0;
-    }
-    
-    if (SecondStage.FuelPercentage > 0.00001)
-        SecondStage.FuelPercentage = (SecondStage.FuelPercentage * SECONDSTAGE_FUEL_MASS - DeltaT * (THRUST_VACUUM/9.0)/(SPECIFIC_IMPULSE * 9.8))/SECONDSTAGE_FUEL_MASS; // mass flow rate formula using thrust and specific impulse
-    else
+void getStars() {
+    std::vector<float> stars;
+    for (int i = 0; i < STAR_COUNT; i++)
     {
-        SecondStage.main_thrust[2] = 0.0;
-        SecondStage.FuelPercentage = 0.0;
+        // generate random locations for stars
+        stars.push_back(static_cast <GLdouble> (rand()) / static_cast <GLdouble> (RAND_MAX));
+        stars.push_back(static_cast <GLdouble> (rand()) / static_cast <GLdouble> (RAND_MAX));
     }
+    Stars.setPoints(stars);
+    Stars.Color[0] = Stars.Color[1] = Stars.Color[2] = 0.8;
+    Stars.Size = 1;
+}
+
+void getClouds() {
+    std::vector<float> clouds;
+    for (int i = 1 - CLOUD_CELLS; i < CLOUD_CELLS; i++)
+        for (int j = 1 - CLOUD_CELLS; j < CLOUD_CELLS; j++)
+        {
+            clouds.push_back(CLOUD_SPACING*i + 90.0);
+            clouds.push_back(CLOUD_SPACING*j + 230.0);
+        }
+    Clouds.setPoints(clouds);
+    Clouds.Size = 30;
+}
+
+void drawExplosion(){
     
+    double x[4] = {ViewFalcon.pos_cm[0] - 50.0, ViewFalcon.pos_cm[0] + 50.0, ViewFalcon.pos_cm[0] + 50.0, ViewFalcon.pos_cm[0] - 50.0};
+    double y[4] = {ViewFalcon.pos_cm[1] - 50.0, ViewFalcon.pos_cm[1] - 50.0, ViewFalcon.pos_cm[1] + 50.0, ViewFalcon.pos_cm[1] + 50.0};
+    double u[4] = {0.0, 1.0, 1.0, 0.0};
+    double v[4] = {0.0, 0.0, 1.0, 1.0};
     
-    // update velocity
-    SecondStage.vel_cm[0] = SecondStage.vel_cm[0] + DeltaT * (SecondStage.gravity[0] + SecondStage.main_thrust[0])/SecondStage.mass;
-    SecondStage.vel_cm[1] = SecondStage.vel_cm[1] + DeltaT * (SecondStage.gravity[1] + SecondStage.main_thrust[1])/SecondStage.mass;
-    
-    
-    
-    // translation of top and bottom of Second Stage
-    SecondStage.pos_cm[0] += SecondStage.vel_cm[0] * DeltaT;
-    SecondStage.pos_cm[1] += SecondStage.vel_cm[1] * DeltaT;
-    
-    
+    Scene.setColor(1.0, 1.0, 1.0);
+    Scene.setTexture(texture[3]);
+    Scene.quad(x, y, u, v);
+}
+void drawSecondExplosion(){
     
-    // Rotate Second Stage accordingly
-    SecondStage.part_top[0] = ((SECONDSTAGE_LENGTH + FAIRING_LENGTH)/2.0)*cos(SecondStage.theta) + SecondStage.pos_cm[0];
-    SecondStage.part_top[1] = ((SECONDSTAGE_LENGTH + FAIRING_LENGTH)/2.0)*sin(SecondStage.theta) + SecondStage.pos_cm[1];
+    double x[4] = {ViewSecondStage.pos_cm[0] - 30.0, ViewSecondStage.pos_cm[0] + 30.0, ViewSecondStage.pos_cm[0] + 30.0, ViewSecondStage.pos_cm[0] - 30.0};
+    double y[4] = {ViewSecondStage.pos_cm[1] - 30.0, ViewSecondStage.pos_cm[1] - 30.0, ViewSecondStage.pos_cm[1] + 30.0, ViewSecondStage.pos_cm[1] + 30.0};
+    double u[4] = {0.0, 1.0, 1.0, 0.0};
+    double v[4] = {0.0, 0.0, 1.0, 1.0};
     
-    SecondStage.part_bottom[0] = ((SECONDSTAGE_LENGTH + FAIRING_LENGTH)/2.0)*cos(SecondStage.theta + Pi) + SecondStage.pos_cm[0];
-    SecondStage.part_bottom[1] = ((SECONDSTAGE_LENGTH + FAIRING_LENGTH)/2.0)*sin(SecondStage.theta + Pi) + SecondStage.pos_cm[1];
+    Scene.setColor(1.0, 1.0, 1.0);
+    Scene.setTexture(texture[3]);
+    Scene.quad(x, y, u, v);
 }
 
-void drawText(GLdouble x, GLdouble y, char *string_text) {
-    //set the position of the text
-    glRasterPos2f(x,y);
-    //get length of the string
-    int len = (int) strlen(string_text);
+void handleKeyUp(unsigned char key) {
     
-    //loop to display character by character
-    for (int i = 0; i < len; i++)
+    // a replay is scrubbed, not flown
+    if (Replaying)
     {
-        glutBitmapCharacter(GLUT_BITMAP_8_BY_13, string_text[i]);
+        if (key == '[') { seekReplay(ReplayTime - 10.0); return; }
+        if (key == ']') { seekReplay(ReplayTime + 10.0); return; }
+        if (key == ',') { seekReplay(ReplayTime - 1.0); return; }
+        if (key == '.') { seekReplay(ReplayTime + 1.0); return; }
+        if (key == 'r') { seekReplay(Player.startTime()); return; }
+        if (key && strchr("czldnt", key))
+            return;
     }
-}
-
-void keyUp (unsigned char key, int x, int y) {
     
     if (key == 'c')
     {
-        if (!CheckList.Paused)
-            CheckList.RotClock = false;
+        if (!Sim.CheckList.Paused)
+            control(RotClockOff);
     }
     else if (key == 'z')
     {
-        if (!CheckList.Paused)
-            CheckList.RotCountClock = false;
+        if (!Sim.CheckList.Paused)
+            control(RotCountClockOff);
     }
     else if (key == 'i')
     {
-        if (CheckList.WelcomeScreen)
-            CheckList.WelcomeScreen = false;
+        if (Sim.CheckList.WelcomeScreen)
+            Sim.CheckList.WelcomeScreen = false;
         else
-            CheckList.WelcomeScreen = true;
+            Sim.CheckList.WelcomeScreen = true;
     }
     else if (key == 'r')
     {
-        refreshVariables();
+        // the replay can't go back in time with the flight, so it stops here
+        if (ReplayWriter.isOpen())
+        {
+            Sim.Replay = 0;
+            ReplayWriter.close();
+        }
+        refreshVariables(Sim);
+        Stepper.reset(Sim);
+        TimeWarp = 1.0;
     }
     else if (key == 'e')
     {
-        if (CheckList.ZoomOut)
-            CheckList.ZoomOut = false;
+        if (Sim.CheckList.ZoomOut)
+            Sim.CheckList.ZoomOut = false;
         else
-            CheckList.ZoomOut = true;
+            Sim.CheckList.ZoomOut = true;
     }
     else if (key == 'p')
     {
-        if (CheckList.Paused)
-            CheckList.Paused = false;
-        else
-            CheckList.Paused = true;
-    }
-    else if (key == 'v')
-    {
-        if (!CheckList.ZoomOut)
-        {
-            if (width > 750.0) {width = 400.0; height = 400.0;}
-            else if (width > 350.0) {width = 200.0; height = 200.0;}
-            else if (width > 150.0) {width = 800.0; height = 800.0;}
-        }
+        if (Sim.CheckList.Paused)
+            Sim.CheckList.Paused = false;
         else
-        {
-            if (width_Earth > 3199.0) {width_Earth = 1600.0; height_Earth = 1600.0;}
-            else if (width_Earth > 1599.0) {width_Earth = 800.0; height_Earth = 800.0;}
-            else if (width_Earth > 799.0) {width_Earth = 400.0; height_Earth = 400.0;}
-            else if (width_Earth > 399.0) {width_Earth = 200.0; height_Earth = 200.0;}
-            else if (width_Earth > 199.0) {width_Earth = 3200.0; height_Earth = 3200.0;}
-        }
+            Sim.CheckList.Paused = true;
     }
-    else if ((key == 'l') && (!CheckList.Paused))
+    else if ((key == 'l') && (!Sim.CheckList.Paused))
     {
-        if (CheckList.LegsDeployed)
-            CheckList.LegsDeployed = false;
-        else
-            CheckList.LegsDeployed = true;
+        control(Sim.CheckList.LegsDeployed ? LegsOff : LegsOn);
     }
     else if (key == 'w')
     {
-        if ((DeltaT < 40.0) && (!CheckList.Paused))
-            DeltaT *= 2.0;
+        if ((TimeWarp < (orbitalCoast() ? MAX_COAST_TIME_WARP : MAX_TIME_WARP)) && (!Sim.CheckList.Paused))
+            TimeWarp *= 2.0;
     }
     else if (key == 'q')
     {
-        if ((DeltaT > 0.00001)&& (!CheckList.Paused))
-            DeltaT /= 2.0;
+        if ((TimeWarp > MIN_TIME_WARP)&& (!Sim.CheckList.Paused))
+            TimeWarp /= 2.0;
     }
     else if (key == 'd')
     {
-        if (!CheckList.Paused && !CheckList.Detached && !CheckList.LandedSuccess && !CheckList.Exploded && CheckList.Liftoff)
+        if (!Sim.CheckList.Paused)
+            control(Detach);
+    }
+    else if (key == 't')
+    {
+        if (Recorder.isOpen())
         {
-            CheckList.Detached = true;
-            TimeofDetach = TimeSinceLaunch;
-            Falcon.pos_cm[0] = Falcon.part_bottom[0] + (((OCTAWEB_MASS * 0 + BOOSTER_MASS * BOOSTER_LENGTH/2.0 + BOOSTER_FUEL_MASS * Falcon.FuelPercentage * BOOSTER_LENGTH * Falcon.FuelPercentage/2.0)/(OCTAWEB_MASS + BOOSTER_MASS + BOOSTER_FUEL_MASS * Falcon.FuelPercentage)))*cos(Falcon.theta);
-            Falcon.pos_cm[1] = Falcon.part_bottom[1] + (((OCTAWEB_MASS * 0 + BOOSTER_MASS * BOOSTER_LENGTH/2.0 + BOOSTER_FUEL_MASS * Falcon.FuelPercentage * BOOSTER_LENGTH * Falcon.FuelPercentage/2.0)/(OCTAWEB_MASS + BOOSTER_MASS + BOOSTER_FUEL_MASS * Falcon.FuelPercentage)))*sin(Falcon.theta);
-            Falcon.part_height = BOOSTER_LENGTH;
-            Falcon.part_top[0] = Falcon.part_bottom[0] + BOOSTER_LENGTH*cos(Falcon.theta);
-            Falcon.part_top[1] = Falcon.part_bottom[1] + BOOSTER_LENGTH*sin(Falcon.theta);
-            
-            SecondStage.pos_cm[0] = Falcon.part_top[0] + ((SECONDSTAGE_LENGTH + FAIRING_LENGTH)/2.0) * (Falcon.part_top[0]-Falcon.part_bottom[0])/MagOfVector(Falcon.part_top[0]-Falcon.part_bottom[0], Falcon.part_top[1]-Falcon.part_bottom[1]);
-            SecondStage.pos_cm[1] = Falcon.part_top[1] + ((SECONDSTAGE_LENGTH + FAIRING_LENGTH)/2.0) * (Falcon.part_top[1]-Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0]-Falcon.part_bottom[0], Falcon.part_top[1]-Falcon.part_bottom[1]);
-            SecondStage.vel_cm[0] = Falcon.vel_cm[0] + 7.0 * (Falcon.part_top[0]-Falcon.part_bottom[0])/MagOfVector(Falcon.part_top[0]-Falcon.part_bottom[0], Falcon.part_top[1]-Falcon.part_bottom[1]);
-            SecondStage.vel_cm[1] = Falcon.vel_cm[1] + 7.0 * (Falcon.part_top[1]-Falcon.part_bottom[1])/MagOfVector(Falcon.part_top[0]-Falcon.part_bottom[0], Falcon.part_top[1]-Falcon.part_bottom[1]);
-            SecondStage.mass = SECONDSTAGE_MASS + SECONDSTAGE_FUEL_MASS + FAIRING_MASS;
-            SecondStage.theta = Falcon.theta;
-            SecondStage.part_height = SECONDSTAGE_LENGTH + FAIRING_LENGTH; //using fairing
-            SecondStage.part_bottom[0] = Falcon.part_top[0];
-            SecondStage.part_bottom[1] = Falcon.part_top[1];
-            SecondStage.part_top[0] = Falcon.part_top[0] + (SECONDSTAGE_LENGTH + FAIRING_LENGTH)*cos(SecondStage.theta);
-            SecondStage.part_top[1] = Falcon.part_top[1] + (SECONDSTAGE_LENGTH + FAIRING_LENGTH)*sin(SecondStage.theta);
-            
-            SecondStage.main_thrust[2] = THRUST_VACUUM/9.0;
-            SecondStage.main_thrust[0] = SecondStage.main_thrust[2] * cos(SecondStage.theta);
-            SecondStage.main_thrust[1] =  SecondStage.main_thrust[2] * sin(SecondStage.theta);
-            
+            Sim.Telemetry = 0;
+            Recorder.close();
+            std::cout << Recorder.recorded() << " steps recorded to " << TELEMETRY_FILE << " (" << Recorder.dropped() << " dropped)" << std::endl;
+            if (ReplayWriter.isOpen())
+            {
+                Sim.Replay = 0;
+                ReplayWriter.close();
+                std::cout << "replay written to " << REPLAY_FILE << std::endl;
+            }
+        }
+        else
+        {
+            std::string error;
+            if (Recorder.open(TELEMETRY_FILE, error))
+                Sim.Telemetry = &Recorder;
+            else
+                std::cerr << error << std::endl;
+            if (ReplayWriter.open(REPLAY_FILE, Sim, error))
+                Sim.Replay = &ReplayWriter;
+            else
+                std::cerr << error << std::endl;
         }
     }
+    else if (key == 'n')
+    {
+        // cycle through the integrators
+        Sim.Integrator = (IntegratorType) ((Sim.Integrator + 1) % (Verlet + 1));
+        if (ReplayWriter.isOpen())
+            ReplayWriter.keyframe(Sim);
+    }
 }
 
-void keyPressed (unsigned char key, int x, int y) {
+void handleKeyPressed(unsigned char key) {
+    
+    if (Replaying)
+        return;
     
     if (key == 'c')
     {
-        if (!CheckList.Paused)
-            CheckList.RotClock = true;
+        if (!Sim.CheckList.Paused)
+            control(RotClockOn);
     }
     else if (key == 'z')
     {
-        if (!CheckList.Paused)
-            CheckList.RotCountClock = true;
+        if (!Sim.CheckList.Paused)
+            control(RotCountClockOn);
     }
 }
 
-void keySpecialUp (int key, int x, int y) {
+void handleKeySpecialUp(int key) {
+    if (Replaying)
+        return;
     if (key == GLUT_KEY_UP)
     {
-        if (!CheckList.Paused)
-            CheckList.rocketOn = false;
+        if (!Sim.CheckList.Paused)
+            control(EngineOff);
     }
     else if (key == GLUT_KEY_RIGHT)
     {
-        if (!CheckList.Paused)
-            CheckList.GimbalClock = false;
+        if (!Sim.CheckList.Paused)
+            control(GimbalClockOff);
     }
     else if (key == GLUT_KEY_LEFT)
     {
-        if (!CheckList.Paused)
-            CheckList.GimbalCountClock = false;
+        if (!Sim.CheckList.Paused)
+            control(GimbalCountClockOff);
     }
 }
-void keySpecial(int key, int x, int y) {
+void handleKeySpecial(int key) {
+    
+    if (Replaying)
+        return;
     
-    if ((key == GLUT_KEY_UP) && !CheckList.WelcomeScreen && !CheckList.Paused)
+    if ((key == GLUT_KEY_UP) && !Sim.CheckList.WelcomeScreen && !Sim.CheckList.Paused)
     {
-        CheckList.rocketOn = true;
-        
         // 3..2..1.. LIFTOFF!!!!!!  Houston, initiate simulation!
-        if (!CheckList.Liftoff)
-            CheckList.Liftoff = true;
+        control(EngineOn);
     }
     else if (key == GLUT_KEY_RIGHT)
     {
-        if (!CheckList.Paused)
-            CheckList.GimbalClock = true;
+        if (!Sim.CheckList.Paused)
+            control(GimbalClockOn);
     }
     else if (key == GLUT_KEY_LEFT)
     {
-        if (!CheckList.Paused)
-            CheckList.GimbalCountClock = true;
+        if (!Sim.CheckList.Paused)
+            control(GimbalCountClockOn);
     }
     else if (key == GLUT_KEY_DOWN)
     {
-        if (!CheckList.Paused)
-            Falcon.GimbalBeta = 0.0;
+        if (!Sim.CheckList.Paused)
+            control(GimbalCenter);
+    }
+}
+
+// a flight control from the keyboard, put off until the simulation reaches the moment the key went
+void control(TimelineAction action) {
+    
+    // nothing is being stepped, so there is nothing to wait for
+    if (Replaying || Sim.CheckList.Paused || Sim.CheckList.WelcomeScreen)
+    {
+        applyTimelineAction(Sim, action);
+        return;
+    }
+    
+    // in the order the keys went, even if the warp was turned down in between
+    TimelineEvent event = {KeySimTime, action};
+    if (!Controls.Events.empty())
+        event.Time = std::max(event.Time, Controls.Events.back().Time);
+    Controls.Events.push_back(event);
+}
+
+// the GLUT callbacks: zooming and frame traces are the drawing's business, every other key goes to the simulation thread
+void keyUp (unsigned char key, int x, int y) {
+    if (key == 'v')
+    {
+        if (!Frames.read().CheckList.ZoomOut)
+        {
+            if (width > 750.0) {width = 400.0; height = 400.0;}
+            else if (width > 350.0) {width = 200.0; height = 200.0;}
+            else if (width > 150.0) {width = 800.0; height = 800.0;}
+        }
+        else
+        {
+            if (width_Earth > 3199.0) {width_Earth = 1600.0; height_Earth = 1600.0;}
+            else if (width_Earth > 1599.0) {width_Earth = 800.0; height_Earth = 800.0;}
+            else if (width_Earth > 799.0) {width_Earth = 400.0; height_Earth = 400.0;}
+            else if (width_Earth > 399.0) {width_Earth = 200.0; height_Earth = 200.0;}
+            else if (width_Earth > 199.0) {width_Earth = 3200.0; height_Earth = 3200.0;}
+        }
+    }
+    else if (key == 'f')
+    {
+        if (Profiler.isTracing())
+        {
+            std::string error;
+            if (Profiler.stopTrace(TRACE_FILE, error))
+                std::cout << "frame trace written to " << TRACE_FILE << std::endl;
+            else
+                std::cerr << error << std::endl;
+            Profiler.printSummary(stdout);
+        }
+        else
+            Profiler.startTrace();
     }
+    else
+        pushKey(key, false, false);
+}
+
+void keyPressed (unsigned char key, int x, int y) {
+    pushKey(key, false, true);
+}
+
+void keySpecialUp (int key, int x, int y) {
+    pushKey(key, true, false);
+}
+
+void keySpecial(int key, int x, int y) {
+    pushKey(key, true, true);
+}
+
+void pushKey(int key, bool special, bool down) {
+    
+    // only full if the simulation thread is hundreds of keys behind, and then one more won't be missed
+    KeyEvent *event = Keys.claim();
+    if (!event)
+        return;
+    event->Key = key;
+    event->Special = special;
+    event->Down = down;
+    event->Time = std::chrono::steady_clock::now();
+    Keys.publish();
 }
 
 int LoadGLTextures()									// Load Bitmaps And Convert To Textures
@@ -1426,63 +1171,3 @@ int LoadGLTextures()									// Load Bitmaps And Convert To Textures
     
     return true;										// Return Success
 }
-
-GLdouble MagOfVector(GLdouble x, GLdouble y){
-    
-    return sqrt(pow(x,2.0) + pow(y,2.0));
-    
-}
-
-// calculates magnitude of (a,b) in the direction of (c,d)
-GLdouble twoDCrossMag(GLdouble a, GLdouble b, GLdouble c, GLdouble d) {
-    
-    if ((pow((a*c + b*d)/(MagOfVector(a,b)*MagOfVector(c,d)),2.0) > .99999) && (pow((a*c + b*d)/(MagOfVector(a,b)*MagOfVector(c,d)),2.0) < 1.00001))
-        return 0.0;
-    else
-        return  MagOfVector(a,b) * sqrt(std::abs(1- pow((a*c + b*d)/(MagOfVector(a,b)*MagOfVector(c,d)),2.0)));
-}
-
-
-
-void refreshVariables(){
-    
-    TimeSinceLaunch = 0.0;
-    TimeofDetach = 0.0;
-    Falcon.FuelPercentage = 1.0;
-    SecondStage.FuelPercentage = 1.0;
-    Falcon.mass = OCTAWEB_MASS + BOOSTER_MASS + BOOSTER_FUEL_MASS + SECONDSTAGE_MASS + SECONDSTAGE_FUEL_MASS + FAIRING_MASS;
-    Falcon.cm_location =(OCTAWEB_MASS * 0 +BOOSTER_MASS * BOOSTER_LENGTH/2.0 +BOOSTER_FUEL_MASS * Falcon.FuelPercentage * BOOSTER_LENGTH * Falcon.FuelPercentage/2.0 +(SECONDSTAGE_MASS +SECONDSTAGE_FUEL_MASS) * (BOOSTER_LENGTH + INTERSTAGE_LENGTH +SECONDSTAGE_LENGTH/2.0) + FAIRING_MASS * (BOOSTER_LENGTH + INTERSTAGE_LENGTH +SECONDSTAGE_LENGTH + FAIRING_LENGTH/2.0))/(Falcon.mass*TOTAL_LENGTH);
-    
-    Falcon.pos_cm[0] = 0.0, Falcon.pos_cm[1] = Falcon.cm_location*TOTAL_LENGTH;
-    Falcon.vel_cm[0] = 0.0, Falcon.vel_cm[1] = 0.0; Falcon.omega = 0.0;
-    Falcon.GimbalBeta = 0.0;
-    Falcon.torque = 0.0;
-    
-    Falcon.theta = Pi/2.0;
-    Falcon.dist_to_earth = EARTH_RADIUS + Falcon.pos_cm[1];
-    Falcon.part_height = TOTAL_LENGTH;
-    Falcon.part_top[0] = 0.0, Falcon.part_top[1] = TOTAL_LENGTH;
-    Falcon.part_bottom[0] = 0.0, Falcon.part_bottom[1] = 0.0;
-    Falcon.air_resistance[0] = 0.0, Falcon.air_resistance[1] = 0.0;
-    Falcon.main_thrust[0] = 0.0, Falcon.main_thrust[1] = THRUST_SEALEVEL, Falcon.main_thrust[2] = THRUST_SEALEVEL;
-    
-    // couldn't find data on nitrogen thrust magnitude
-    Falcon.nit_thrust_left[0] = 0.0, Falcon.nit_thrust_left[1] = 0.0, Falcon.nit_thrust_left[2] = 10000.0;
-    Falcon.nit_thrust_right[0] = 0.0, Falcon.nit_thrust_right[1] = 0.0, Falcon.nit_thrust_right[2] = 10000.0;
-    
-    
-    CheckList.rocketOn = false;CheckList.ZoomOut = false;CheckList.RotClock = false;CheckList.RotCountClock = false;CheckList.Detached = false;CheckList.Liftoff = false;CheckList.GimbalClock = false;CheckList.GimbalCountClock = false;CheckList.LegsDeployed = false;CheckList.Exploded = false;CheckList.SecondExploded = false;CheckList.LandedSuccess = false;CheckList.WelcomeScreen = false;CheckList.Paused = false;
-    
-    DeltaT = TIME_INCREMENT;
-}
-
-
-
-
-
-
-
-
-
-
-
@@ -0,0 +1,119 @@
+/* Author: William Bryk
+
+ Sweeps the landing burn margin of the nominal flight and prints how each variant lands.
+
+ usage: BurnSweep [--from margin] [--to margin] [--variants N] [--threads N] [--dt seconds] [--detach seconds] [--integrator name] [--vehicle file] [--compare]
+
+ The ascent doesn't depend on the margin, so it is flown once and every variant is forked from a snapshot
+ taken just after stage separation. --compare flies the sweep again the old way, every variant from the pad,
+ checks the two agree and prints how long each took.
+ */
+
+#include "../Ensemble.h"
+#include "../Integrator.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool sameResult(const FlightResult &a, const FlightResult &b){
+    return (a.LandedSuccess == b.LandedSuccess) && (a.Exploded == b.Exploded) && (a.EndTime == b.EndTime) && (a.TouchdownX == b.TouchdownX) && (a.FuelLeft == b.FuelLeft);
+}
+
+int main(int argc, char** argv) {
+
+    EnsembleConfig config;
+    double from = 1.0, to = 1.5;
+    int variants = 64;
+    bool compare = false;
+    const char *vehicle_path = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--from") && i + 1 < argc)
+            from = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--to") && i + 1 < argc)
+            to = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--variants") && i + 1 < argc)
+            variants = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            config.Threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--dt") && i + 1 < argc)
+            config.StepSize = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--detach") && i + 1 < argc)
+            config.Profile.DetachTime = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--integrator") && i + 1 < argc && integratorFromName(argv[i + 1], config.Integrator))
+            i++;
+        else if (!strcmp(argv[i], "--vehicle") && i + 1 < argc)
+            vehicle_path = argv[++i];
+        else if (!strcmp(argv[i], "--compare"))
+            compare = true;
+        else
+        {
+            variants = 0;
+            break;
+        }
+    }
+    if (variants < 1 || !(config.StepSize > 0.0))
+    {
+        fprintf(stderr, "usage: %s [--from margin] [--to margin] [--variants N] [--threads N] [--dt seconds] [--detach seconds] [--integrator name] [--vehicle file] [--compare]\n", argv[0]);
+        return 1;
+    }
+
+    VehicleConfig vehicle;
+    if (vehicle_path)
+    {
+        std::string error;
+        if (!loadVehicle(vehicle_path, vehicle, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        config.Vehicle = &vehicle;
+    }
+
+    // the nominal vehicle
+    FlightDispersion nominal;
+    nominal.DetachTime = config.Profile.DetachTime;
+
+    std::vector<double> margins(variants);
+    for (int i = 0; i < variants; i++)
+        margins[i] = (variants > 1) ? from + (to - from) * i/(variants - 1) : from;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<FlightResult> results = sweepBurnMargin(config, nominal, margins, true);
+    double forked_seconds = secondsSince(start);
+
+    printf("# margin outcome end_time touchdown_x fuel_left\n");
+    for (int i = 0; i < variants; i++)
+    {
+        const FlightResult &r = results[i];
+        const char *outcome = r.LandedSuccess ? "landed" : (r.Exploded ? "exploded" : "timed-out");
+        printf("%.4f %s %.3f %.3f %.4f\n", margins[i], outcome, r.EndTime, r.TouchdownX, r.FuelLeft);
+    }
+    printf("# forked from the ascent   %.3f s\n", forked_seconds);
+
+    if (compare)
+    {
+        start = std::chrono::steady_clock::now();
+        std::vector<FlightResult> from_pad = sweepBurnMargin(config, nominal, margins, false);
+        double pad_seconds = secondsSince(start);
+
+        int differ = 0;
+        for (int i = 0; i < variants; i++)
+            differ += !sameResult(results[i], from_pad[i]);
+
+        printf("# flown from the pad       %.3f s (%.1fx)\n", pad_seconds, forked_seconds > 0.0 ? pad_seconds/forked_seconds : 0.0);
+        printf("# variants that differ     %d\n", differ);
+        if (differ)
+            return 1;
+    }
+
+    return 0;
+}
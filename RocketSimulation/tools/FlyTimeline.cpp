@@ -0,0 +1,152 @@
+/* Author: William Bryk
+
+ Flies a timeline file headless and prints how it went.
+
+ usage: FlyTimeline file [--dt seconds] [--until seconds] [--integrator name] [--vehicle file] [--every seconds] [--telemetry file] [--forces] [--replay file]
+
+ With --every the state is printed at that interval as well as at the end. --telemetry records every step
+ to a binary file (see Telemetry.h), waiting on the disk rather than dropping any; --forces adds the forces
+ to each record. Numbers are printed in full (%.17g), so two runs of the same timeline can be diffed to check
+ they are bit for bit the same. --replay writes a replay the viewer can open and scrub through (see
+ Replay.h). --vehicle flies a vehicle file instead of the Falcon 9 v1.1 (see Vehicle.h).
+ */
+
+#include "../Timeline.h"
+#include "../Integrator.h"
+#include "../Telemetry.h"
+#include "../Replay.h"
+#include "../Vehicle.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+static void printState(const SimulationContext &sim){
+
+    const RocketPart &Falcon = sim.Falcon;
+    printf("%.17g %.17g %.17g %.17g %.17g %.17g %.17g\n", sim.SimulationTime, Falcon.pos_cm[0], Falcon.pos_cm[1], Falcon.vel_cm[0], Falcon.vel_cm[1], Falcon.theta, Falcon.FuelPercentage);
+}
+
+int main(int argc, char** argv) {
+
+    const char *path = 0;
+    const char *telemetry_path = 0;
+    const char *replay_path = 0;
+    const char *vehicle_path = 0;
+    double dt = 0.01, until = 900.0, every = 0.0;
+    IntegratorType integrator = MixedEuler;
+    bool forces = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--dt") && i + 1 < argc)
+            dt = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--until") && i + 1 < argc)
+            until = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--every") && i + 1 < argc)
+            every = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--telemetry") && i + 1 < argc)
+            telemetry_path = argv[++i];
+        else if (!strcmp(argv[i], "--forces"))
+            forces = true;
+        else if (!strcmp(argv[i], "--replay") && i + 1 < argc)
+            replay_path = argv[++i];
+        else if (!strcmp(argv[i], "--integrator") && i + 1 < argc && integratorFromName(argv[i + 1], integrator))
+            i++;
+        else if (!strcmp(argv[i], "--vehicle") && i + 1 < argc)
+            vehicle_path = argv[++i];
+        else if (argv[i][0] != '-' && !path)
+            path = argv[i];
+        else
+        {
+            path = 0;
+            break;
+        }
+    }
+    if (!path || !(dt > 0.0))
+    {
+        fprintf(stderr, "usage: %s file [--dt seconds] [--until seconds] [--integrator name] [--vehicle file] [--every seconds] [--telemetry file] [--forces] [--replay file]\n", argv[0]);
+        return 1;
+    }
+
+    Timeline timeline;
+    std::string error;
+    if (!loadTimeline(path, timeline, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    VehicleConfig vehicle;
+    if (vehicle_path && !loadVehicle(vehicle_path, vehicle, error))
+    {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    SimulationContext sim(vehicle);
+    sim.DeltaT = dt;
+    sim.Integrator = integrator;
+
+    TelemetryRecorder recorder;
+    if (telemetry_path)
+    {
+        recorder.RecordForces = forces;
+        if (!recorder.open(telemetry_path, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        recorder.WaitWhenFull = true;
+        sim.Telemetry = &recorder;
+    }
+
+    ReplayRecorder replay;
+    if (replay_path)
+    {
+        if (!replay.open(replay_path, sim, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        sim.Replay = &replay;
+    }
+
+    if (every > 0.0)
+        printf("# time x y vx vy theta fuel\n");
+
+    // a second at a time when nothing is being printed, so a flight that is over can stop early
+    double chunk = (every > 0.0) ? every : 1.0;
+    for (double next = chunk; sim.SimulationTime < until - 1e-9; next += chunk)
+    {
+        runTimeline(sim, timeline, std::min(next, until));
+        if (every > 0.0)
+            printState(sim);
+
+        bool booster_done = sim.CheckList.Exploded || sim.CheckList.LandedSuccess;
+        bool second_done = !sim.CheckList.Detached || sim.CheckList.SecondExploded;
+        if (booster_done && second_done && (timeline.Next == timeline.Events.size()))
+            break;
+    }
+
+    sim.Telemetry = 0;
+    recorder.close();
+    sim.Replay = 0;
+    replay.close();
+
+    const char *outcome = sim.CheckList.LandedSuccess ? "landed" : (sim.CheckList.Exploded ? "exploded" : "in flight");
+    printf("outcome        %s at %.3f s\n", outcome, sim.TimeSinceLaunch);
+    printf("integrator     %s\n", integratorName(integrator));
+    printf("events         %d of %d applied\n", (int) timeline.Next, (int) timeline.Events.size());
+    printf("touchdown x    %.3f m\n", sim.Falcon.part_bottom[0]);
+    printf("fuel left      %.2f percent\n", 100.0 * sim.Falcon.FuelPercentage);
+    printf("final state    ");
+    printState(sim);
+    if (telemetry_path)
+        printf("telemetry      %llu records (%llu dropped) in %s\n", (unsigned long long) recorder.recorded(), (unsigned long long) recorder.dropped(), telemetry_path);
+    if (replay_path)
+        printf("replay         %s\n", replay_path);
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+/* Author: William Bryk
+
+ Runs a Monte Carlo ensemble of dispersed landing flights and prints the landing success statistics.
+
+ usage: MonteCarlo [--flights N] [--threads N] [--seed S] [--dt seconds] [--integrator name] [--vehicle file] [--csv file]
+
+ Every flight flies the vehicle file if one is given (see Vehicle.h), otherwise the Falcon 9 v1.1.
+ */
+
+#include "../Ensemble.h"
+#include "../Integrator.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+int main(int argc, char** argv) {
+
+    EnsembleConfig config;
+    const char *csv_path = 0;
+    const char *vehicle_path = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--flights") && i + 1 < argc)
+            config.Flights = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            config.Threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+            config.Seed = strtoull(argv[++i], 0, 10);
+        else if (!strcmp(argv[i], "--dt") && i + 1 < argc)
+            config.StepSize = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--integrator") && i + 1 < argc && integratorFromName(argv[i + 1], config.Integrator))
+            i++;
+        else if (!strcmp(argv[i], "--vehicle") && i + 1 < argc)
+            vehicle_path = argv[++i];
+        else if (!strcmp(argv[i], "--csv") && i + 1 < argc)
+            csv_path = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [--flights N] [--threads N] [--seed S] [--dt seconds] [--integrator name] [--vehicle file] [--csv file]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (!(config.StepSize > 0.0))
+    {
+        fprintf(stderr, "usage: %s [--flights N] [--threads N] [--seed S] [--dt seconds] [--integrator name] [--vehicle file] [--csv file]\n", argv[0]);
+        return 1;
+    }
+
+    VehicleConfig vehicle;
+    if (vehicle_path)
+    {
+        std::string error;
+        if (!loadVehicle(vehicle_path, vehicle, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        config.Vehicle = &vehicle;
+    }
+
+    std::vector<FlightResult> results;
+    EnsembleSummary summary = runEnsemble(config, &results);
+
+    printf("integrator     %s\n", integratorName(config.Integrator));
+    printf("flights        %d\n", summary.Flights);
+    printf("landed         %d\n", summary.Landed);
+    printf("exploded       %d\n", summary.Exploded);
+    printf("timed out      %d\n", summary.TimedOut);
+    printf("success rate   %.4f (95%% CI %.4f - %.4f)\n", summary.SuccessRate, summary.SuccessLow, summary.SuccessHigh);
+    printf("touchdown x    %.2f m +/- %.2f m\n", summary.MeanTouchdownX, summary.StdTouchdownX);
+    printf("fuel left      %.2f percent\n", 100.0 * summary.MeanFuelLeft);
+    printf("wall time      %.3f s (%.1f flights/s)\n", summary.WallSeconds, summary.WallSeconds > 0.0 ? summary.Flights/summary.WallSeconds : 0.0);
+
+    if (csv_path)
+    {
+        FILE *csv = fopen(csv_path, "w");
+        if (!csv)
+        {
+            fprintf(stderr, "could not open %s\n", csv_path);
+            return 1;
+        }
+        fprintf(csv, "flight,fuel_load,thrust_scale,gimbal_rate_scale,detach_time,landed,exploded,end_time,touchdown_x,fuel_left\n");
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const FlightResult &r = results[i];
+            fprintf(csv, "%d,%f,%f,%f,%f,%d,%d,%f,%f,%f\n", (int) i, r.Dispersion.FuelLoad, r.Dispersion.ThrustScale, r.Dispersion.GimbalRateScale, r.Dispersion.DetachTime, (int) r.LandedSuccess, (int) r.Exploded, r.EndTime, r.TouchdownX, r.FuelLeft);
+        }
+        fclose(csv);
+    }
+
+    return 0;
+}
@@ -0,0 +1,117 @@
+/* Author: William Bryk
+
+ Prints a telemetry file (see Telemetry.h) as CSV, one row per recorded step, with the forces columns
+ when the file has them. Exits with 1 if the file ends before the records its header counts.
+
+ usage: TelemetryDump file [--every N]
+ */
+
+#include "../Telemetry.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void printPartHeader(const char *name){
+
+    printf(",%s_x,%s_y,%s_vx,%s_vy,%s_mass,%s_fuel,%s_gimbal,%s_omega,%s_theta", name, name, name, name, name, name, name, name, name);
+}
+
+static void printForcesHeader(const char *name){
+
+    printf(",%s_torque,%s_cm_location,%s_air_x,%s_air_y,%s_thrust_x,%s_thrust_y", name, name, name, name, name, name);
+}
+
+static void printPart(const TelemetryPart &p){
+
+    printf(",%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g",
+           p.pos_cm[0], p.pos_cm[1], p.vel_cm[0], p.vel_cm[1], p.mass, p.FuelPercentage, p.GimbalBeta, p.omega, p.theta);
+}
+
+static void printForces(const TelemetryForces &f){
+
+    printf(",%.17g,%.17g,%.17g,%.17g,%.17g,%.17g",
+           f.torque, f.cm_location, f.air_resistance[0], f.air_resistance[1], f.main_thrust[0], f.main_thrust[1]);
+}
+
+int main(int argc, char** argv) {
+
+    const char *path = 0;
+    long every = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--every") && i + 1 < argc)
+            every = atol(argv[++i]);
+        else if (argv[i][0] != '-' && !path)
+            path = argv[i];
+        else
+        {
+            path = 0;
+            break;
+        }
+    }
+    if (!path || every < 1)
+    {
+        fprintf(stderr, "usage: %s file [--every N]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "could not open %s\n", path);
+        return 1;
+    }
+
+    TelemetryHeader header;
+    if ((fread(&header, sizeof(header), 1, file) != 1) || memcmp(header.magic, TELEMETRY_MAGIC, sizeof(header.magic)) || (header.record_size != telemetryRecordSize(header.flags)))
+    {
+        fprintf(stderr, "%s is not a telemetry file this build can read\n", path);
+        fclose(file);
+        return 1;
+    }
+
+    fprintf(stderr, "%llu records, %llu dropped\n", (unsigned long long) header.record_count, (unsigned long long) header.dropped);
+
+    printf("step,time,time_since_launch,switches");
+    printPartHeader("falcon");
+    printPartHeader("second");
+    bool forces = (header.flags & TELEMETRY_FORCES) != 0;
+    if (forces)
+    {
+        printForcesHeader("falcon");
+        printForcesHeader("second");
+    }
+    printf("\n");
+
+    TelemetryRecord record;
+    TelemetryForces part_forces[2];
+    uint64_t read = 0;
+    for (; read < header.record_count; read++)
+    {
+        if (fread(&record, sizeof(record), 1, file) != 1)
+            break;
+        if (forces && (fread(part_forces, sizeof(part_forces), 1, file) != 1))
+            break;
+        if (read % every)
+            continue;
+        printf("%u,%.17g,%.17g,%u", record.step, record.SimulationTime, record.TimeSinceLaunch, record.switches);
+        printPart(record.Falcon);
+        printPart(record.SecondStage);
+        if (forces)
+        {
+            printForces(part_forces[0]);
+            printForces(part_forces[1]);
+        }
+        printf("\n");
+    }
+
+    fclose(file);
+
+    if (read < header.record_count)
+    {
+        fprintf(stderr, "%s: truncated after %llu records\n", path, (unsigned long long) read);
+        return 1;
+    }
+    return 0;
+}